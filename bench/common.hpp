@@ -0,0 +1,50 @@
+#pragma once
+
+// Helpers shared by the benchmarks under bench/.
+
+#include <chrono>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "utils/dataset.hpp"
+#include "utils/symbol_table.hpp"
+
+namespace automata_security {
+namespace bench {
+
+// Random sequences over a small alphabet, so the PTA has roughly `count`
+// times the average length in nodes and most of them stay distinct. The
+// same `seed` gives the same samples.
+inline std::vector<LabeledSequence> synthetic_samples(std::size_t count,
+                                                      SymbolTable& symbols,
+                                                      unsigned int seed = 42U) {
+    constexpr std::size_t kAlphabet = 16;
+    std::vector<SymbolId> alphabet;
+    for (std::size_t i = 0; i < kAlphabet; ++i) {
+        alphabet.push_back(symbols.intern("f=" + std::to_string(i)));
+    }
+    std::mt19937 rng(seed);
+    std::vector<LabeledSequence> samples(count);
+    for (auto& sample : samples) {
+        const std::size_t length = 4 + rng() % 8;
+        for (std::size_t i = 0; i < length; ++i) {
+            sample.symbols.push_back(alphabet[rng() % kAlphabet]);
+        }
+        sample.label = rng() % 4 == 0;
+    }
+    return samples;
+}
+
+// Milliseconds taken by `body()`.
+template <typename Body>
+double time_ms(Body&& body) {
+    const auto start = std::chrono::steady_clock::now();
+    body();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+}  // namespace bench
+}  // namespace automata_security
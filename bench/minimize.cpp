@@ -0,0 +1,106 @@
+// Minimization benchmark.
+//
+// Builds the PTA DFA of one or more IoT captures (or of random sequences,
+// for automata larger than the captures give) and minimizes it with both
+// the sequential Hopcroft refinement and the parallel Moore refinement,
+// reporting the best time of each and checking that the results agree.
+//
+//   make bench
+//   ./bin/bench/minimize datasets/iotMalware/CTU-IoT-Malware-Capture-1-1conn.log.labeled.csv
+//   ./bin/bench/minimize --synthetic=1000000 --threads=32
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+
+#include "automata/dfa.hpp"
+#include "automata/pta.hpp"
+#include "project_config.hpp"
+#include "utils/parser.hpp"
+#include "utils/thread_pool.hpp"
+
+namespace {
+
+using namespace automata_security;
+
+template <typename Minimize>
+double best_ms(int repeat, DFA& result, Minimize&& minimize) {
+    double best = 0.0;
+    for (int r = 0; r < repeat; ++r) {
+        const double ms = bench::time_ms([&]() { result = minimize(); });
+        if (r == 0 || ms < best) {
+            best = ms;
+        }
+    }
+    return best;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> paths;
+    std::size_t synthetic = 0;
+    std::size_t threads = 0;
+    int repeat = 3;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg.rfind("--repeat=", 0) == 0) {
+            repeat = std::max(1, std::atoi(arg.c_str() + 9));
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            threads = static_cast<std::size_t>(std::max(0, std::atoi(arg.c_str() + 10)));
+        } else if (arg.rfind("--synthetic=", 0) == 0) {
+            synthetic = static_cast<std::size_t>(std::max(0, std::atoi(arg.c_str() + 12)));
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty() && synthetic == 0) {
+        paths.push_back(kDefaultIotDataset);
+    }
+
+    try {
+        SymbolTable symbols;
+        std::vector<LabeledSequence> samples;
+        for (const auto& path : paths) {
+            auto loaded = Parser::load_iot_csv(path, symbols);
+            samples.insert(samples.end(), loaded.begin(), loaded.end());
+        }
+        if (synthetic > 0) {
+            auto generated = bench::synthetic_samples(synthetic, symbols);
+            samples.insert(samples.end(), generated.begin(), generated.end());
+        }
+
+        ThreadPool pool(threads);
+        PTA pta;
+        pta.build(samples, pool);
+        const DFA dfa = DFA::from_pta(pta, symbols);
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "samples: " << samples.size() << ", DFA states: " << dfa.states().size()
+                  << ", alphabet: " << dfa.alphabet().size() << ", threads: " << pool.size()
+                  << "\n";
+
+        DFA hopcroft;
+        DFA moore;
+        const double hopcroft_ms = best_ms(repeat, hopcroft, [&]() { return dfa.minimize(); });
+        const double moore_ms =
+            best_ms(repeat, moore, [&]() { return dfa.minimize_moore(pool); });
+        std::cout << "hopcroft: " << hopcroft_ms << " ms (" << hopcroft.states().size()
+                  << " states, best of " << repeat << ")\n";
+        std::cout << "moore: " << moore_ms << " ms (" << moore.states().size()
+                  << " states, best of " << repeat << ")\n";
+        if (hopcroft.to_dot() != moore.to_dot()) {
+            std::cerr << "Error: Hopcroft and Moore results differ." << std::endl;
+            return 1;
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
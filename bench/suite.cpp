@@ -0,0 +1,470 @@
+// Pipeline benchmark suite.
+//
+// Times each stage of the pipeline on synthetic inputs sized by --scale:
+// splitting and loading IoT CSV rows, building the PTA, converting it to a
+// DFA, minimizing PTAs of growing size, classifying sequences (DFA,
+// evaluator and the memory-mapped model the api uses), and simulating PDAs
+// on deeply nested inputs. Every case runs --repeat times; the report gives
+// the best and median time and the throughput at the best time, as text or,
+// with --json, as one JSON document for tracking regressions.
+//
+//   make bench
+//   ./bin/bench/suite
+//   ./bin/bench/suite --json --scale=4 --filter=minimize > bench.json
+//   ./bin/bench/suite --input=datasets/iotMalware/CTU-IoT-Malware-Capture-1-1conn.log.labeled.csv
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "automata/dfa.hpp"
+#include "automata/dfa_model.hpp"
+#include "automata/pta.hpp"
+#include "common.hpp"
+#include "evaluator.hpp"
+#include "project_config.hpp"
+#include "utils/line_tokenizer.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/parser.hpp"
+#include "utils/symbol_table.hpp"
+#include "utils/thread_pool.hpp"
+
+#include "../src/api/pda_simulator.hpp"
+
+namespace {
+
+using namespace automata_security;
+
+struct SuiteOptions {
+    double scale{1.0};
+    int repeat{5};
+    std::size_t threads{0};
+    std::string filter;
+    // A real capture for the parse cases instead of generated rows.
+    std::string input;
+    bool json{false};
+};
+
+struct CaseResult {
+    std::string name;
+    // The case's size parameter (rows, samples, states, depth, ...).
+    std::size_t size{0};
+    // Work done per run, counted in `unit`, and the bytes read, if any.
+    std::size_t items{0};
+    std::string unit;
+    std::size_t bytes{0};
+    std::vector<double> runs_ms;
+
+    double best_ms() const { return *std::min_element(runs_ms.begin(), runs_ms.end()); }
+    double median_ms() const {
+        std::vector<double> sorted = runs_ms;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted[sorted.size() / 2];
+    }
+    double per_second(std::size_t count) const {
+        const double best = best_ms();
+        return best > 0.0 ? static_cast<double>(count) * 1000.0 / best : 0.0;
+    }
+};
+
+// Written by every case so the work it times cannot be optimized away.
+volatile std::size_t g_sink = 0;
+
+class Suite {
+public:
+    explicit Suite(const SuiteOptions& options) : options_(options) {}
+
+    // A group's inputs are only generated when one of its cases will run.
+    bool enabled(std::string_view prefix) const {
+        return options_.filter.empty() || prefix.find(options_.filter) != std::string_view::npos ||
+               options_.filter.find(prefix) != std::string::npos;
+    }
+
+    void run(const std::string& name,
+             std::size_t size,
+             std::size_t items,
+             const std::string& unit,
+             std::size_t bytes,
+             const std::function<std::size_t()>& body) {
+        if (!options_.filter.empty() && name.find(options_.filter) == std::string::npos) {
+            return;
+        }
+        CaseResult result{name, size, items, unit, bytes, {}};
+        for (int r = 0; r < options_.repeat; ++r) {
+            result.runs_ms.push_back(bench::time_ms([&]() { g_sink = g_sink + body(); }));
+        }
+        if (!options_.json) {
+            print_text(result);
+        }
+        results_.push_back(std::move(result));
+    }
+
+    void print_json(std::ostream& out, std::size_t threads) const {
+        out << std::fixed << std::setprecision(3);
+        out << "{\n  \"version\": \"" << kVersion << "\",\n  \"threads\": " << threads
+            << ",\n  \"scale\": " << options_.scale << ",\n  \"repeat\": " << options_.repeat
+            << ",\n  \"results\": [";
+        for (std::size_t i = 0; i < results_.size(); ++i) {
+            const auto& r = results_[i];
+            out << (i == 0 ? "\n" : ",\n");
+            out << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size
+                << ", \"items\": " << r.items << ", \"unit\": \"" << r.unit
+                << "\", \"best_ms\": " << r.best_ms() << ", \"median_ms\": " << r.median_ms()
+                << ", \"items_per_second\": " << r.per_second(r.items);
+            if (r.bytes > 0) {
+                out << ", \"bytes\": " << r.bytes
+                    << ", \"bytes_per_second\": " << r.per_second(r.bytes);
+            }
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+private:
+    const SuiteOptions& options_;
+    std::vector<CaseResult> results_;
+
+    static void print_text(const CaseResult& r) {
+        std::cout << std::left << std::setw(30) << r.name << std::right << std::setw(10) << r.size
+                  << std::fixed << std::setprecision(3) << std::setw(12) << r.best_ms() << " ms"
+                  << std::setw(12) << r.median_ms() << " ms" << std::setprecision(0)
+                  << std::setw(14) << r.per_second(r.items) << " " << r.unit << "/s";
+        if (r.bytes > 0) {
+            std::cout << std::setprecision(1) << "  " << r.per_second(r.bytes) / 1e6 << " MB/s";
+        }
+        std::cout << "\n";
+    }
+};
+
+std::size_t scaled(const SuiteOptions& options, std::size_t base) {
+    return std::max<std::size_t>(1, static_cast<std::size_t>(static_cast<double>(base) * options.scale));
+}
+
+// IoT-23 labeled CSV text with `rows` connection records.
+std::string synthetic_csv(std::size_t rows) {
+    static const char* const kProtos[] = {"tcp", "udp", "icmp"};
+    static const char* const kStates[] = {"S0", "SF", "REJ", "RSTR", "RSTO", "S1", "SH",
+                                          "OTH", "S2", "S3", "RSTOS0", "RSTRH", "SHR"};
+    static const char* const kServices[] = {"-", "http", "dns", "dhcp", "ssh", "irc"};
+    std::mt19937 rng(7);
+    std::string text =
+        "#separator \\x09\n"
+        "ts|uid|id.orig_h|id.orig_p|id.resp_h|id.resp_p|proto|service|duration|orig_bytes|"
+        "resp_bytes|conn_state|local_orig|local_resp|missed_bytes|history|orig_pkts|"
+        "orig_ip_bytes|resp_pkts|resp_ip_bytes|label|detailed-label\n";
+    for (std::size_t i = 0; i < rows; ++i) {
+        const bool malicious = rng() % 3 != 0;
+        text += std::to_string(1525879831 + i / 100) + ".013436|C" + std::to_string(rng()) +
+                "|192.168.100." + std::to_string(rng() % 32) + "|" +
+                std::to_string(1024 + rng() % 60000) + "|10.0." + std::to_string(rng() % 4) +
+                "." + std::to_string(rng() % 256) + "|" + std::to_string(rng() % 1024) + "|" +
+                kProtos[rng() % 3] + "|" + kServices[rng() % 6] + "|2.099548|3996|232|" +
+                kStates[rng() % 13] + "|-|-|0|S|1|40|0|0|" +
+                (malicious ? "Malicious|PartOfAHorizontalPortScan" : "Benign|-") + "\n";
+    }
+    return text;
+}
+
+// A temporary file holding `contents`, removed again on destruction.
+class TempFile {
+public:
+    TempFile(const std::string& suffix, const std::string& contents) {
+        std::random_device device;
+        path_ = (std::filesystem::temp_directory_path() /
+                 ("security-dfa-gen-bench-" + std::to_string(device()) + suffix))
+                    .string();
+        std::ofstream out(path_, std::ios::binary);
+        out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (!out) {
+            throw std::runtime_error("Failed to write " + path_);
+        }
+    }
+    ~TempFile() {
+        std::error_code ignored;
+        std::filesystem::remove(path_, ignored);
+    }
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+void bench_parse(Suite& suite, const SuiteOptions& options) {
+    if (!suite.enabled("parse/")) {
+        return;
+    }
+    std::optional<TempFile> generated;
+    std::string path = options.input;
+    if (path.empty()) {
+        generated.emplace(".csv", synthetic_csv(scaled(options, 200000)));
+        path = generated->path();
+    }
+    const MappedFile file(path);
+    const char delimiter = file.view().find('|') != std::string_view::npos ? '|' : ',';
+    std::size_t lines = 0;
+    {
+        LineCursor cursor(file.view());
+        std::string_view line;
+        while (cursor.next(line)) {
+            ++lines;
+        }
+    }
+
+    std::vector<std::string_view> fields;
+    std::string scratch;
+    suite.run("parse/split_fields", lines, lines, "lines", file.size(), [&]() {
+        std::size_t total = 0;
+        LineCursor cursor(file.view());
+        std::string_view line;
+        while (cursor.next(line)) {
+            split_fields(line, delimiter, fields, scratch);
+            total += fields.size();
+        }
+        return total;
+    });
+    suite.run("parse/load_iot_csv", lines, lines, "lines", file.size(), [&]() {
+        SymbolTable symbols;
+        return Parser::load_iot_csv(path, symbols).size();
+    });
+
+    if (suite.enabled("parse/deduplicate")) {
+        SymbolTable symbols;
+        const auto samples = Parser::load_iot_csv(path, symbols);
+        suite.run("parse/deduplicate", samples.size(), samples.size(), "samples", 0,
+                  [&]() { return deduplicate(samples).size(); });
+    }
+}
+
+void bench_pta(Suite& suite, const SuiteOptions& options, ThreadPool& pool) {
+    if (!suite.enabled("pta/") && !suite.enabled("dfa/from_pta")) {
+        return;
+    }
+    SymbolTable symbols;
+    const auto samples = bench::synthetic_samples(scaled(options, 200000), symbols);
+
+    suite.run("pta/build", samples.size(), samples.size(), "samples", 0, [&]() {
+        PTA pta;
+        pta.build(samples);
+        return pta.size();
+    });
+    suite.run("pta/build_parallel", samples.size(), samples.size(), "samples", 0, [&]() {
+        PTA pta;
+        pta.build(samples, pool);
+        return pta.size();
+    });
+
+    PTA pta;
+    pta.build(samples);
+    suite.run("dfa/from_pta", pta.size(), pta.size(), "nodes", 0,
+              [&]() { return DFA::from_pta(pta, symbols).states().size(); });
+}
+
+void bench_minimize(Suite& suite, const SuiteOptions& options, ThreadPool& pool) {
+    if (!suite.enabled("dfa/minimize")) {
+        return;
+    }
+    // Each size quadruples the PTA, so the cases show how the minimizers scale.
+    for (const std::size_t base : {12500, 50000, 200000}) {
+        SymbolTable symbols;
+        const auto samples = bench::synthetic_samples(scaled(options, base), symbols);
+        PTA pta;
+        pta.build(samples);
+        const DFA dfa = DFA::from_pta(pta, symbols);
+        const std::size_t states = dfa.states().size();
+        suite.run("dfa/minimize", states, states, "states", 0,
+                  [&]() { return dfa.minimize().states().size(); });
+        suite.run("dfa/minimize_moore", states, states, "states", 0,
+                  [&]() { return dfa.minimize_moore(pool).states().size(); });
+    }
+}
+
+void bench_classify(Suite& suite, const SuiteOptions& options, ThreadPool& pool) {
+    if (!suite.enabled("classify/")) {
+        return;
+    }
+    SymbolTable symbols;
+    const auto train = bench::synthetic_samples(scaled(options, 100000), symbols, 1U);
+    const auto test = bench::synthetic_samples(scaled(options, 500000), symbols, 2U);
+    PTA pta;
+    pta.build(train);
+    const DFA dfa = DFA::from_pta(pta, symbols).minimize();
+
+    suite.run("classify/dfa", test.size(), test.size(), "sequences", 0, [&]() {
+        std::size_t accepted = 0;
+        for (const auto& sample : test) {
+            accepted += dfa.classify(sample.symbols) ? 1 : 0;
+        }
+        return accepted;
+    });
+    suite.run("classify/dfa_batch", test.size(), test.size(), "sequences", 0, [&]() {
+        std::vector<const std::vector<SymbolId>*> sequences(test.size());
+        for (std::size_t i = 0; i < test.size(); ++i) {
+            sequences[i] = &test[i].symbols;
+        }
+        std::vector<std::uint64_t> verdicts((test.size() + 63) / 64);
+        dfa.classify_batch(sequences.data(), sequences.size(), verdicts.data());
+        std::size_t accepted = 0;
+        for (const auto word : verdicts) {
+            accepted += std::bitset<64>(word).count();
+        }
+        return accepted;
+    });
+    suite.run("classify/evaluate", test.size(), test.size(), "sequences", 0, [&]() {
+        ConfusionCounts counts;
+        accumulate(dfa, test, counts);
+        return counts.true_positive;
+    });
+    suite.run("classify/evaluate_parallel", test.size(), test.size(), "sequences", 0, [&]() {
+        ConfusionCounts counts;
+        accumulate(dfa, test, counts, pool);
+        return counts.true_positive;
+    });
+
+    // The api's --model path: labels are looked up per symbol, then stepped
+    // through the memory-mapped table.
+    const TempFile model_file(".model", serialize_dfa_model(dfa));
+    const DfaModel model(model_file.path());
+    std::vector<std::vector<std::string>> labeled(test.size());
+    for (std::size_t i = 0; i < test.size(); ++i) {
+        for (const auto id : test[i].symbols) {
+            labeled[i].push_back(symbols.name(id));
+        }
+    }
+    suite.run("classify/model", test.size(), test.size(), "sequences", 0, [&]() {
+        std::size_t accepted = 0;
+        for (const auto& sequence : labeled) {
+            auto state = model.start_state();
+            for (const auto& label : sequence) {
+                state = model.step(state, model.column(label));
+            }
+            accepted += model.accepting(state) ? 1 : 0;
+        }
+        return accepted;
+    });
+}
+
+// Balanced `state=S0` ... `state=SF` input, `depth` pushes deep: the shape
+// validate_pda_sequence checks, on a PDA as load_dot_pda would build it.
+PDA nesting_pda(bool deterministic) {
+    PDA pda;
+    const auto start = pda.get_or_add_state("start");
+    const auto open = pda.get_or_add_state("open");
+    const auto done = pda.get_or_add_state("done");
+    pda.start = start;
+    pda.states[done].accepting = true;
+    pda.states[start].transitions.push_back({"ε", "ε", {"Z0"}, open});
+    pda.states[open].transitions.push_back({"state=S0", "ε", {"X"}, open});
+    pda.states[open].transitions.push_back({"state=SF", "X", {}, open});
+    if (deterministic) {
+        // An explicit end marker keeps every pair of moves apart.
+        pda.states[open].transitions.push_back({"END", "Z0", {}, done});
+    } else {
+        // Accepting on an empty-input move can apply alongside a push, so
+        // the simulator has to search.
+        pda.states[open].transitions.push_back({"ε", "Z0", {}, done});
+    }
+    pda.deterministic = pda_is_deterministic(pda);
+    if (pda.deterministic != deterministic) {
+        throw std::logic_error("Benchmark PDA has the wrong determinism.");
+    }
+    return pda;
+}
+
+void bench_pda(Suite& suite, const SuiteOptions& options) {
+    if (!suite.enabled("pda/")) {
+        return;
+    }
+    for (const bool deterministic : {true, false}) {
+        const PDA pda = nesting_pda(deterministic);
+        for (const std::size_t base : {256, 1024, 4096}) {
+            const std::size_t depth = scaled(options, base);
+            std::vector<std::string> input(depth, "state=S0");
+            input.insert(input.end(), depth, "state=SF");
+            if (deterministic) {
+                input.push_back("END");
+            }
+            PDASimulationLimits limits;
+            limits.max_stack_depth = depth + 2;
+            limits.max_configurations = 16 * input.size() + 16;
+            suite.run(deterministic ? "pda/simulate_deterministic" : "pda/simulate_search", depth,
+                      input.size(), "symbols", 0, [&]() {
+                          const auto result = simulate_pda(pda, input, limits);
+                          if (!result.ok) {
+                              throw std::logic_error("Benchmark PDA rejected its input.");
+                          }
+                          return result.steps.size();
+                      });
+        }
+    }
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --scale=F      Multiply every input size by F (default 1)\n"
+              << "  --repeat=N     Runs per case (default 5)\n"
+              << "  --threads=N    Pool size for the parallel cases (default: all cores)\n"
+              << "  --filter=S     Only run cases whose name contains S\n"
+              << "  --input=FILE   IoT CSV for the parse cases instead of generated rows\n"
+              << "  --json         Print one JSON report instead of the table\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    SuiteOptions options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        if (arg.rfind("--scale=", 0) == 0) {
+            options.scale = std::atof(arg.c_str() + 8);
+        } else if (arg.rfind("--repeat=", 0) == 0) {
+            options.repeat = std::max(1, std::atoi(arg.c_str() + 9));
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            options.threads = static_cast<std::size_t>(std::max(0, std::atoi(arg.c_str() + 10)));
+        } else if (arg.rfind("--filter=", 0) == 0) {
+            options.filter = arg.substr(9);
+        } else if (arg.rfind("--input=", 0) == 0) {
+            options.input = arg.substr(8);
+        } else if (arg == "--json") {
+            options.json = true;
+        } else {
+            print_usage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    if (!(options.scale > 0.0)) {
+        std::cerr << "--scale must be positive." << std::endl;
+        return 1;
+    }
+
+    try {
+        ThreadPool pool(options.threads);
+        Suite suite(options);
+        bench_parse(suite, options);
+        bench_pta(suite, options, pool);
+        bench_minimize(suite, options, pool);
+        bench_classify(suite, options, pool);
+        bench_pda(suite, options);
+        if (options.json) {
+            suite.print_json(std::cout, pool.size());
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
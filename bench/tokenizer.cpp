@@ -0,0 +1,99 @@
+// Tokenizer throughput benchmark.
+//
+// Maps a capture (e.g. an IoT-23 conn.log.labeled.csv) and splits every line
+// with both the vectorized split_fields() and the byte-at-a-time
+// split_fields_scalar(), reporting GB/s for each.
+//
+//   make bench
+//   ./bin/bench/tokenizer datasets/iotMalware/CTU-IoT-Malware-Capture-1-1conn.log.labeled.csv
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "project_config.hpp"
+#include "utils/line_tokenizer.hpp"
+#include "utils/mapped_file.hpp"
+
+namespace {
+
+using namespace automata_security;
+
+using SplitFn = void (*)(std::string_view, char, std::vector<std::string_view>&, std::string&);
+
+struct PassResult {
+    double seconds{0.0};
+    std::size_t fields{0};
+};
+
+PassResult run_pass(const MappedFile& file, char delimiter, SplitFn split) {
+    std::vector<std::string_view> fields;
+    std::string scratch;
+    PassResult result;
+
+    const auto start = std::chrono::steady_clock::now();
+    LineCursor lines(file.view());
+    std::string_view line;
+    while (lines.next(line)) {
+        split(line, delimiter, fields, scratch);
+        result.fields += fields.size();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::string path = kDefaultIotDataset;
+    int repeat = 5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg.rfind("--repeat=", 0) == 0) {
+            repeat = std::max(1, std::atoi(arg.c_str() + 9));
+        } else {
+            path = arg;
+        }
+    }
+
+    try {
+        MappedFile file(path);
+        const char delimiter = file.view().find('|') != std::string_view::npos ? '|' : ',';
+
+        // Warm the page cache so both variants measure CPU cost, not I/O.
+        run_pass(file, delimiter, split_fields_scalar);
+
+        const double gigabytes = static_cast<double>(file.size()) / 1e9;
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "file: " << path << " (" << file.size() << " bytes)\n";
+
+        const std::pair<const char*, SplitFn> variants[] = {
+            {"scalar", split_fields_scalar},
+            {"simd", split_fields},
+        };
+        for (const auto& [name, split] : variants) {
+            double best = 0.0;
+            std::size_t fields = 0;
+            for (int r = 0; r < repeat; ++r) {
+                auto pass = run_pass(file, delimiter, split);
+                if (r == 0 || pass.seconds < best) {
+                    best = pass.seconds;
+                }
+                fields = pass.fields;
+            }
+            std::cout << name << ": " << gigabytes / best << " GB/s (" << fields
+                      << " fields, best of " << repeat << ")\n";
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+#include "automata/dfa.hpp"
+#include "utils/dataset.hpp"
+#include "utils/symbol_table.hpp"
+
+namespace automata_security {
+
+// Build the minimized DFA for `samples` without materializing a PTA.
+//
+// The trained language is finite: the sequences whose positive samples
+// outnumber their negative ones (PTA::build -> DFA::from_pta -> minimize
+// accepts exactly these). The sequences are sorted, deduplicated and the
+// accepted ones are inserted into a minimal acyclic automaton with Daciuk et
+// al.'s incremental algorithm, which registers each finished suffix state as
+// soon as no later word can extend it. Only the register and the path of the
+// previous word are live, so peak memory follows the minimal automaton rather
+// than the trie.
+//
+// The alphabet is every symbol of `samples` and the result is completed with a
+// sink, as with from_pta. Counts are per final state: each accepted sequence's
+// tallies go to the state it ends in.
+DFA build_minimal_acyclic_dfa(const std::vector<LabeledSequence>& samples,
+                              const SymbolTable& symbols);
+
+}  // namespace automata_security
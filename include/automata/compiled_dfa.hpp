@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "utils/symbol_table.hpp"
+
+namespace automata_security {
+
+class DFA;
+
+// CompiledDFA is a frozen, read-only form of a total DFA: one contiguous
+// row-major transition table (state x column) plus an accepting bitset.
+//
+// Columns are indexed directly by SymbolId. The table is one column wider
+// than the largest alphabet id; that last column (and every id beyond it)
+// leads to the dead state, so unknown symbols need no lookup or branch. The
+// dead state is the DFA's sink when it has one, or an extra absorbing,
+// non-accepting row otherwise. Either way classify() matches DFA::classify().
+class CompiledDFA {
+public:
+    using StateId = std::uint32_t;
+
+    CompiledDFA() = default;
+
+    static CompiledDFA from_dfa(const DFA& dfa);
+
+    bool empty() const { return table_.empty(); }
+
+    StateId step(StateId state, SymbolId symbol) const {
+        const SymbolId column = std::min<SymbolId>(symbol, width_ - 1);
+        return table_[static_cast<std::size_t>(state) * width_ + column];
+    }
+
+    bool accepting(StateId state) const {
+        return ((accepting_[state >> 6] >> (state & 63U)) & 1U) != 0;
+    }
+
+    // Walk the table without any per-symbol branches: every id resolves to a
+    // column, and every row is total.
+    bool classify(const std::vector<SymbolId>& sequence) const {
+        StateId current = start_;
+        for (const auto symbol : sequence) {
+            current = step(current, symbol);
+        }
+        return accepting(current);
+    }
+
+    // Classify `count` sequences at once, interleaving their walks (see
+    // walk_interleaved()) when the table and the sequences are large enough
+    // for that to pay (worth_interleaving()). Bit i of `verdicts`, which must hold
+    // (count + 63) / 64 words, is set when sequences[i] is accepted; the bits
+    // equal those classify() gives one sequence at a time.
+    void classify_batch(const std::vector<SymbolId>* const* sequences,
+                        std::size_t count,
+                        std::uint64_t* verdicts) const;
+
+    std::size_t state_count() const { return state_count_; }
+    std::uint32_t width() const { return width_; }
+    StateId start_state() const { return start_; }
+    StateId dead_state() const { return dead_; }
+    const std::vector<std::uint32_t>& table() const { return table_; }
+    const std::vector<std::uint64_t>& accepting_bits() const { return accepting_; }
+
+private:
+    std::vector<std::uint32_t> table_;       // row-major: table_[state * width_ + column]
+    std::vector<std::uint64_t> accepting_;   // bit `state` set when accepting
+    std::size_t state_count_{0};
+    std::uint32_t width_{1};
+    StateId start_{0};
+    StateId dead_{0};
+};
+
+}  // namespace automata_security
@@ -1,18 +1,24 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "automata/compiled_dfa.hpp"
 #include "automata/pta.hpp"
+#include "utils/sequence_builder.hpp"
+#include "utils/symbol_table.hpp"
 
 namespace automata_security {
 
+class ThreadPool;
+
 class DFA {
 public:
     struct State {
-        std::unordered_map<std::string, std::size_t> transitions;
+        std::unordered_map<SymbolId, std::size_t> transitions;
         std::size_t positive_count{0};
         std::size_t negative_count{0};
         bool accepting{false};
@@ -20,31 +26,129 @@ public:
 
     DFA();
 
-    static DFA from_pta(const PTA& pta);
+    // Build a DFA from a PTA whose edges are ids from `symbols`. The table is
+    // copied into the DFA so exports can translate ids back to strings.
+    static DFA from_pta(const PTA& pta, const SymbolTable& symbols);
+
+    // Build a DFA from explicit states over `alphabet` (ids from `symbols`).
+    // The alphabet is sorted like from_pta's and missing transitions are sent
+    // to a sink, which is appended when needed.
+    static DFA from_states(std::vector<State> states,
+                           std::size_t start_state,
+                           std::vector<SymbolId> alphabet,
+                           const SymbolTable& symbols);
+
+    // The minimized DFA of from_pta(pta, symbols) when the state equivalence
+    // is already known: `class_of[n]` is the class of PTA node n and
+    // `sink_class` that of the sink (classes are arbitrary ids). Gives the same
+    // result as minimize() without materializing the per-node DFA; see
+    // IncrementalMinimizer.
+    static DFA from_pta_classes(const PTA& pta,
+                                const SymbolTable& symbols,
+                                const std::vector<std::uint32_t>& class_of,
+                                std::uint32_t sink_class);
 
+    // Minimize the DFA with Hopcroft's partition refinement. The result also
+    // carries its frozen dense table (see compiled()), which classify() then
+    // uses instead of the hash maps.
     DFA minimize() const;
 
-    bool classify(const std::vector<std::string>& sequence) const;
+    // Same result as minimize(), computed with Moore's round-based refinement
+    // on `pool`: every round gives each state the signature (block, block of
+    // each successor) in parallel and regroups equal signatures with a
+    // parallel hash partition, until the number of blocks stops growing.
+    // Takes one round per distinguishing depth (for a PTA, about the longest
+    // sample) instead of Hopcroft's sequential work list.
+    DFA minimize_moore(ThreadPool& pool) const;
+
+    // The same automaton with its states renumbered for locality: states
+    // that are walked together get neighbouring rows of the dense table.
+    // Breadth-first order numbers the states as a walk from the start state
+    // first reaches them (successors in alphabet order), so it depends only
+    // on the automaton, not on the order of the training samples or on how
+    // it was built. In both orders the start state becomes 0, unreachable
+    // states follow the reachable ones in their current order, and the sink
+    // is always the last state. Exports and classification are unchanged
+    // apart from the state names.
+    DFA renumber_breadth_first() const;
+    // Hot paths first: a depth-first walk from the start state that takes
+    // the most visited successor first, by `visits` (one count per state,
+    // e.g. from count_visits() over the training set).
+    DFA renumber_by_visits(const std::vector<std::size_t>& visits) const;
+
+    // Add `weight` to visits[s] for each state s the walk of `sequence`
+    // passes through, start and final state included. `visits` must have
+    // states().size() entries.
+    void count_visits(const std::vector<SymbolId>& sequence,
+                      std::size_t weight,
+                      std::vector<std::size_t>& visits) const;
+
+    // Freeze the current transition function into a dense table.
+    CompiledDFA compile() const { return CompiledDFA::from_dfa(*this); }
+    const CompiledDFA& compiled() const { return compiled_; }
+
+    bool classify(const std::vector<SymbolId>& sequence) const;
+
+    // Bitset form of classify() for many sequences: bit i of `verdicts`
+    // ((count + 63) / 64 words) is set when sequences[i] is accepted. With a
+    // frozen table the walks are interleaved (CompiledDFA::classify_batch()).
+    void classify_batch(const std::vector<SymbolId>* const* sequences,
+                        std::size_t count,
+                        std::uint64_t* verdicts) const;
+
+    // True when both automata accept the same set of sequences. Symbol ids
+    // must come from the same table. Walks the reachable part of the product
+    // automaton; a missing transition counts as a move to a rejecting dead
+    // state, as in classify().
+    bool same_language(const DFA& other) const;
 
     std::string to_dot() const;
 
     const std::vector<State>& states() const { return states_; }
     std::size_t start_state() const { return start_state_; }
-    const std::vector<std::string>& alphabet() const { return alphabet_; }
+    // Index of the sink state, or a value >= states().size() when there is none.
+    std::size_t sink_state() const { return sink_state_; }
+    // Alphabet symbol ids, ordered by their string form for deterministic output.
+    const std::vector<SymbolId>& alphabet() const { return alphabet_; }
+    const SymbolTable& symbols() const { return symbols_; }
     std::string to_definition() const;
     // Generate a Chomsky Normal Form (CNF) grammar representation of this DFA.
     // The output will be a CNF grammar (A -> BC or A -> a) with additional
     // helper nonterminals T0..Tk mapping terminals to nonterminals (Tn -> a).
     // If the start state is accepting, an S -> ε production may be included.
     std::string to_chomsky() const;
+    // Generate a self-contained C++17 header in namespace `name_space` with
+    // the transition table, acceptance and a perfect hash of the labels as
+    // constexpr data, plus classify()/classify_record() functions. Unknown
+    // labels leave the state unchanged, as with the binary model.
+    // classify_record() is only generated when `sequences` (how the training
+    // sequences were built) are the per-row defaults.
+    std::string to_cpp_header(const std::string& name_space,
+                              const SequenceOptions& sequences) const;
 
 private:
     std::vector<State> states_;
     std::size_t start_state_;
-    std::vector<std::string> alphabet_;
+    std::vector<SymbolId> alphabet_;
+    SymbolTable symbols_;
     std::size_t sink_state_;
+    CompiledDFA compiled_;
 
     void ensure_complete_transitions();
+
+    // Merge states into the classes given by `block_of` (one block id per
+    // state; states of a block must be equivalent). Counts are summed and
+    // acceptance is re-voted per class; classes are numbered by their
+    // smallest member.
+    DFA quotient(const std::vector<std::size_t>& block_of) const;
+
+    // States in breadth-first order from the start state, then the ones it
+    // does not reach; `reachable` is set to the number reached. The sink is
+    // left out.
+    std::vector<std::size_t> breadth_first_order(std::size_t& reachable) const;
+    // Renumber so that order[i] becomes state i. `order` lists the
+    // non-sink states; the sink is appended.
+    DFA permuted(const std::vector<std::size_t>& order) const;
 };
 
 }  // namespace automata_security
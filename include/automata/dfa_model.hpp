@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "utils/mapped_file.hpp"
+#include "utils/sequence_builder.hpp"
+
+namespace automata_security {
+
+class DFA;
+
+// Binary model file for a trained DFA, written by the generator
+// (`--export-model`) and loaded by the api (`--model`).
+//
+// Layout (version 2, little-endian, every section 8-byte aligned):
+//
+//   DfaModelHeader
+//   uint32 label_offsets[symbol_count + 1]   byte offsets into label bytes
+//   char   label_bytes[]                     alphabet labels, sorted, no NULs
+//   uint32 table[state_count * symbol_count] row-major: table[state * symbol_count + column]
+//   uint64 accepting[(state_count + 63) / 64] bit `state` set when accepting
+//   uint64 positive_counts[state_count]
+//   uint64 negative_counts[state_count]
+//
+// Column i is the i-th label in sorted order, so lookups are a binary search
+// straight over the mapped bytes and loading needs no parsing or allocation.
+// A state without a transition on a label stores its own index, which is
+// how the DOT reader treats a missing edge.
+//
+// The header also records how the training rows became sequences (the
+// generator's --features and --group-by options), so consumers that build
+// the symbols from raw records can refuse a model they would feed
+// differently. Version 1 headers end before those fields and stand for the
+// defaults: one sequence per row of proto=/state=/service= symbols.
+struct DfaModelHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint32_t state_count;
+    std::uint32_t symbol_count;
+    std::uint32_t start_state;
+    std::uint32_t sink_state;  // kDfaModelNoSink when the DFA has none
+    std::uint64_t label_offsets_offset;
+    std::uint64_t label_bytes_offset;
+    std::uint64_t table_offset;
+    std::uint64_t accepting_offset;
+    std::uint64_t positive_counts_offset;
+    std::uint64_t negative_counts_offset;
+    std::uint64_t file_size;
+    // Version 2.
+    std::uint32_t row_features;   // kDfaModelDurationSymbols | kDfaModelByteSymbols
+    std::uint32_t group_by;       // SequenceOptions::GroupBy: 0 row, 1 host, 2 uid
+    std::uint32_t window;         // SequenceOptions::Window: 0 tumbling, 1 sliding
+    std::uint32_t window_rows;
+    std::uint32_t window_stride;
+    std::uint32_t reserved;       // zero
+};
+
+inline constexpr char kDfaModelMagic[8] = {'S', 'D', 'F', 'A', 'M', 'D', 'L', '\0'};
+inline constexpr std::uint32_t kDfaModelVersion = 2;
+inline constexpr std::uint32_t kDfaModelNoSink = 0xFFFFFFFFU;
+inline constexpr std::uint32_t kDfaModelDurationSymbols = 1U << 0;
+inline constexpr std::uint32_t kDfaModelByteSymbols = 1U << 1;
+
+// Serialize `dfa` into the model format; `sequences` are the options its
+// training sequences were built with.
+std::string serialize_dfa_model(const DFA& dfa, const SequenceOptions& sequences = {});
+
+// Read-only view of a model file. The file is memory-mapped and every
+// accessor reads the mapping directly. The constructor checks the header,
+// the section bounds, the label order and every table entry, and throws
+// std::runtime_error on a malformed or incompatible file.
+class DfaModel {
+public:
+    using StateId = std::uint32_t;
+
+    // An empty model (no file); only empty() may be called on it.
+    DfaModel() = default;
+    explicit DfaModel(const std::string& path);
+
+    bool empty() const { return header_ == nullptr; }
+    std::size_t state_count() const { return header_->state_count; }
+    std::size_t symbol_count() const { return header_->symbol_count; }
+    StateId start_state() const { return header_->start_state; }
+    // Index of the sink state, or a value >= state_count() when there is none.
+    StateId sink_state() const { return header_->sink_state; }
+    std::size_t file_size() const { return file_.size(); }
+    // How the training sequences were built. Only the fields the header
+    // records are set; max_groups and reorder_rows keep their defaults.
+    const SequenceOptions& sequences() const { return sequences_; }
+
+    // Column of `label`, or symbol_count() when it is not in the alphabet.
+    std::uint32_t column(std::string_view label) const;
+    std::string_view label(std::uint32_t column) const {
+        return {label_bytes_ + label_offsets_[column],
+                label_offsets_[column + 1] - label_offsets_[column]};
+    }
+
+    // Unknown columns (>= symbol_count()) stay in `state`.
+    StateId step(StateId state, std::uint32_t column) const {
+        if (column >= header_->symbol_count) {
+            return state;
+        }
+        return table_[static_cast<std::size_t>(state) * header_->symbol_count + column];
+    }
+    bool accepting(StateId state) const {
+        return ((accepting_[state >> 6] >> (state & 63U)) & 1U) != 0;
+    }
+    std::uint64_t positive_count(StateId state) const { return positive_counts_[state]; }
+    std::uint64_t negative_count(StateId state) const { return negative_counts_[state]; }
+
+private:
+    MappedFile file_;
+    const DfaModelHeader* header_{nullptr};
+    SequenceOptions sequences_;
+    const std::uint32_t* label_offsets_{nullptr};
+    const char* label_bytes_{nullptr};
+    const std::uint32_t* table_{nullptr};
+    const std::uint64_t* accepting_{nullptr};
+    const std::uint64_t* positive_counts_{nullptr};
+    const std::uint64_t* negative_counts_{nullptr};
+};
+
+}  // namespace automata_security
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "automata/dfa.hpp"
+#include "automata/pta.hpp"
+#include "utils/dataset.hpp"
+#include "utils/symbol_table.hpp"
+
+namespace automata_security {
+
+// Keeps the minimized DFA of a growing PTA up to date.
+//
+// The DFA built by DFA::from_pta is a tree plus a sink, so two states are
+// equivalent exactly when they agree on acceptance and their children on
+// each symbol are equivalent (a missing child counts as the sink). Every node
+// therefore gets a class from the register of these signatures, computed
+// bottom-up; this is the partition minimize() would find.
+//
+// Inserting a sample only changes the counts on its path, so add() marks
+// just the nodes on that path and refresh() recomputes their signatures,
+// children first. Within one minimizer, a refresh() after add() therefore
+// costs time proportional to the added paths, not to the whole PTA. The
+// constructor and dfa() still visit every node: a process that loads a PTA
+// snapshot and builds one minimizer for it pays for the whole history once.
+class IncrementalMinimizer {
+public:
+    // Classify every node of `pta`. The PTA must outlive the minimizer and be
+    // changed only through add() afterwards.
+    explicit IncrementalMinimizer(PTA& pta);
+
+    // Insert `samples` into the PTA and mark their paths for refresh().
+    void add(const std::vector<LabeledSequence>& samples);
+    void add(const std::vector<WeightedSequence>& records);
+
+    // Reclassify the nodes marked by add().
+    void refresh();
+
+    // Minimized DFA of the current PTA: equal to
+    // DFA::from_pta(pta, symbols).minimize(), state numbering included.
+    DFA dfa(const SymbolTable& symbols);
+
+    // Number of equivalence classes (states of dfa(), sink included).
+    std::size_t class_count() const { return register_.size(); }
+
+private:
+    using ClassId = std::uint32_t;
+    using Signature = std::vector<std::uint32_t>;
+
+    struct SignatureHash {
+        std::size_t operator()(const Signature& signature) const;
+    };
+
+    // Class of the sink and of every node that can never reach acceptance.
+    static constexpr ClassId kDeadClass = 0;
+    static constexpr ClassId kNoClass = 0xFFFFFFFFU;
+
+    PTA& pta_;
+    std::vector<ClassId> class_of_;
+    std::vector<char> dirty_flag_;
+    std::vector<PTA::NodeId> dirty_;
+
+    std::unordered_map<Signature, ClassId, SignatureHash> register_;
+    std::vector<const Signature*> signature_of_;  // key in register_, per class
+    std::vector<std::uint32_t> members_;          // nodes per class
+    std::vector<ClassId> free_classes_;
+    // Scratch buffers reused for every node.
+    Signature scratch_;
+    std::vector<std::pair<SymbolId, ClassId>> child_classes_;
+
+    template <typename Sample>
+    void add_samples(const std::vector<Sample>& samples);
+    void mark_dirty(PTA::NodeId node);
+    // Signature of `node` from its children's current classes: acceptance,
+    // then (symbol, class) per child outside the dead class, by symbol.
+    void signature(PTA::NodeId node, Signature& out);
+    ClassId acquire(const Signature& signature);
+    void classify(PTA::NodeId node);
+};
+
+}  // namespace automata_security
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace automata_security {
+
+// Sequences walk_interleaved() keeps in flight at once.
+constexpr std::size_t kInterleavedLanes = 8;
+
+// Interleaving only pays when steps miss the caches. On a table that fits in
+// L2, or on short sequences (whose walks out-of-order execution already
+// overlaps), the lane bookkeeping costs more than it hides, and callers
+// should keep the plain loop.
+constexpr std::size_t kInterleaveMinTableBytes = std::size_t{512} * 1024;
+constexpr std::size_t kInterleaveMinMeanLength = 12;
+
+inline bool worth_interleaving(std::size_t table_bytes, std::size_t symbols, std::size_t sequences) {
+    return table_bytes >= kInterleaveMinTableBytes && symbols >= kInterleaveMinMeanLength * sequences;
+}
+
+// Walk `count` independent sequences through one transition function,
+// kInterleavedLanes of them in lockstep. A single walk is a chain of
+// dependent loads (each step needs the previous state); advancing several
+// sequences per step gives the CPU independent loads to overlap, which pays
+// off once the table no longer fits in the caches.
+//
+// `range(i)` returns {begin, end} pointers to the symbols of sequence i,
+// `step(state, symbol)` is the transition function, and `finish(i, state)`
+// receives the final state of sequence i. Sequences finish out of order.
+template <typename Symbol, typename Range, typename Step, typename Finish>
+void walk_interleaved(std::size_t count,
+                      std::uint32_t start,
+                      const Range& range,
+                      const Step& step,
+                      const Finish& finish) {
+    struct Lane {
+        const Symbol* next;
+        const Symbol* end;
+        std::uint32_t state;
+        std::size_t index;
+    };
+    Lane lanes[kInterleavedLanes];
+    std::size_t active = 0;
+    std::size_t issued = 0;
+
+    for (;;) {
+        // Refill free lanes; empty sequences finish in the start state.
+        while (active < kInterleavedLanes && issued < count) {
+            const auto bounds = range(issued);
+            if (bounds.first == bounds.second) {
+                finish(issued, start);
+            } else {
+                lanes[active++] = Lane{bounds.first, bounds.second, start, issued};
+            }
+            ++issued;
+        }
+        if (active == 0) {
+            return;
+        }
+
+        // Every lane can take as many steps as the shortest one has left, so
+        // the inner loop needs no bounds checks.
+        std::size_t steps = static_cast<std::size_t>(lanes[0].end - lanes[0].next);
+        for (std::size_t l = 1; l < active; ++l) {
+            steps = std::min(steps, static_cast<std::size_t>(lanes[l].end - lanes[l].next));
+        }
+        if (active == kInterleavedLanes) {
+            // Constant trip count: the compiler keeps the lanes unrolled.
+            for (std::size_t s = 0; s < steps; ++s) {
+                for (std::size_t l = 0; l < kInterleavedLanes; ++l) {
+                    lanes[l].state = step(lanes[l].state, *lanes[l].next++);
+                }
+            }
+        } else {
+            for (std::size_t s = 0; s < steps; ++s) {
+                for (std::size_t l = 0; l < active; ++l) {
+                    lanes[l].state = step(lanes[l].state, *lanes[l].next++);
+                }
+            }
+        }
+
+        // Retire finished lanes by moving the last active lane into the slot.
+        for (std::size_t l = 0; l < active;) {
+            if (lanes[l].next == lanes[l].end) {
+                finish(lanes[l].index, lanes[l].state);
+                lanes[l] = lanes[--active];
+            } else {
+                ++l;
+            }
+        }
+    }
+}
+
+}  // namespace automata_security
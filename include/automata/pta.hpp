@@ -1,36 +1,102 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include "utils/dataset.hpp"
 
 namespace automata_security {
 
+class ThreadPool;
+
+// Prefix tree acceptor over interned symbol ids.
+//
+// Nodes live in parallel arrays indexed by node id rather than as objects
+// with their own child maps: most PTA nodes have one or two children, so each
+// node stores only the head of a first-child/next-sibling list plus the edge
+// symbol leading into it. A node costs a few words and inserting one is an
+// amortized push_back on each array, with no per-node allocation.
 class PTA {
 public:
-    struct Node {
-        std::size_t id;
-        std::unordered_map<std::string, std::size_t> transitions;
-        std::size_t positive_count{0};
-        std::size_t negative_count{0};
-    };
+    using NodeId = std::uint32_t;
+    static constexpr NodeId kNoNode = std::numeric_limits<NodeId>::max();
 
     PTA();
 
+    // Rebuild the trie from scratch over `samples`.
     void build(const std::vector<LabeledSequence>& samples);
+    // Same trie, node ids and counts as build(samples), built on `pool`:
+    // contiguous chunks of the samples become sub-tries in parallel, which
+    // are then merged one first-symbol subtree per task. Small inputs (or a
+    // one-worker pool) fall back to the sequential build.
+    void build(const std::vector<LabeledSequence>& samples, ThreadPool& pool);
+    // Weighted records (see deduplicate()) walk each path once and add all of
+    // its counts; the trie equals the one built from the original samples.
+    void build(const std::vector<WeightedSequence>& records);
+    void build(const std::vector<WeightedSequence>& records, ThreadPool& pool);
+
+    // Insert more samples into the existing trie without clearing it, e.g.
+    // one streamed batch at a time.
+    void add(const std::vector<LabeledSequence>& samples);
+    void add(const std::vector<WeightedSequence>& records);
+    void insert(const LabeledSequence& sample);
+    void insert(const WeightedSequence& record);
+    // Insert one path with the given label counts (a record reweighted by
+    // the caller, e.g. one cross-validation fold's share of it).
+    void insert(const std::vector<SymbolId>& symbols, std::size_t positive, std::size_t negative);
+
+    // Write the trie to a binary snapshot, so a later run can add new samples
+    // to it instead of re-ingesting the old ones. Edge symbols are stored by
+    // name; `symbols` is the table their ids come from.
+    void save(const std::string& path, const SymbolTable& symbols) const;
+
+    // Read a snapshot written by save(). Edge symbols are interned into
+    // `symbols` (names it already has keep their ids), so the trie can be
+    // extended with samples parsed against the same table. Node ids are
+    // preserved. Throws std::runtime_error on a malformed file.
+    static PTA load(const std::string& path, SymbolTable& symbols);
 
-    const std::vector<Node>& nodes() const { return nodes_; }
+    std::size_t size() const { return first_child_.size(); }
     std::size_t start_state() const { return start_state_; }
 
+    std::size_t positive_count(NodeId node) const { return positive_count_[node]; }
+    std::size_t negative_count(NodeId node) const { return negative_count_[node]; }
+
+    // Child of `node` on `symbol`, or kNoNode.
+    NodeId child(NodeId node, SymbolId symbol) const;
+
+    // Sibling-list traversal: first_child(n), then next_sibling(c) until
+    // kNoNode. edge_symbol(c) is the label of the edge into c.
+    NodeId first_child(NodeId node) const { return first_child_[node]; }
+    NodeId next_sibling(NodeId node) const { return next_sibling_[node]; }
+    SymbolId edge_symbol(NodeId node) const { return edge_symbol_[node]; }
+
+    // Call `visit(symbol, child)` for every outgoing edge of `node`.
+    template <typename Visit>
+    void for_each_child(NodeId node, Visit&& visit) const {
+        for (NodeId c = first_child_[node]; c != kNoNode; c = next_sibling_[c]) {
+            visit(edge_symbol_[c], c);
+        }
+    }
+
 private:
     std::size_t start_state_;
-    std::vector<Node> nodes_;
+    std::vector<NodeId> first_child_;
+    std::vector<NodeId> next_sibling_;
+    std::vector<SymbolId> edge_symbol_;
+    std::vector<std::size_t> positive_count_;
+    std::vector<std::size_t> negative_count_;
 
     std::size_t ensure_root();
-    std::size_t add_node();
+    void reset();
+    NodeId add_child(NodeId parent, SymbolId symbol);
+    // Follow `symbols` from the root, creating missing nodes; returns the last.
+    NodeId walk(const std::vector<SymbolId>& symbols);
+    template <typename Sample>
+    void build_parallel(const std::vector<Sample>& samples, ThreadPool& pool);
 };
 
 }  // namespace automata_security
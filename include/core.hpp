@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <iostream>
@@ -21,6 +23,49 @@ struct GrammarDFA {
     std::pair<bool, std::string> classify_with_reason(const std::vector<std::string>& seq) const;
 };
 
+// Read-only dense form of a GrammarDFA for bulk classification: transition
+// labels become column numbers and `trans` becomes one state x column table
+// of integers. Following the visualizer semantics of `--mode dfa`, a missing
+// transition (or a label the DFA has never seen) stays in the current state;
+// unknown labels map to a last column that is the identity.
+//
+// `columns_` holds views into `labels_`, so the type is move-only.
+class FrozenGrammarDFA {
+public:
+    FrozenGrammarDFA() = default;
+    FrozenGrammarDFA(FrozenGrammarDFA&&) = default;
+    FrozenGrammarDFA& operator=(FrozenGrammarDFA&&) = default;
+    FrozenGrammarDFA(const FrozenGrammarDFA&) = delete;
+    FrozenGrammarDFA& operator=(const FrozenGrammarDFA&) = delete;
+
+    static FrozenGrammarDFA from(const GrammarDFA& dfa);
+
+    std::uint32_t column(std::string_view label) const {
+        auto it = columns_.find(label);
+        return it == columns_.end() ? width_ - 1 : it->second;
+    }
+    std::uint32_t step(std::uint32_t state, std::uint32_t column) const {
+        return table_[static_cast<std::size_t>(state) * width_ + column];
+    }
+    bool accepting(std::uint32_t state) const { return accepting_[state] != 0; }
+
+    std::uint32_t start() const { return start_; }
+    std::size_t state_count() const { return names_.size(); }
+    std::size_t width() const { return width_; }
+    const std::string& name(std::uint32_t state) const { return names_[state]; }
+    // State index by name, or state_count() when unknown.
+    std::uint32_t find_state(const std::string& name) const;
+
+private:
+    std::vector<std::string> names_;
+    std::vector<char> accepting_;
+    std::vector<std::string> labels_;
+    std::unordered_map<std::string_view, std::uint32_t> columns_;
+    std::vector<std::uint32_t> table_;
+    std::uint32_t width_{1};
+    std::uint32_t start_{0};
+};
+
 bool load_cnf_grammar(const std::string& path, GrammarDFA& out, std::string& err);
 
 struct PDAResult {
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "evaluator.hpp"
+#include "utils/dataset.hpp"
+#include "utils/symbol_table.hpp"
+#include "utils/thread_pool.hpp"
+
+namespace automata_security {
+
+// The samples of a sweep, deduplicated once for all of its runs. Runs only
+// differ in which samples train and which test, so each one reweights the
+// shared records instead of copying samples into partitions of its own.
+struct SweepData {
+    // Distinct sequences, with the label counts of all samples.
+    std::vector<WeightedSequence> records;
+    // Per sample, in input order: its record and its label.
+    std::vector<std::uint32_t> record_of;
+    std::vector<char> label_of;
+
+    static SweepData from_samples(const std::vector<LabeledSequence>& samples);
+
+    std::size_t sample_count() const { return record_of.size(); }
+};
+
+// One train/test assignment of the samples.
+struct SweepRun {
+    // Split runs (folds == 0) use the partition of
+    // train_test_split(samples, train_ratio, seed). Fold runs shuffle the
+    // samples with `seed`, cut them into `folds` parts and test on part
+    // `fold`.
+    double train_ratio{0.0};
+    unsigned int seed{42U};
+    std::size_t fold{0};
+    std::size_t folds{0};
+
+    // "ratio=0.7 seed=42" or "fold=2/5 seed=42".
+    std::string name() const;
+    // Runs of one group are averaged in the summary: the seeds of a ratio,
+    // or the folds of a seed.
+    std::string group() const;
+};
+
+// One split run per (ratio, seed) pair, ratios outermost.
+std::vector<SweepRun> split_runs(const std::vector<double>& ratios,
+                                 const std::vector<unsigned int>& seeds);
+
+// `folds` fold runs per seed.
+std::vector<SweepRun> k_fold_runs(std::size_t folds, const std::vector<unsigned int>& seeds);
+
+struct SweepResult {
+    SweepRun run;
+    std::size_t train_size{0};
+    std::size_t test_size{0};
+    // Rates, state counts and minimization time of the run's model.
+    Metrics metrics;
+    // Training (PTA, DFA, minimization) and evaluation together.
+    double wall_ms{0.0};
+};
+
+// Train a model per run (PTA -> DFA -> Hopcroft minimization) and evaluate
+// it on the run's test samples. Runs are spread over `pool`, one task each,
+// and results are returned in `runs` order. A split run gives the same
+// model and metrics as a generator run with that --train-ratio and --seed.
+std::vector<SweepResult> run_sweep(const SweepData& data,
+                                   const SymbolTable& symbols,
+                                   const std::vector<SweepRun>& runs,
+                                   ThreadPool& pool);
+
+}  // namespace automata_security
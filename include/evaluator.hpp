@@ -5,6 +5,8 @@
 
 #include "automata/dfa.hpp"
 #include "utils/dataset.hpp"
+#include "utils/stage_metrics.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace automata_security {
 
@@ -15,9 +17,61 @@ struct Metrics {
     std::size_t states_before{0};
     std::size_t states_after{0};
     double minimization_ms{0.0};
+    // How these metrics were computed: the evaluation stage (for a streamed
+    // test set it includes parsing). Filled in by the caller that times it.
+    std::vector<StageMetrics> stages;
 };
 
+// Raw confusion-matrix tallies. Kept separate from Metrics so evaluation can
+// be accumulated batch by batch and turned into rates once at the end.
+struct ConfusionCounts {
+    std::size_t true_positive{0};
+    std::size_t true_negative{0};
+    std::size_t false_positive{0};
+    std::size_t false_negative{0};
+
+    std::size_t total() const {
+        return true_positive + true_negative + false_positive + false_negative;
+    }
+
+    ConfusionCounts& operator+=(const ConfusionCounts& other);
+};
+
+// Classify `test_sequences` and add the outcomes to `counts`.
+void accumulate(const DFA& dfa,
+                const std::vector<LabeledSequence>& test_sequences,
+                ConfusionCounts& counts);
+
+// Parallel variant: `test_sequences` is cut into contiguous chunks classified
+// on `pool`, each into its own counters, which are summed at the end. The
+// result is identical to the sequential overload.
+void accumulate(const DFA& dfa,
+                const std::vector<LabeledSequence>& test_sequences,
+                ConfusionCounts& counts,
+                ThreadPool& pool);
+
+// Weighted records (see deduplicate()) are classified once each and count
+// as many outcomes as they have labels, so the tallies equal those of the
+// original samples.
+void accumulate(const DFA& dfa,
+                const std::vector<WeightedSequence>& test_records,
+                ConfusionCounts& counts);
+void accumulate(const DFA& dfa,
+                const std::vector<WeightedSequence>& test_records,
+                ConfusionCounts& counts,
+                ThreadPool& pool);
+
+Metrics metrics_from_counts(const ConfusionCounts& counts);
+
 Metrics evaluate(const DFA& dfa,
                  const std::vector<LabeledSequence>& test_sequences);
 
+Metrics evaluate(const DFA& dfa,
+                 const std::vector<LabeledSequence>& test_sequences,
+                 ThreadPool& pool);
+
+Metrics evaluate(const DFA& dfa,
+                 const std::vector<WeightedSequence>& test_records,
+                 ThreadPool& pool);
+
 }  // namespace automata_security
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 
+#include "utils/symbol_table.hpp"
+
 namespace automata_security {
 
 struct LabeledSequence {
@@ -12,10 +14,18 @@ struct LabeledSequence {
     std::string resp_host;                   // responder host identifier (e.g. id.resp_h) when available
     std::string uid;                         // connection/session uid when available
     double ts{0.0};                           // timestamp (seconds since epoch) when available
-    std::vector<std::string> symbols;        // sequence over finite alphabet
+    std::vector<SymbolId> symbols;           // sequence over finite alphabet (interned ids)
     bool label;                              // true = malicious, false = benign
 };
 
+// One distinct symbol sequence and how many labeled samples had it; see
+// deduplicate() in parser.hpp.
+struct WeightedSequence {
+    std::vector<SymbolId> symbols;
+    std::size_t positive_count{0};
+    std::size_t negative_count{0};
+};
+
 struct DatasetSplit {
     std::vector<LabeledSequence> train;
     std::vector<LabeledSequence> test;
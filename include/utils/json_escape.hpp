@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace automata_security {
+
+// Append `text` to `out` with JSON string escaping (no surrounding quotes).
+// '"', '\\' and the control characters with a short form (\b \f \n \r \t)
+// use it; other control characters are written as \u00XX. Runs of plain
+// characters are copied in one append.
+void append_json_escaped(std::string& out, std::string_view text);
+
+// Append `text` as a quoted JSON string.
+void append_json_string(std::string& out, std::string_view text);
+
+}  // namespace automata_security
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace automata_security {
+
+// Iterates over the lines of an in-memory buffer (e.g. a MappedFile) as
+// string_views. Lines exclude the terminating '\n'; like std::getline, a final
+// line without a newline is returned and no empty line follows a trailing '\n'.
+class LineCursor {
+public:
+    explicit LineCursor(std::string_view text) : text_(text) {}
+
+    bool next(std::string_view& line);
+
+    // Byte offset of the next unread line.
+    std::size_t offset() const { return pos_; }
+
+private:
+    std::string_view text_;
+    std::size_t pos_{0};
+};
+
+// Split one delimited line into trimmed fields without copying.
+//
+// Quoting follows parse_delimited_line: '"' toggles a quoted region (inside
+// which the delimiter is literal) and is itself dropped, and "" inside quotes
+// yields one '"'. Fields without quotes are plain slices of `line`; quoted
+// fields are unescaped into `scratch`, so the returned views are valid until
+// `line`'s storage or `scratch` is modified. `fields` is cleared first and can
+// be reused across lines to avoid allocations.
+//
+// Lines without any quote character take a vectorized path (SSE2/AVX2 on
+// x86, NEON on ARM) that locates delimiters a block at a time; lines with
+// quotes fall back to split_fields_scalar().
+void split_fields(std::string_view line,
+                  char delimiter,
+                  std::vector<std::string_view>& fields,
+                  std::string& scratch);
+
+// Byte-at-a-time implementation of split_fields(). Handles every line, and is
+// exposed separately so benchmarks can compare it with the vectorized path.
+void split_fields_scalar(std::string_view line,
+                         char delimiter,
+                         std::vector<std::string_view>& fields,
+                         std::string& scratch);
+
+}  // namespace automata_security
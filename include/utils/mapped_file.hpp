@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace automata_security {
+
+// Read-only memory mapping of a whole file. The mapping lives as long as the
+// object, so string_views into view() stay valid until it is destroyed.
+// Empty files map to an empty view; a default-constructed object maps nothing.
+// Files that cannot be mapped (pipes, FIFOs, `<(zcat ...)`) are read to the
+// end into an owned buffer instead, with the same view().
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    const char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    std::string_view view() const { return {data_, size_}; }
+
+private:
+    const char* data_{nullptr};
+    std::size_t size_{0};
+    // Contents read from a file that could not be mapped; data_ points here.
+    std::vector<char> buffer_;
+#ifdef _WIN32
+    void* file_handle_{nullptr};
+    void* mapping_handle_{nullptr};
+#endif
+
+    void release() noexcept;
+};
+
+}  // namespace automata_security
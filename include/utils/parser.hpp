@@ -1,18 +1,83 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
 #include "utils/dataset.hpp"
+#include "utils/sequence_builder.hpp"
+#include "utils/symbol_table.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace automata_security {
 
+struct IotStreamOptions {
+    // Number of rows handed to the batch handler at a time.
+    std::size_t batch_size{65536};
+    // Also copy id/host/resp_host/uid into each sample. Off by default so the
+    // stream only projects the columns the pipeline uses (symbols, label, ts).
+    bool keep_metadata{false};
+    // Row features and grouping. Grouped streams build their sequences with a
+    // SequenceBuilder (and always read the metadata it groups on), so
+    // batches hold windows rather than rows.
+    SequenceOptions sequences;
+};
+
+// Receives each batch of parsed rows. The handler may consume (move from) the
+// samples; the reader recycles the vector for the next batch.
+using SequenceBatchHandler = std::function<void(std::vector<LabeledSequence>& batch)>;
+
 class Parser {
 public:
-    static std::vector<LabeledSequence> load_malware_csv(const std::string& path);
-    static std::vector<LabeledSequence> load_iot_csv(const std::string& path);
+    // Loaders intern every emitted symbol into `symbols`. Pass the same table
+    // to all loads of a run (training inputs and holdouts) so ids agree.
+    static std::vector<LabeledSequence> load_malware_csv(const std::string& path,
+                                                         SymbolTable& symbols);
+    static std::vector<LabeledSequence> load_iot_csv(const std::string& path,
+                                                     SymbolTable& symbols,
+                                                     const SequenceOptions& sequences = {});
+
+    // Stream an IoT CSV in fixed-size batches without materializing the whole
+    // dataset. Returns the number of sequences delivered to `handler`.
+    static std::size_t stream_iot_csv(const std::string& path,
+                                      SymbolTable& symbols,
+                                      const IotStreamOptions& options,
+                                      const SequenceBatchHandler& handler);
+
+    // Load several IoT CSVs on `pool`. Files are parsed concurrently and large
+    // files are further split into newline-aligned byte ranges. Results are
+    // returned per path, in `paths` order, and are identical to calling
+    // load_iot_csv on each path in turn: same samples, same order, same ids.
+    // Grouped sequences are built per file as its ranges finish parsing, in
+    // row order; only a few parsed ranges are held at a time, so memory stays
+    // bounded as with stream_iot_csv (plus the windows returned).
+    static std::vector<std::vector<LabeledSequence>> load_iot_csv_parallel(
+        const std::vector<std::string>& paths,
+        SymbolTable& symbols,
+        ThreadPool& pool,
+        const SequenceOptions& sequences = {});
 };
 
+// Collapse samples with the same symbol sequence into one record that
+// counts their positive and negative labels. Records keep the order in which
+// each sequence first appears, so a PTA built from them gets the same node
+// ids as one built from `data`.
+std::vector<WeightedSequence> deduplicate(const std::vector<LabeledSequence>& data);
+// Same records; record_of[i] is set to the record of data[i].
+std::vector<WeightedSequence> deduplicate(const std::vector<LabeledSequence>& data,
+                                          std::vector<std::uint32_t>& record_of);
+
+// The sample order train_test_split() draws for `seed`: the shuffled data
+// is data[order[0]], data[order[1]], ... Shuffling indices instead of
+// samples lets other callers reproduce a split without copying samples.
+std::vector<std::size_t> shuffled_order(std::size_t size, unsigned int seed);
+
+// Training samples train_test_split() keeps out of `size`: size * ratio,
+// clamped so both partitions are non-empty.
+std::size_t train_split_size(std::size_t size, double train_ratio);
+
 DatasetSplit train_test_split(const std::vector<LabeledSequence>& data,
                               double train_ratio,
                               unsigned int seed = 42U);
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/dataset.hpp"
+#include "utils/symbol_table.hpp"
+
+namespace automata_security {
+
+// How the IoT loaders turn conn.log rows into sequences. The defaults keep
+// one sequence per row with the proto=/state=/service= symbols only.
+struct SequenceOptions {
+    enum class GroupBy {
+        kRow,   // every row is its own sequence
+        kHost,  // rows of one originating host (id.orig_h)
+        kUid,   // rows of one connection uid
+    };
+    enum class Window {
+        kTumbling,  // consecutive, non-overlapping windows
+        kSliding,   // the last `window_rows` rows, every `stride` rows
+    };
+
+    GroupBy group_by{GroupBy::kRow};
+    Window window{Window::kTumbling};
+    // Rows per emitted sequence (its length cap).
+    std::size_t window_rows{16};
+    // Rows between two sliding windows of a group.
+    std::size_t stride{1};
+    // Groups with an open window at once; adding a new group past the limit
+    // flushes the least recently used one.
+    std::size_t max_groups{65536};
+    // Rows held back to put slightly out-of-order timestamps (conn.log is
+    // written at connection end, not start) back in order.
+    std::size_t reorder_rows{4096};
+
+    // Discretized row features, added after proto=/state=/service=:
+    // duration=<decade> and orig_bytes=/resp_bytes=<decade>.
+    bool duration_symbols{false};
+    bool byte_symbols{false};
+
+    bool grouped() const { return group_by != GroupBy::kRow; }
+    // One sequence per row with the proto=/state=/service= symbols only,
+    // which is what a single conn.log record maps to.
+    bool per_row_defaults() const { return !grouped() && !duration_symbols && !byte_symbols; }
+};
+
+// The generator flags that select `options`, e.g. "--group-by=host
+// --window=tumbling --window-rows=16 --features=duration"; empty for the
+// per-row defaults. max_groups and reorder_rows are left out.
+std::string sequence_flags(const SequenceOptions& options);
+
+// Streaming group-by over parsed rows. Rows are grouped by host or uid,
+// ordered by ts through a bounded reorder buffer, and cut into windows of at
+// most `window_rows` rows; each window becomes one sequence, labeled
+// malicious if any of its rows is. Memory is bounded by
+// reorder_rows + max_groups * window_rows rows however large the input is:
+// nothing is sorted as a whole. The order is exact as long as no row is more
+// than reorder_rows rows away from its place; later rows are taken as they
+// come, and a group evicted and seen again starts a new window.
+//
+// An emitted sequence carries the id and ts of its first row and the group
+// key in `host` (kHost) or `uid` (kUid).
+class SequenceBuilder {
+public:
+    explicit SequenceBuilder(const SequenceOptions& options);
+
+    // Add one row; it may be moved from. Windows it completes are appended
+    // to `out`.
+    void add(LabeledSequence& row, std::vector<LabeledSequence>& out);
+
+    // Flush the reorder buffer and then every open window, least recently
+    // used group first.
+    void finish(std::vector<LabeledSequence>& out);
+
+    // Groups flushed early because of max_groups.
+    std::size_t evicted_groups() const { return evicted_; }
+
+private:
+    struct Row {
+        std::size_t symbol_count;
+        bool label;
+        double ts;
+        std::string id;
+    };
+
+    struct Group {
+        std::vector<SymbolId> symbols;  // symbols of the rows in the window
+        std::deque<Row> rows;
+        std::size_t malicious{0};
+        // Rows added since the last emitted window.
+        std::size_t pending{0};
+        bool emitted{false};
+        std::list<std::string>::iterator recency;
+    };
+
+    struct Buffered {
+        double ts;
+        std::size_t order;  // arrival, so equal timestamps keep file order
+        LabeledSequence row;
+    };
+
+    SequenceOptions options_;
+    std::vector<Buffered> reorder_;  // min-heap on (ts, order)
+    std::size_t arrivals_{0};
+    std::unordered_map<std::string, Group> groups_;
+    std::list<std::string> recency_;  // most recently used first
+    std::size_t evicted_{0};
+
+    void dispatch(LabeledSequence& row, std::vector<LabeledSequence>& out);
+    void emit(const std::string& key, Group& group, std::vector<LabeledSequence>& out) const;
+    void flush(const std::string& key, Group& group, std::vector<LabeledSequence>& out) const;
+};
+
+}  // namespace automata_security
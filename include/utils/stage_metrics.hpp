@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace automata_security {
+
+// Cost of one pipeline stage (load, PTA build, minimize, ...).
+struct StageMetrics {
+    std::string name;
+    double wall_ms{0.0};
+    // Dataset rows the stage covered; 0 for stages that only touch the model.
+    std::size_t rows{0};
+    // Highest resident set size reached during the stage, in bytes. Where the
+    // peak cannot be reset (see reset_peak_rss()) this is the process peak
+    // so far, and 0 where it cannot be read at all.
+    std::size_t peak_rss_bytes{0};
+    // Calls to the global operator new during the stage, and bytes requested.
+    std::size_t allocations{0};
+    std::size_t allocated_bytes{0};
+
+    double rows_per_second() const {
+        return wall_ms > 0.0 ? static_cast<double>(rows) * 1000.0 / wall_ms : 0.0;
+    }
+};
+
+// Totals since process start, as reported to record_allocation(). Only the
+// generator replaces the global operator new to report them (a relaxed
+// atomic add per call), so the other binaries keep the default allocator
+// and read zero. Frees are not tracked.
+struct AllocationCounts {
+    std::size_t allocations{0};
+    std::size_t bytes{0};
+};
+
+void record_allocation(std::size_t bytes);
+
+AllocationCounts allocation_counts();
+
+// Peak resident set size of the process in bytes (0 when unavailable).
+std::size_t peak_rss_bytes();
+
+// Restart peak_rss_bytes() from the current resident set size. Only Linux
+// supports this (/proc/self/clear_refs); returns false elsewhere.
+bool reset_peak_rss();
+
+// Measures one stage from construction to stop(). Stages must not overlap:
+// each one restarts the process-wide peak RSS.
+class StageTimer {
+public:
+    explicit StageTimer(std::string name);
+
+    StageMetrics stop(std::size_t rows = 0) const;
+
+private:
+    std::string name_;
+    std::chrono::steady_clock::time_point start_;
+    AllocationCounts allocations_;
+};
+
+}  // namespace automata_security
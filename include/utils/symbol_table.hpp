@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace automata_security {
+
+// Dense integer identifier for an alphabet symbol such as `proto=tcp`.
+using SymbolId = std::uint32_t;
+
+inline constexpr SymbolId kInvalidSymbol = std::numeric_limits<SymbolId>::max();
+
+// SymbolTable interns symbol strings into dense ids (0, 1, 2, ...) in order of
+// first appearance. Parsers build one table per run so that sequences, the
+// PTA and the DFA all work on integers; the strings are only needed again
+// when exporting (DOT, definition, CNF grammar).
+class SymbolTable {
+public:
+    // Return the id for `name`, assigning the next free id if it is new.
+    SymbolId intern(const std::string& name);
+
+    // Return the id for `name`, or kInvalidSymbol if it was never interned.
+    SymbolId find(const std::string& name) const;
+
+    const std::string& name(SymbolId id) const { return names_[id]; }
+    const std::vector<std::string>& names() const { return names_; }
+    std::size_t size() const { return names_.size(); }
+    bool empty() const { return names_.empty(); }
+
+private:
+    std::vector<std::string> names_;
+    std::unordered_map<std::string, SymbolId> ids_;
+};
+
+}  // namespace automata_security
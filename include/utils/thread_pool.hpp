@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace automata_security {
+
+// Fixed-size pool of worker threads fed from one FIFO queue.
+//
+// Tasks must not block on other tasks of the same pool (e.g. call
+// parallel_for from inside a task); with all workers waiting that would
+// deadlock. Callers flatten nested work into one batch instead.
+class ThreadPool {
+public:
+    // `threads == 0` uses std::thread::hardware_concurrency() (at least 1).
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const { return workers_.size(); }
+
+    // Queue `task` and return a future for its result (or exception).
+    template <typename Task>
+    auto submit(Task&& task) -> std::future<decltype(task())> {
+        using Result = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task));
+        auto future = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace([packaged]() { (*packaged)(); });
+        }
+        ready_.notify_one();
+        return future;
+    }
+
+    // Run `body(i)` for every i in [0, count) and wait for all of them. Runs
+    // inline when the pool has a single worker or there is a single item.
+    // The first exception thrown by any item is rethrown after all finish.
+    void parallel_for(std::size_t count, const std::function<void(std::size_t)>& body);
+
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    bool stopping_{false};
+
+    void worker_loop();
+};
+
+}  // namespace automata_security
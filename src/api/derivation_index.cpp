@@ -0,0 +1,185 @@
+#include "derivation_index.hpp"
+
+using namespace std;
+
+namespace automata_security {
+
+namespace {
+
+bool is_terminal_label(const Grammar& g, const string& token) {
+    return !token.empty() && token[0] == 'T' && g.terminals.count(token) != 0;
+}
+
+// A production reading one terminal: its column and whether it continues.
+struct Reading {
+    uint32_t nonterminal;
+    uint32_t column;
+    uint32_t production;
+    bool continues;
+};
+
+}  // namespace
+
+DerivationIndex DerivationIndex::from(const Grammar& g) {
+    DerivationIndex index;
+
+    unordered_map<string, uint32_t> nonterminals;
+    for (const auto& entry : g.productions) {
+        nonterminals.emplace(entry.first, static_cast<uint32_t>(nonterminals.size()));
+    }
+    auto nonterminal = [&](const string& token) {
+        auto it = nonterminals.find(token);
+        return it == nonterminals.end() ? kNone : it->second;
+    };
+    index.start_ = nonterminal("S");
+    index.skip_.assign(nonterminals.size(), kNone);
+    index.finish_skip_.assign(nonterminals.size(), kNone);
+
+    // Render a production once. A production that starts with a terminal
+    // label is shown first as written (T1 A2), then translated (proto=tcp A2).
+    auto add_production = [&](const vector<string>& prod, uint32_t next) {
+        Production production;
+        production.next = next;
+        for (size_t i = 0; i < prod.size(); ++i) {
+            if (i > 0) production.text += " ";
+            production.text += is_terminal_label(g, prod[i]) ? g.terminals.at(prod[i]) : prod[i];
+        }
+        if (is_terminal_label(g, prod[0])) {
+            for (size_t i = 0; i < prod.size(); ++i) {
+                if (i > 0) production.raw += " ";
+                production.raw += prod[i];
+            }
+        }
+        index.productions_.push_back(std::move(production));
+        return static_cast<uint32_t>(index.productions_.size() - 1);
+    };
+
+    vector<Reading> readings;
+    for (const auto& [lhs, prods] : g.productions) {
+        const uint32_t from = nonterminals.at(lhs);
+        for (const auto& prod : prods) {
+            if (prod.empty()) continue;
+
+            size_t idx = 0;
+            while (idx < prod.size() && prod[idx] == "ε") idx++;
+
+            // Productions applied without input: the first A -> B or
+            // A -> ε B, and (only at the end) the first of those or A -> ε.
+            const bool unit = prod.size() == 1 && nonterminal(prod[0]) != kNone;
+            if (unit || (idx < prod.size() && nonterminal(prod[idx]) != kNone)) {
+                if (index.skip_[from] == kNone || index.finish_skip_[from] == kNone) {
+                    const uint32_t id = add_production(prod, nonterminal(unit ? prod[0] : prod[idx]));
+                    if (index.skip_[from] == kNone) index.skip_[from] = id;
+                    if (index.finish_skip_[from] == kNone) index.finish_skip_[from] = id;
+                }
+                continue;
+            }
+            if (idx >= prod.size()) {
+                if (index.finish_skip_[from] == kNone) index.finish_skip_[from] = add_production(prod, kNone);
+                continue;
+            }
+
+            // Reads one terminal (a label or a literal that is no nonterminal)
+            // and goes on with the next nonterminal after it, if any.
+            const string& token = prod[idx];
+            const string& value = is_terminal_label(g, token) ? g.terminals.at(token) : token;
+            uint32_t next = kNone;
+            for (size_t j = idx + 1; j < prod.size() && next == kNone; ++j) {
+                if (prod[j] != "ε") next = nonterminal(prod[j]);
+            }
+            const auto column =
+                index.terminals_.emplace(value, static_cast<uint32_t>(index.terminals_.size())).first->second;
+            readings.push_back({from, column, add_production(prod, next), next != kNone});
+        }
+    }
+
+    // For each (nonterminal, terminal), the last symbol prefers the first
+    // production that ends and any other symbol the first that continues;
+    // without one, either takes the first production that matches at all.
+    index.width_ = index.terminals_.size();
+    index.steps_.assign(nonterminals.size() * index.width_, Step{});
+    for (const auto& reading : readings) {
+        Step& step = index.steps_[reading.nonterminal * index.width_ + reading.column];
+        uint32_t& slot = reading.continues ? step.more : step.last;
+        if (slot == kNone) slot = reading.production;
+    }
+    for (auto& step : index.steps_) {
+        if (step.more == kNone) step.more = step.last;
+        if (step.last == kNone) step.last = step.more;
+    }
+    return index;
+}
+
+Derivation DerivationIndex::derive(const vector<string>& seq) const {
+    static const string kStart = "S";
+    Derivation derivation;
+    derivation.steps.push_back({0, &kStart});  // Start with the initial symbol.
+    uint32_t current = start_;
+
+    // Each step shows the matched input followed by the production applied,
+    // unless that repeats the previous step. The previous step's matched
+    // input is a prefix of the current one, so only the tail is compared.
+    auto emit = [&](const string& rhs) {
+        const Derivation::Step& last = derivation.steps.back();
+        const size_t matched = derivation.matched.size();
+        const size_t grown = matched - last.matched_length;
+        const bool repeated = last.rhs->size() == grown + rhs.size() &&
+                              last.rhs->compare(0, grown, derivation.matched, last.matched_length, grown) == 0 &&
+                              last.rhs->compare(grown, string::npos, rhs) == 0;
+        if (!repeated) derivation.steps.push_back({matched, &rhs});
+    };
+    auto apply = [&](uint32_t id) {
+        const Production& production = productions_[id];
+        if (!production.raw.empty()) emit(production.raw);
+        emit(production.text);
+        current = production.next;
+    };
+
+    // Follow productions that consume no input, stopping at a nonterminal
+    // already expanded during this call.
+    vector<uint32_t> seen(skip_.size(), 0);
+    uint32_t round = 0;
+    auto advance_without_consuming = [&](const vector<uint32_t>& skip) {
+        ++round;
+        while (current != kNone && seen[current] != round) {
+            seen[current] = round;
+            if (skip[current] == kNone) break;
+            apply(skip[current]);
+        }
+    };
+
+    advance_without_consuming(skip_);
+    for (size_t seq_idx = 0; seq_idx < seq.size(); ++seq_idx) {
+        advance_without_consuming(skip_);
+        if (current == kNone) break;
+
+        auto column = terminals_.find(seq[seq_idx]);
+        if (column == terminals_.end()) break;
+        const Step& step = steps_[current * width_ + column->second];
+        const uint32_t id = seq_idx + 1 == seq.size() ? step.last : step.more;
+        if (id == kNone) break;  // No matching rule found.
+
+        apply(id);
+        derivation.matched += seq[seq_idx];
+        derivation.matched += ' ';
+        advance_without_consuming(skip_);
+    }
+
+    // Final cleanup: expand any remaining epsilon rules.
+    advance_without_consuming(finish_skip_);
+    return derivation;
+}
+
+size_t DerivationIndex::approximate_bytes() const {
+    size_t bytes = sizeof(DerivationIndex) + steps_.size() * sizeof(Step) +
+                   (skip_.size() + finish_skip_.size()) * sizeof(uint32_t);
+    for (const auto& production : productions_) {
+        bytes += sizeof(Production) + production.raw.capacity() + production.text.capacity();
+    }
+    for (const auto& [value, column] : terminals_) {
+        bytes += sizeof(string) + value.capacity() + sizeof(column) + 48;
+    }
+    return bytes;
+}
+
+}  // namespace automata_security
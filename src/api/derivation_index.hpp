@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils.hpp"
+
+namespace automata_security {
+
+// One derivation. Step i is the sentential form
+//   matched[0, steps[i].matched_length) + *steps[i].rhs
+// i.e. the input consumed so far followed by the right-hand side of the
+// production just applied. The consumed input only grows, so steps keep its
+// length rather than a copy, and a long derivation stays linear in size.
+// `rhs` points into the DerivationIndex, which must outlive the result.
+struct Derivation {
+    struct Step {
+        std::size_t matched_length;
+        const std::string* rhs;
+    };
+
+    std::string matched;  // consumed symbols, each followed by a space
+    std::vector<Step> steps;
+
+    std::string step(std::size_t i) const {
+        return matched.substr(0, steps[i].matched_length) + *steps[i].rhs;
+    }
+};
+
+// A Grammar compiled for the derivation modes. Nonterminals and terminal
+// values get integer ids, and every choice the derivation makes is resolved
+// once, here, instead of by scanning string productions per input symbol:
+//
+//   * `steps_` is a dense nonterminal x terminal table. Its entry holds the
+//     production to apply when that terminal is read, both for a symbol that
+//     is followed by more input and for the last symbol.
+//   * `skip_` / `finish_skip_` give, per nonterminal, the production that
+//     is applied without consuming input (A -> B, A -> ε B, and at the very
+//     end also A -> ε).
+//   * Each production's right-hand side is rendered once, raw and with
+//     terminal labels (T3) replaced by their values.
+//
+// derive() is then a linear walk, and gives the same steps the
+// string-matching derivation did.
+class DerivationIndex {
+public:
+    static DerivationIndex from(const Grammar& g);
+
+    // The derivation of `seq` from S, one step per production applied
+    // (consecutive equal forms are shown once).
+    Derivation derive(const std::vector<std::string>& seq) const;
+
+    std::size_t nonterminal_count() const { return skip_.size(); }
+    std::size_t terminal_count() const { return width_; }
+    // Rough heap footprint, for the api session's cache accounting.
+    std::size_t approximate_bytes() const;
+
+private:
+    static constexpr std::uint32_t kNone = 0xFFFFFFFFU;
+
+    struct Production {
+        std::string raw;   // right-hand side as written; empty unless shown
+        std::string text;  // right-hand side with terminal labels translated
+        // Nonterminal the derivation continues with; kNone when it ends.
+        std::uint32_t next{kNone};
+    };
+
+    // Productions that read one terminal from a nonterminal.
+    struct Step {
+        std::uint32_t more{kNone};  // for an input symbol that is not the last
+        std::uint32_t last{kNone};  // for the last input symbol
+    };
+
+    std::vector<Production> productions_;
+    std::unordered_map<std::string, std::uint32_t> terminals_;  // value -> column
+    std::vector<Step> steps_;            // row-major: steps_[nonterminal * width_ + column]
+    std::vector<std::uint32_t> skip_;         // per nonterminal; kNone when none applies
+    std::vector<std::uint32_t> finish_skip_;  // same, also allowing A -> ε
+    std::size_t width_{0};
+    std::uint32_t start_{kNone};
+};
+
+}  // namespace automata_security
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "utils/json_escape.hpp"
+
+namespace automata_security {
+
+// Output buffer for an api response. Modes append their JSON here instead of
+// formatting through streams and temporary strings: text is escaped straight
+// into one growable string, which is written out once per response. clear()
+// keeps the capacity, so a buffer reused across requests (serve mode) stops
+// allocating once it has grown to the largest response.
+class JsonBuffer {
+public:
+    // Append `text` as is.
+    JsonBuffer& raw(std::string_view text) {
+        buffer_.append(text);
+        return *this;
+    }
+    JsonBuffer& raw(char c) {
+        buffer_.push_back(c);
+        return *this;
+    }
+    // Append `text` escaped, without quotes.
+    JsonBuffer& escaped(std::string_view text) {
+        append_json_escaped(buffer_, text);
+        return *this;
+    }
+    // Append `text` as a quoted JSON string.
+    JsonBuffer& string(std::string_view text) {
+        append_json_string(buffer_, text);
+        return *this;
+    }
+    JsonBuffer& boolean(bool value) { return raw(value ? "true" : "false"); }
+
+    std::size_t size() const { return buffer_.size(); }
+    const std::string& str() const { return buffer_; }
+    void clear() { buffer_.clear(); }
+
+    // Write the buffered text to `out` and clear the buffer.
+    void flush_to(std::ostream& out) {
+        out.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
+    }
+
+private:
+    std::string buffer_;
+};
+
+}  // namespace automata_security
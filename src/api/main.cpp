@@ -6,219 +6,20 @@
 #include <fstream>
 #include <regex>
 #include <map>
-#include <deque>
 #include <set>
+#include <utility>
 
+#include "automata/interleaved_walk.hpp"
 #include "core.hpp"
+#include "json_buffer.hpp"
+#include "pda_simulator.hpp"
+#include "utils/line_tokenizer.hpp"
+#include "utils/mapped_file.hpp"
+#include "session.hpp"
 #include "utils.hpp"
 
 using namespace automata_security;
 
-// build_derivation_steps:
-// This function figures out the step-by-step "story" of how the grammar produces a specific sequence of inputs.
-// It starts with the start symbol 'S' and tries to find rules that match the input symbols one by one.
-static std::vector<std::string> build_derivation_steps(const Grammar& g, const std::vector<std::string>& seq) {
-    std::vector<std::string> derivation;
-    derivation.push_back("S"); // Start with the initial symbol.
-
-    std::string processed_prefix; // The part of the input we have already matched.
-    std::string current_nt = "S"; // The current non-terminal symbol we are trying to expand.
-
-    // Helper: Adds a line to the derivation history.
-    // It combines the already matched part (processed_prefix) with the current rule's right-hand side (rhs).
-    auto emit_rhs = [&](const std::vector<std::string>& prod, bool translate_terminals) {
-        std::string rhs;
-        for (size_t i = 0; i < prod.size(); ++i) {
-            if (i > 0) rhs += " ";
-            const auto& token = prod[i];
-            // If it's a terminal placeholder (like T_0), look up its real value (like "tcp").
-            if (translate_terminals && !token.empty() && token[0] == 'T' && g.terminals.count(token)) {
-                rhs += g.terminals.at(token);
-            } else {
-                rhs += token;
-            }
-        }
-        std::string line = processed_prefix + rhs;
-        // Only add if it's different from the last line (avoid duplicates).
-        if (derivation.back() != line) {
-            derivation.push_back(line);
-        }
-    };
-
-    // Helper: Records the application of a production rule.
-    // Sometimes we show the raw rule (with T_0) first, then the translated one (with "tcp").
-    auto append_production_steps = [&](const std::vector<std::string>& prod) {
-        bool needs_raw_step = !prod.empty() && !prod[0].empty() && prod[0][0] == 'T' && g.terminals.count(prod[0]);
-        if (needs_raw_step) emit_rhs(prod, false);
-        emit_rhs(prod, true);
-    };
-
-    // Helper: Tries to move forward in the grammar without consuming any input.
-    // This handles "unit productions" (A -> B) or "epsilon productions" (A -> ε).
-    auto advance_without_consuming = [&](bool allow_all_epsilon) {
-        bool expanded = false;
-        std::set<std::string> seen;
-        // Keep expanding as long as we have a current non-terminal.
-        while (!current_nt.empty()) {
-            if (seen.count(current_nt)) break; // Avoid infinite loops.
-            seen.insert(current_nt);
-
-            auto it = g.productions.find(current_nt);
-            if (it == g.productions.end()) break;
-
-            bool progressed = false;
-            for (const auto& prod : it->second) {
-                if (prod.empty()) continue;
-
-                // Case 1: Unit production (e.g., A -> B).
-                bool unit_nt = (prod.size() == 1 && g.productions.count(prod[0]));
-                if (unit_nt) {
-                    append_production_steps(prod);
-                    current_nt = prod[0]; // Move to the next non-terminal.
-                    progressed = expanded = true;
-                    break;
-                }
-
-                // Skip over epsilons (ε).
-                size_t idx = 0;
-                while (idx < prod.size() && prod[idx] == "ε") idx++;
-
-                // Case 2: Production starts with ε then a non-terminal (e.g., A -> ε B).
-                if (idx < prod.size() && g.productions.count(prod[idx])) {
-                    append_production_steps(prod);
-                    current_nt = prod[idx];
-                    progressed = expanded = true;
-                    break;
-                }
-
-                // Case 3: All epsilon (e.g., A -> ε).
-                // Only allowed if we are explicitly looking for it (usually at the end).
-                if (allow_all_epsilon) {
-                    bool all_eps = true;
-                    for (const auto& token : prod) {
-                        if (token != "ε") {
-                            all_eps = false;
-                            break;
-                        }
-                    }
-                    if (all_eps) {
-                        append_production_steps(prod);
-                        progressed = expanded = true;
-                        current_nt.clear(); // Nothing left to expand.
-                        break;
-                    }
-                }
-            }
-
-            if (!progressed) break;
-        }
-        return expanded;
-    };
-
-    // Initial expansion (handle start rules like S -> A).
-    advance_without_consuming(false);
-
-    // Loop through each symbol in the input sequence.
-    for (size_t seq_idx = 0; seq_idx < seq.size(); ++seq_idx) {
-        const auto& sym = seq[seq_idx];
-        bool is_last = (seq_idx == seq.size() - 1);
-
-        // Try to advance non-consuming rules again before processing the symbol.
-        advance_without_consuming(false);
-
-        auto prod_it = g.productions.find(current_nt);
-        if (prod_it == g.productions.end()) break;
-
-        struct Candidate {
-            const std::vector<std::string>* prod;
-            std::string next_nt;
-        };
-
-        // Find all production rules that could match the current symbol.
-        std::vector<Candidate> candidates;
-        for (const auto& prod : prod_it->second) {
-            if (prod.empty()) continue;
-
-            size_t idx = 0;
-            while (idx < prod.size() && prod[idx] == "ε") idx++;
-            if (idx >= prod.size()) continue;
-
-            const auto& token = prod[idx];
-            bool match = false;
-            std::string terminal_value;
-
-            // Check if the token matches the input symbol.
-            if (!token.empty() && token[0] == 'T' && g.terminals.count(token)) {
-                terminal_value = g.terminals.at(token);
-                match = (terminal_value == sym);
-            } else if (!g.productions.count(token)) {
-                terminal_value = token;
-                match = (terminal_value == sym);
-            } else {
-                // It's a non-terminal, so this rule doesn't start with a terminal. Skip.
-                continue;
-            }
-
-            if (!match) continue;
-
-            // Find the next non-terminal in this rule to continue the chain.
-            std::string next_nt;
-            for (size_t j = idx + 1; j < prod.size(); ++j) {
-                if (prod[j] == "ε") continue;
-                if (g.productions.count(prod[j])) {
-                    next_nt = prod[j];
-                    break;
-                }
-            }
-
-            candidates.push_back({&prod, next_nt});
-        }
-
-        // Select the best candidate rule.
-        const std::vector<std::string>* selected_prod = nullptr;
-        std::string selected_next_nt;
-        for (const auto& cand : candidates) {
-            // Heuristic: If it's the last symbol, prefer rules that finish (no next_nt).
-            // Otherwise, prefer rules that continue (have a next_nt).
-            if (is_last) {
-                if (cand.next_nt.empty()) {
-                    selected_prod = cand.prod;
-                    selected_next_nt = cand.next_nt;
-                    break;
-                }
-            } else {
-                if (!cand.next_nt.empty()) {
-                    selected_prod = cand.prod;
-                    selected_next_nt = cand.next_nt;
-                    break;
-                }
-            }
-        }
-
-        // Fallback: just pick the first one if no heuristic match.
-        if (!selected_prod && !candidates.empty()) {
-            selected_prod = candidates[0].prod;
-            selected_next_nt = candidates[0].next_nt;
-        }
-
-        if (!selected_prod) break; // No matching rule found.
-
-        // Apply the selected rule.
-        const auto& prod = *selected_prod;
-        append_production_steps(prod);
-
-        // Update state for the next iteration.
-        processed_prefix += sym + " ";
-        current_nt = selected_next_nt;
-        advance_without_consuming(false);
-    }
-
-    // Final cleanup: expand any remaining epsilon rules.
-    advance_without_consuming(true);
-
-    return derivation;
-}
-
 // build_pda_grammar_rules:
 // This function takes a PDA (Pushdown Automaton) and converts its logic into a set of grammar rules.
 // This is useful for visualizing the PDA's behavior as if it were a simple grammar.
@@ -323,15 +124,21 @@ static std::vector<std::string> build_pda_grammar_rules(const PDA& pda, const st
     return rules;
 }
 
-static void persist_rules_if_requested(const std::string& path, const std::vector<std::string>& lines) {
+static void persist_rules_if_requested(const std::string& path,
+                                       const std::vector<std::string>& lines,
+                                       ApiSession& session) {
     if (path.empty()) return;
-    std::ofstream out(path);
-    if (!out.is_open()) {
-        print_error("Failed to write grammar file: " + path);
-    }
-    for (const auto& line : lines) {
-        out << line << "\n";
+    {
+        std::ofstream out(path);
+        if (!out.is_open()) {
+            throw ApiError("Failed to write grammar file: " + path);
+        }
+        for (const auto& line : lines) {
+            out << line << "\n";
+        }
     }
+    // A cached copy of the file we just rewrote is stale.
+    session.invalidate(path);
 }
 
 // The JSON helpers, grammar loader and DOT/PDA parsers were moved to `utils.cpp`.
@@ -351,497 +158,620 @@ static void persist_rules_if_requested(const std::string& path, const std::vecto
 //  - dfa:    Load a DOT DFA and step through comma-separated symbols; emits
 //            a list of transitions (current_state, symbol, next_state) and a final
 //            is_malicious flag based on whether the final state is accepting.
-//  - pda:    Load a PDA (DOT) and simulate with explicit stack operations; returns
+//  - pda:    Load a PDA (DOT) and simulate it (see pda_simulator.hpp); returns
 //            a trace of PUSH/POP/NO_OP operations and whether the input is accepted.
+//  - dfa_batch: Score many sequences (one comma-separated sequence per line of
+//            --input-file or stdin) against a DOT DFA; prints one compact
+//            { final_state, is_malicious } line per sequence, without traces.
+//            dfa and dfa_batch take `--model FILE` (a binary model written by
+//            `generator --export-model`) in place of `--dot`.
+//  - serve:  Keep running and answer one request per stdin line (same flags as
+//            above, one JSON line per response), reusing loaded automata.
 //
 // The code below intentionally keeps parsing and JSON formatting code compact
 // so it can be run as a portable CLI by the Go backend (`Runner`) which expects
 // JSON output when `--json` is provided.
 // -----------------------------------------------------------------------------
 
-// --- PDA Simulation ---
-
-struct SimulationState {
-    size_t state_idx;
-    size_t input_idx;
-    std::vector<std::string> stack;
-    std::vector<PDAStep> trace;
+// Options of one api request. The one-shot CLI builds it from argv; serve
+// mode builds one per input line, starting from the server's own options.
+struct ApiRequest {
+    std::string mode;
+    std::string input;
+    std::string state;
+    std::string grammar_path = "grammar.txt";
+    std::string dot_path = "automaton.dot";
+    // Binary DFA model (generator --export-model); when set, the dfa modes use
+    // it instead of --dot.
+    std::string model_path;
+    // dfa_batch: newline-delimited sequences to score; empty or "-" is stdin.
+    std::string input_file;
+    // True for requests read by serve mode, whose stdin is the request stream.
+    bool from_server = false;
 };
 
-// simulate_pda: This function runs the Pushdown Automaton (PDA) simulation.
-// It explores all possible paths the machine can take (breadth-first search) to see if the input is valid.
-// If the input is valid, it returns the successful path (trace).
-// If not, it returns the path that got the furthest, to help show where it failed.
-PDATraceResult simulate_pda(const PDA& pda, const std::vector<std::string>& input) {
-    // We use a queue to manage the different paths we are exploring.
-    // Each item in the queue represents a "state" of the simulation:
-    // - Which control state we are in (e.g., "Start", "TCP_Established")
-    // - How much of the input we have processed so far
-    // - The current contents of the stack (memory)
-    // - The history of steps taken to get here
-    std::deque<SimulationState> queue;
-    
-    // Start the simulation at the PDA's start state, with 0 input processed, an empty stack, and no history.
-    queue.push_back({pda.start, 0, {}, {}});
-
-    size_t max_steps = 50000; // A safety limit to stop the simulation if it runs too long (infinite loop protection).
-    size_t steps_count = 0;
-
-    // We keep track of the "best" attempt so far.
-    // "Best" means the attempt that successfully processed the most input characters.
-    // This is useful for error reporting if the input is rejected.
-    size_t best_input_consumed = 0;
-    std::vector<PDAStep> best_trace;
-
-    // Keep processing states from the queue until there are none left or we hit the limit.
-    while(!queue.empty()) {
-        if (steps_count++ > max_steps) break; // Stop if we've done too much work.
-
-        // Get the next state to explore from the front of the queue.
-        SimulationState current = queue.front();
-        queue.pop_front();
-
-        // Check if this path has processed more input than our previous best.
-        // If so, remember it as the new best path.
-        if (current.input_idx > best_input_consumed) {
-            best_input_consumed = current.input_idx;
-            best_trace = current.trace;
+static ApiRequest parse_request(const std::vector<std::string>& args, ApiRequest request = {}) {
+    // Loop through all arguments passed to the program.
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& a = args[i];
+        // Check for flags like --mode, --input, etc. and store their values.
+        // Longer flags first: the checks match prefixes.
+        if (a.rfind("--model", 0) == 0) {
+            if (i + 1 < args.size()) request.model_path = args[++i];
+        } else if (a.rfind("--mode", 0) == 0) {
+            if (i + 1 < args.size()) request.mode = args[++i];
+        } else if (a.rfind("--input-file", 0) == 0) {
+            if (i + 1 < args.size()) request.input_file = args[++i];
+        } else if (a.rfind("--input", 0) == 0) {
+            if (i + 1 < args.size()) request.input = args[++i];
+        } else if (a.rfind("--state", 0) == 0) {
+            if (i + 1 < args.size()) request.state = args[++i];
+        } else if (a.rfind("--grammar", 0) == 0) {
+            if (i + 1 < args.size()) request.grammar_path = args[++i];
+        } else if (a.rfind("--dot", 0) == 0) {
+            if (i + 1 < args.size()) request.dot_path = args[++i];
+        } else if (a == "--json") {
+            // No-op, always JSON (we keep this for compatibility).
         }
+    }
+    return request;
+}
 
-        // Check if we have successfully finished:
-        // 1. We have processed all the input characters.
-        // 2. The current state is marked as an "accepting" state (valid end state).
-        if (current.input_idx == input.size() && pda.states[current.state_idx].accepting) {
-            // Success! Return true and the history of steps.
-            return {true, current.trace};
-        }
+static void write_string_array(JsonBuffer& out, const char* key, const std::vector<std::string>& values) {
+    out.raw("{ \"").raw(key).raw("\": [");
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) out.raw(", ");
+        out.string(values[i]);
+    }
+    out.raw("] }\n");
+}
 
-        // Get the details of the current control state we are in.
-        const auto& state = pda.states[current.state_idx];
-        
-        // Look at all the possible moves (transitions) allowed from this state.
-        for (const auto& trans : state.transitions) {
-            // Check if the input matches what this transition requires.
-            bool input_match = false;
-            bool consumes_input = false;
-
-            if (trans.input_symbol == "ε") {
-                // "ε" (epsilon) means this move doesn't require any input (it's automatic).
-                input_match = true;
-            } else if (current.input_idx < input.size() && trans.input_symbol == input[current.input_idx]) {
-                // The transition requires a specific symbol, and it matches the next one in our input.
-                input_match = true;
-                consumes_input = true; // This move will use up one input character.
-            }
+// `{ "steps": [...] }` for a derivation. The consumed input shared by the
+// steps is escaped once, piece by piece as it grows, and each step writes its
+// part of it plus the escaped right-hand side.
+static void write_derivation(JsonBuffer& out, const Derivation& derivation) {
+    std::string escaped;
+    size_t raw_done = 0;
+    out.raw("{ \"steps\": [");
+    for (size_t i = 0; i < derivation.steps.size(); ++i) {
+        const auto& step = derivation.steps[i];
+        if (step.matched_length > raw_done) {
+            append_json_escaped(escaped,
+                                std::string_view(derivation.matched).substr(raw_done, step.matched_length - raw_done));
+            raw_done = step.matched_length;
+        }
+        if (i > 0) out.raw(", ");
+        out.raw('"').raw(escaped).escaped(*step.rhs).raw('"');
+    }
+    out.raw("] }\n");
+}
 
-            if (!input_match) continue; // If input doesn't match, we can't take this path.
-
-            // Check if the stack matches what this transition requires.
-            // Some moves require popping a specific item from the top of the stack.
-            bool stack_match = false;
-            if (trans.pop_symbol == "ε") {
-                // "ε" means we don't need to pop anything.
-                stack_match = true;
-            } else if (!current.stack.empty() && current.stack.back() == trans.pop_symbol) {
-                // The top of the stack matches the required symbol.
-                stack_match = true;
-            }
+// Mode: graph
+// This mode reads a DOT file (which describes a graph) and converts it into JSON.
+// The frontend uses this JSON to draw the graph on the screen.
+static void run_graph(const ApiRequest& req, ApiSession& session, JsonBuffer& out) {
+    std::string err;
+    auto json = session.graph_json(req.dot_path, err);
+    if (!json) throw ApiError(err);
+    out.raw(*json).raw('\n');
+}
 
-            if (!stack_match) continue; // If stack doesn't match, we can't take this path.
+// Mode: grammar
+// Reads a grammar file and outputs it as a JSON list of rules.
+static void run_grammar(const ApiRequest& req, JsonBuffer& out) {
+    std::ifstream in(req.grammar_path);
+    if (!in.is_open()) {
+        throw ApiError("Failed to open grammar file: " + req.grammar_path);
+    }
 
-            // If we get here, this transition is valid!
-            // Create a new simulation state representing the result of taking this move.
-            SimulationState next = current;
-            next.state_idx = trans.next_state; // Move to the new control state.
-            if (consumes_input) next.input_idx++; // Advance input if we used a character.
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(in, line)) {
+        lines.push_back(line);
+    }
+    write_string_array(out, "rules", lines);
+}
 
-            // Perform the stack "POP" operation if required.
-            if (trans.pop_symbol != "ε") {
-                next.stack.pop_back(); // Remove the top item.
-            }
+// Mode: pda_grammar
+// Loads a PDA, converts its logic into grammar rules, and outputs them.
+static void run_pda_grammar(const ApiRequest& req, ApiSession& session, JsonBuffer& out) {
+    std::string err;
+    auto pda = session.pda(req.dot_path, err);
+    if (!pda) {
+        throw ApiError("Failed to load PDA from DOT: " + err);
+    }
 
-            // Perform the stack "PUSH" operation.
-            // We push symbols in reverse order so the first one ends up on top.
-            for (auto it = trans.push_symbols.rbegin(); it != trans.push_symbols.rend(); ++it) {
-                next.stack.push_back(*it);
-            }
+    auto rules = build_pda_grammar_rules(*pda, req.dot_path);
+    persist_rules_if_requested(req.grammar_path, rules, session);
+    write_string_array(out, "rules", rules);
+}
 
-            // Record this step in the history trace so we can show the user what happened.
-            PDAStep step;
-            step.current_state = state.name;
-            step.next_state = pda.states[trans.next_state].name;
-            step.symbol = consumes_input ? input[current.input_idx] : "ε";
-            step.stack_after = next.stack;
+// Mode: derivation
+// Takes a sequence of inputs and explains how the grammar produces them step-by-step.
+static void run_derivation(const ApiRequest& req, ApiSession& session, JsonBuffer& out) {
+    auto index = session.derivation_index(req.grammar_path);
+    if (!index) {
+        throw ApiError("Failed to load grammar");
+    }
 
-            // Label the operation type for the UI (PUSH, POP, or just moving).
-            if (!trans.push_symbols.empty()) step.op = "PUSH";
-            else if (trans.pop_symbol != "ε") step.op = "POP";
-            else step.op = "NO_OP";
+    // Parse the comma-separated input string into a list.
+    std::vector<std::string> seq;
+    std::stringstream ss(req.input);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        seq.push_back(trim(item));
+    }
 
-            next.trace.push_back(step);
+    // Calculate the derivation steps and output them as JSON.
+    write_derivation(out, index->derive(seq));
+}
 
-            // Add this new state to the queue to be explored later.
-            queue.push_back(next);
+// Mode: pda_derivation
+// Similar to derivation, but specifically for the PDA's grammar.
+static void run_pda_derivation(const ApiRequest& req, ApiSession& session, JsonBuffer& out) {
+    auto index = session.derivation_index(req.grammar_path);
+    if (!index && !req.dot_path.empty()) {
+        std::string err;
+        auto pda = session.pda(req.dot_path, err);
+        if (!pda) {
+            throw ApiError("Failed to load PDA for derivation: " + err);
         }
+        auto rules = build_pda_grammar_rules(*pda, req.dot_path);
+        persist_rules_if_requested(req.grammar_path, rules, session);
+        index = session.derivation_index(req.grammar_path);
     }
 
-    // If we empty the queue without finding a solution, the input is invalid.
-    // Return false, but provide the "best" trace we found to help debug.
-    return {false, best_trace};
-}
+    if (!index) {
+        throw ApiError("Failed to load PDA grammar for derivation");
+    }
 
-// main: The entry point of the program.
-// It reads command-line arguments to decide which mode to run.
-int main(int argc, char** argv) {
-    std::string mode;
-    std::string input;
-    std::string state;
-    std::string grammar_path = "grammar.txt";
-    std::string dot_path = "automaton.dot";
+    std::vector<std::string> seq;
+    std::stringstream iss(req.input);
+    std::string tok;
+    while (iss >> tok) seq.push_back(trim(tok));
 
-    // Loop through all arguments passed to the program.
-    for (int i = 1; i < argc; ++i) {
-        std::string a(argv[i]);
-        // Check for flags like --mode, --input, etc. and store their values.
-        if (a.rfind("--mode", 0) == 0) {
-            if (i + 1 < argc) mode = argv[++i];
-        } else if (a.rfind("--input", 0) == 0) {
-            if (i + 1 < argc) input = argv[++i];
-        } else if (a.rfind("--state", 0) == 0) {
-            if (i + 1 < argc) state = argv[++i];
-        } else if (a.rfind("--grammar", 0) == 0) {
-            if (i + 1 < argc) grammar_path = argv[++i];
-        } else if (a.rfind("--dot", 0) == 0) {
-            if (i + 1 < argc) dot_path = argv[++i];
-        } else if (a == "--json") {
-            // No-op, always JSON (we keep this for compatibility).
-        }
+    write_derivation(out, index->derive(seq));
+}
+
+// DfaModel seen through the FrozenGrammarDFA interface, so the dfa modes
+// can walk either one. States are named `s<i>` as in the generator's DOT.
+class ModelAutomaton {
+public:
+    explicit ModelAutomaton(const DfaModel& model) : model_(model) {}
+
+    std::uint32_t column(std::string_view label) const { return model_.column(label); }
+    std::uint32_t step(std::uint32_t state, std::uint32_t column) const { return model_.step(state, column); }
+    bool accepting(std::uint32_t state) const { return model_.accepting(state); }
+    std::uint32_t start() const { return model_.start_state(); }
+    std::size_t state_count() const { return model_.state_count(); }
+    std::size_t width() const { return model_.symbol_count(); }
+    std::string name(std::uint32_t state) const { return "s" + std::to_string(state); }
+    std::uint32_t find_state(const std::string& name) const {
+        const auto unknown = static_cast<std::uint32_t>(state_count());
+        if (name.size() < 2 || name[0] != 's' || name.size() > 11) return unknown;
+        if (name.find_first_not_of("0123456789", 1) != std::string::npos) return unknown;
+        if (name.size() > 2 && name[1] == '0') return unknown;
+        const auto state = std::stoull(name.substr(1));
+        return state < state_count() ? static_cast<std::uint32_t>(state) : unknown;
     }
 
-    // Mode: graph
-    // This mode reads a DOT file (which describes a graph) and converts it into JSON.
-    // The frontend uses this JSON to draw the graph on the screen.
-    if (mode == "graph") {
-        std::ifstream in(dot_path);
-        if (!in.is_open()) print_error("Failed to open DOT file: " + dot_path);
-
-        std::vector<std::string> nodes_json;
-        std::vector<std::string> edges_json;
-        std::string start_node;
-        std::string line;
-
-        // Read the file line by line.
-        while (std::getline(in, line)) {
-            // Clean up whitespace.
-            line.erase(0, line.find_first_not_of(" \t"));
-            line.erase(line.find_last_not_of(" \t") + 1);
-
-            // Look for the special start marker (e.g., "__start -> s0").
-            if (line.find("__start ->") == 0) {
-                size_t arrow = line.find("->");
-                size_t semi = line.find(";");
-                if (arrow != std::string::npos && semi != std::string::npos) {
-                    start_node = line.substr(arrow + 2, semi - (arrow + 2));
-                    start_node.erase(0, start_node.find_first_not_of(" \t"));
-                    start_node.erase(start_node.find_last_not_of(" \t") + 1);
-                }
+private:
+    const DfaModel& model_;
+};
 
-            // Look for edges (connections between nodes), e.g., "s0 -> s1".
-            } else if (line.find("->") != std::string::npos) {
-                if (line.find("__start") == 0) continue; // Skip the start marker line itself.
-
-                size_t arrow = line.find("->");
-                size_t bracket = line.find("[");
-                size_t label_pos = line.find("label=\"");
-
-                // If it looks like a valid edge with a label...
-                if (arrow != std::string::npos && bracket != std::string::npos && label_pos != std::string::npos) {
-                    // Extract the source and target node names.
-                    std::string src = line.substr(0, arrow);
-                    std::string tgt = line.substr(arrow + 2, bracket - (arrow + 2));
-
-                    // Clean up names.
-                    src.erase(0, src.find_first_not_of(" \t"));
-                    src.erase(src.find_last_not_of(" \t") + 1);
-                    tgt.erase(0, tgt.find_first_not_of(" \t"));
-                    tgt.erase(tgt.find_last_not_of(" \t") + 1);
-
-                    // Extract the label text (what is written on the arrow).
-                    size_t label_end = line.find("\"", label_pos + 7);
-                    std::string lbl = line.substr(label_pos + 7, label_end - (label_pos + 7));
-
-                    // Format as a JSON object for the edge.
-                    std::ostringstream e;
-                    e << "{ \"source\": \"" << json_escape(src) << "\", ";
-                    e << "\"target\": \"" << json_escape(tgt) << "\", ";
-                    e << "\"label\": \"" << json_escape(lbl) << "\" }";
-                    edges_json.push_back(e.str());
-                }
+static std::shared_ptr<const DfaModel> load_model(const ApiRequest& req, ApiSession& session) {
+    std::string err;
+    auto model = session.model(req.model_path, err);
+    if (!model) {
+        throw ApiError("Failed to load DFA model: " + err);
+    }
+    return model;
+}
 
-            // Look for node definitions, e.g., "s0 [label=...]".
-            } else if (line.find("[") != std::string::npos && line.find("label=") != std::string::npos) {
-                if (line.find("__start") == 0) continue;
-                if (line.find("node [") == 0) continue;
-
-                size_t bracket = line.find("[");
-                std::string id = line.substr(0, bracket);
-                id.erase(0, id.find_first_not_of(" \t"));
-                id.erase(id.find_last_not_of(" \t") + 1);
-
-                size_t label_pos = line.find("label=\"");
-                if (label_pos != std::string::npos) {
-                    size_t label_end = line.find("\"", label_pos + 7);
-                    std::string label_raw = line.substr(label_pos + 7, label_end - (label_pos + 7));
-                    // Take only the first line of the label.
-                    std::string label = label_raw.substr(0, label_raw.find("\\n"));
-
-                    // Check if it's an accepting state (marked by doublecircle).
-                    bool is_accepting = line.find("doublecircle") != std::string::npos;
-
-                    // Format as a JSON object for the node.
-                    std::ostringstream n;
-                    n << "{ \"id\": \"" << json_escape(id) << "\", ";
-                    n << "\"label\": \"" << json_escape(label) << "\", ";
-                    n << "\"is_accepting\": " << (is_accepting ? "true" : "false") << ", ";
-                    n << "\"is_start\": " << (id == start_node ? "true" : "false") << " }";
-                    nodes_json.push_back(n.str());
-                }
-            }
-        }
+// `--state` if given, else the start state.
+template <typename Automaton>
+static std::uint32_t initial_state(const Automaton& dfa, const ApiRequest& req) {
+    if (req.state.empty()) return dfa.start();
+    const std::uint32_t state = dfa.find_state(req.state);
+    if (state == dfa.state_count()) throw ApiError("Unknown state: " + req.state);
+    return state;
+}
 
-        // Ensure the start node is correctly marked in the JSON list.
-        if (!start_node.empty()) {
-             for (auto& n : nodes_json) {
-                 if (n.find("\"id\": \"" + start_node + "\"") != std::string::npos) {
-                     size_t pos = n.find("\"is_start\": false");
-                     if (pos != std::string::npos) {
-                         n.replace(pos, 17, "\"is_start\": true");
-                     }
-                 }
-             }
-        }
+// The `final_state`, `is_malicious` and `label` fields that close a dfa
+// response.
+static void write_verdict(JsonBuffer& out, const std::string& final_state, bool is_malicious) {
+    out.raw("], \"final_state\": ").string(final_state).raw(", ");
+    out.raw("\"is_malicious\": ").boolean(is_malicious).raw(", ");
+    out.raw("\"label\": \"").raw(is_malicious ? "Malicious" : "Benign").raw("\" }\n");
+}
 
-        // Output the final JSON structure containing nodes and edges.
-        std::cout << "{ \"nodes\": [";
-        for (size_t i = 0; i < nodes_json.size(); ++i) {
-            if (i > 0) std::cout << ", ";
-            std::cout << nodes_json[i];
-        }
-        std::cout << "], \"edges\": [";
-        for (size_t i = 0; i < edges_json.size(); ++i) {
-            if (i > 0) std::cout << ", ";
-            std::cout << edges_json[i];
-        }
-        std::cout << "] }" << std::endl;
+// `--mode dfa` on a binary model; same response as run_dfa gives for the
+// DOT export of that model.
+static void run_model_dfa(const ApiRequest& req, ApiSession& session, JsonBuffer& out) {
+    auto model = load_model(req, session);
+    const ModelAutomaton dfa(*model);
+    std::uint32_t cur = initial_state(dfa, req);
+
+    std::vector<std::string> seq;
+    std::stringstream ss(req.input);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        seq.push_back(trim(item));
+    }
 
+    out.raw("{ \"steps\": [");
+    bool first_step = true;
+    for (const auto& sym : seq) {
+        if (!first_step) out.raw(", ");
+        first_step = false;
+        out.raw("{ \"current_state\": ").string(dfa.name(cur)).raw(", ");
+        cur = dfa.step(cur, dfa.column(sym));
+        out.raw("\"symbol\": ").string(sym).raw(", ");
+        out.raw("\"next_state\": ").string(dfa.name(cur)).raw(" }");
     }
-    // Mode: grammar
-    // Reads a grammar file and outputs it as a JSON list of rules.
-    else if (mode == "grammar") {
-        std::ifstream in(grammar_path);
-        if (!in.is_open()) {
-            print_error("Failed to open grammar file: " + grammar_path);
-        }
 
-        std::vector<std::string> lines;
-        std::string line;
-        while (std::getline(in, line)) {
-            lines.push_back(line);
-        }
+    write_verdict(out, dfa.name(cur), dfa.accepting(cur));
+}
 
-        std::cout << "{ \"rules\": [";
-        for (size_t i = 0; i < lines.size(); ++i) {
-            if (i > 0) std::cout << ", ";
-            std::cout << "\"" << json_escape(lines[i]) << "\"";
-        }
-        std::cout << "] }" << std::endl;
+// Mode: dfa
+// Simulates a Deterministic Finite Automaton (DFA).
+// It steps through the input symbols one by one and tracks the state changes.
+static void run_dfa(const ApiRequest& req, ApiSession& session, JsonBuffer& out) {
+    if (!req.model_path.empty()) {
+        run_model_dfa(req, session, out);
+        return;
+    }
+    std::string err;
+    auto loaded = session.dfa(req.dot_path, err);
+    if (!loaded) {
+        throw ApiError("Failed to load DFA from DOT: " + err);
+    }
+    const GrammarDFA& gdfa = *loaded;
+
+    // If no start state is given, use the default one.
+    std::string state = req.state;
+    if (state.empty()) state = gdfa.names[gdfa.start];
+
+    // Parse input.
+    std::vector<std::string> seq;
+    std::stringstream ss(req.input);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        seq.push_back(trim(item));
     }
-    // Mode: pda_grammar
-    // Loads a PDA, converts its logic into grammar rules, and outputs them.
-    else if (mode == "pda_grammar") {
-        PDA pda;
-        std::string err;
-        if (!load_dot_pda(dot_path, pda, err)) {
-            print_error("Failed to load PDA from DOT: " + err);
-        }
-
-        auto rules = build_pda_grammar_rules(pda, dot_path);
-        persist_rules_if_requested(grammar_path, rules);
 
-        std::cout << "{ \"rules\": [";
-        for (size_t i = 0; i < rules.size(); ++i) {
-            if (i > 0) std::cout << ", ";
-            std::cout << "\"" << json_escape(rules[i]) << "\"";
-        }
-        std::cout << "] }" << std::endl;
-    }
-    // Mode: derivation
-    // Takes a sequence of inputs and explains how the grammar produces them step-by-step.
-    else if (mode == "derivation") {
-        Grammar g;
-        if (!load_grammar_for_derivation(grammar_path, g)) {
-            print_error("Failed to load grammar");
-        }
+    // Find the starting state index.
+    auto start_it = gdfa.idx.find(state);
+    if (start_it == gdfa.idx.end()) {
+        throw ApiError("Unknown state: " + state);
+    }
+    size_t cur_idx = start_it->second;
 
-        // Parse the comma-separated input string into a list.
-        std::vector<std::string> seq;
-        std::stringstream ss(input);
-        std::string item;
-        while (std::getline(ss, item, ',')) {
-            seq.push_back(trim(item));
-        }
+    out.raw("{ \"steps\": [");
+    bool first_step = true;
 
-        // Calculate the derivation steps.
-        auto derivation = build_derivation_steps(g, seq);
+    // Process each symbol in the sequence.
+    for (const auto& sym : seq) {
+        if (!first_step) out.raw(", ");
+        first_step = false;
 
-        // Output the steps as JSON.
-        std::cout << "{ \"steps\": [";
-        for (size_t i = 0; i < derivation.size(); ++i) {
-            if (i > 0) std::cout << ", ";
-            std::cout << "\"" << json_escape(derivation[i]) << "\"";
-        }
-        std::cout << "] }" << std::endl;
-
-    }
-    // Mode: pda_derivation
-    // Similar to derivation, but specifically for the PDA's grammar.
-    else if (mode == "pda_derivation") {
-        Grammar g;
-        bool loaded = load_grammar_for_derivation(grammar_path, g);
-        if (!loaded && !dot_path.empty()) {
-            PDA pda;
-            std::string err;
-            if (!load_dot_pda(dot_path, pda, err)) {
-                print_error("Failed to load PDA for derivation: " + err);
-            }
-            auto rules = build_pda_grammar_rules(pda, dot_path);
-            persist_rules_if_requested(grammar_path, rules);
-            loaded = load_grammar_for_derivation(grammar_path, g);
-        }
+        out.raw("{ \"current_state\": ").string(gdfa.names[cur_idx]).raw(", ");
 
-        if (!loaded) {
-            print_error("Failed to load PDA grammar for derivation");
+        // Check if there is a valid transition for this symbol. If there is
+        // none, stay in the same state (visualizer behavior).
+        auto it = gdfa.trans[cur_idx].find(sym);
+        if (it != gdfa.trans[cur_idx].end()) {
+            cur_idx = it->second; // Move to the next state.
         }
 
-        std::vector<std::string> seq;
-        std::stringstream iss(input);
-        std::string tok;
-        while (iss >> tok) seq.push_back(trim(tok));
+        // Output the rest of the step.
+        out.raw("\"symbol\": ").string(sym).raw(", ");
+        out.raw("\"next_state\": ").string(gdfa.names[cur_idx]).raw(" }");
+    }
 
-        auto derivation = build_derivation_steps(g, seq);
+    // Check if the final state is "accepting" (malicious).
+    write_verdict(out, gdfa.names[cur_idx], gdfa.accepting[cur_idx]);
+}
 
-        std::cout << "{ \"steps\": [";
-        for (size_t i = 0; i < derivation.size(); ++i) {
-            if (i > 0) std::cout << ", ";
-            std::cout << "\"" << json_escape(derivation[i]) << "\"";
-        }
-        std::cout << "] }" << std::endl;
+// Mode: pda
+// Simulates a Pushdown Automaton (PDA).
+// It uses the simulate_pda function to check if the input is valid.
+static void run_pda(const ApiRequest& req, ApiSession& session, JsonBuffer& out) {
+    // Load the PDA definition.
+    std::string err;
+    auto pda = session.pda(req.dot_path, err);
+    if (!pda) {
+        throw ApiError("Failed to load PDA from DOT: " + err);
+    }
 
+    // Parse input (space-separated).
+    std::vector<std::string> seq;
+    std::stringstream iss(req.input);
+    std::string tok;
+    while (iss >> tok) seq.push_back(tok);
+
+    // Run the simulation.
+    PDATraceResult res = simulate_pda(*pda, seq);
+
+    // Output the result (valid/invalid) and the trace of steps.
+    out.raw("{ \"valid\": ").boolean(res.ok).raw(", \"steps\": [");
+    for (size_t i = 0; i < res.steps.size(); ++i) {
+        if (i > 0) out.raw(", ");
+        const auto& step = res.steps[i];
+        out.raw("{ \"op\": ").string(step.op).raw(", ");
+        out.raw("\"symbol\": ").string(step.symbol).raw(", ");
+        out.raw("\"stack\": [");
+        for (size_t j = 0; j < step.stack_after.size(); ++j) {
+            if (j > 0) out.raw(", ");
+            out.string(step.stack_after[j]);
+        }
+        out.raw("], \"current_state\": ").string(step.current_state).raw(", ");
+        out.raw("\"next_state\": ").string(step.next_state).raw(" }");
     }
-    // Mode: dfa
-    // Simulates a Deterministic Finite Automaton (DFA).
-    // It steps through the input symbols one by one and tracks the state changes.
-    else if (mode == "dfa") {
-        GrammarDFA gdfa;
-        std::string err;
-        if (!load_dot_dfa(dot_path, gdfa, err)) {
-            print_error("Failed to load DFA from DOT: " + err);
-        }
+    out.raw("] }\n");
+}
 
-        // If no start state is given, use the default one.
-        if (state.empty()) state = gdfa.names[gdfa.start];
-        
-        // Parse input.
-        std::vector<std::string> seq;
-        std::stringstream ss(input);
-        std::string item;
-        while (std::getline(ss, item, ',')) {
-            seq.push_back(trim(item));
-        }
-        
-        // Find the starting state index.
-        size_t cur_idx = 0;
-        if (gdfa.idx.find(state) != gdfa.idx.end()) {
-            cur_idx = gdfa.idx[state];
-        } else {
-            print_error("Unknown state: " + state);
-        }
+// Call `on_line` for every line of `path` (or of stdin when `path` is empty or
+// "-"). Files are memory-mapped; stdin is read in large blocks. Lines are
+// string_views without the '\n' and are only valid during the call.
+template <typename OnLine>
+static void for_each_input_line(const std::string& path, const OnLine& on_line) {
+    if (!path.empty() && path != "-") {
+        std::unique_ptr<MappedFile> file;
+        try {
+            file = std::make_unique<MappedFile>(path);
+        } catch (const std::exception& ex) {
+            throw ApiError("Failed to open input file: " + path + " (" + ex.what() + ")");
+        }
+        LineCursor lines(file->view());
+        std::string_view line;
+        while (lines.next(line)) on_line(line);
+        return;
+    }
 
-        std::cout << "{ \"steps\": [";
-        bool first_step = true;
+    std::string buffer;
+    std::vector<char> block(1 << 16);
+    while (std::cin.read(block.data(), static_cast<std::streamsize>(block.size())) || std::cin.gcount() > 0) {
+        buffer.append(block.data(), static_cast<size_t>(std::cin.gcount()));
+        // Hand out every complete line; keep the partial tail for the next block.
+        size_t begin = 0;
+        for (size_t nl = buffer.find('\n'); nl != std::string::npos; nl = buffer.find('\n', begin)) {
+            on_line(std::string_view(buffer.data() + begin, nl - begin));
+            begin = nl + 1;
+        }
+        buffer.erase(0, begin);
+    }
+    if (!buffer.empty()) on_line(std::string_view(buffer));
+}
 
-        // Process each symbol in the sequence.
-        for (const auto& sym : seq) {
-            if (!first_step) std::cout << ", ";
-            first_step = false;
+static std::string_view trim_view(std::string_view s) {
+    auto a = s.find_first_not_of(" \t\r\n");
+    if (a == std::string_view::npos) return {};
+    auto b = s.find_last_not_of(" \t\r\n");
+    return s.substr(a, b - a + 1);
+}
 
-            std::string current_state_name = gdfa.names[cur_idx];
-            std::string next_state_name;
+// Mode: dfa_batch
+// Bulk scoring: every input line is one comma-separated sequence (as for
+// `--mode dfa --input`), answered by one line with only the verdict:
+//   { "final_state": "s2", "is_malicious": true }
+// Symbols are looked up once per token in the frozen table and the walk is
+// integer-only; no per-step trace is built. Lines are walked kDfaBatchLines at
+// a time, interleaved (walk_interleaved()) when worth_interleaving() says so,
+// and answered in input order. The answers are written to stdout whenever
+// kDfaBatchOutputBytes have collected, so a day of logs is never held in
+// memory (dfa_batch is one-shot only; an error part way through follows the
+// lines already written).
+constexpr size_t kDfaBatchLines = 256;
+constexpr size_t kDfaBatchOutputBytes = 64 * 1024;
+
+template <typename Automaton>
+static void classify_lines(const Automaton& dfa, const ApiRequest& req, JsonBuffer& out) {
+    const std::uint32_t start = initial_state(dfa, req);
+
+    // Verdict lines only depend on the final state; render each one once.
+    std::vector<std::string> verdicts(dfa.state_count());
+    JsonBuffer verdict;
+    for (std::uint32_t s = 0; s < verdicts.size(); ++s) {
+        verdict.clear();
+        verdict.raw("{ \"final_state\": ").string(dfa.name(s));
+        verdict.raw(", \"is_malicious\": ").boolean(dfa.accepting(s)).raw(" }\n");
+        verdicts[s] = verdict.str();
+    }
 
-            // Check if there is a valid transition for this symbol.
-            auto it = gdfa.trans[cur_idx].find(sym);
-            if (it != gdfa.trans[cur_idx].end()) {
-                cur_idx = it->second; // Move to the next state.
-                next_state_name = gdfa.names[cur_idx];
-            } else {
-                // No transition found: stay in the same state (visualizer behavior).
-                next_state_name = current_state_name; 
+    // Columns of the pending lines back to back; line i is
+    // columns[offsets[i], offsets[i + 1]).
+    std::vector<std::uint32_t> columns;
+    std::vector<size_t> offsets{0};
+    std::vector<std::uint32_t> finals(kDfaBatchLines);
+    auto flush_batch = [&]() {
+        const size_t lines = offsets.size() - 1;
+        const size_t table_bytes = dfa.state_count() * dfa.width() * sizeof(std::uint32_t);
+        if (!worth_interleaving(table_bytes, columns.size(), lines)) {
+            for (size_t i = 0; i < lines; ++i) {
+                std::uint32_t cur = start;
+                for (size_t c = offsets[i]; c < offsets[i + 1]; ++c) cur = dfa.step(cur, columns[c]);
+                finals[i] = cur;
             }
+        } else {
+            walk_interleaved<std::uint32_t>(
+                lines,
+                start,
+                [&](size_t i) {
+                    return std::make_pair(columns.data() + offsets[i], columns.data() + offsets[i + 1]);
+                },
+                [&](std::uint32_t state, std::uint32_t column) { return dfa.step(state, column); },
+                [&](size_t i, std::uint32_t state) { finals[i] = state; });
+        }
+        for (size_t i = 0; i < lines; ++i) {
+            out.raw(verdicts[finals[i]]);
+        }
+        if (out.size() >= kDfaBatchOutputBytes) out.flush_to(std::cout);
+        columns.clear();
+        offsets.resize(1);
+    };
 
-            // Output the step details.
-            std::cout << "{ \"current_state\": \"" << json_escape(current_state_name) << "\", ";
-            std::cout << "\"symbol\": \"" << json_escape(sym) << "\", ";
-            std::cout << "\"next_state\": \"" << json_escape(next_state_name) << "\" }";
-        }
+    for_each_input_line(req.input_file, [&](std::string_view line) {
+        // Tokens split like getline(ss, item, ','): a trailing comma (or an
+        // empty line) adds no empty symbol.
+        size_t begin = 0;
+        while (begin < line.size()) {
+            size_t comma = line.find(',', begin);
+            if (comma == std::string_view::npos) comma = line.size();
+            columns.push_back(dfa.column(trim_view(line.substr(begin, comma - begin))));
+            begin = comma + 1;
+        }
+        offsets.push_back(columns.size());
+        if (offsets.size() > kDfaBatchLines) flush_batch();
+    });
+    flush_batch();
+}
+
+static void run_dfa_batch(const ApiRequest& req, ApiSession& session, JsonBuffer& out) {
+    if (req.from_server) {
+        // Serve mode answers every request with exactly one line.
+        throw ApiError("dfa_batch is not available in serve mode");
+    }
 
-        // Check if the final state is "accepting" (malicious).
-        bool is_malicious = gdfa.accepting[cur_idx];
-        
-        std::cout << "], \"final_state\": \"" << json_escape(gdfa.names[cur_idx]) << "\", ";
-        std::cout << "\"is_malicious\": " << (is_malicious ? "true" : "false") << ", ";
-        std::cout << "\"label\": \"" << (is_malicious ? "Malicious" : "Benign") << "\" }" << std::endl;
+    if (!req.model_path.empty()) {
+        auto model = load_model(req, session);
+        classify_lines(ModelAutomaton(*model), req, out);
+        return;
+    }
 
+    std::string err;
+    auto dfa = session.frozen_dfa(req.dot_path, err);
+    if (!dfa) {
+        throw ApiError("Failed to load DFA from DOT: " + err);
     }
-    // Mode: pda
-    // Simulates a Pushdown Automaton (PDA).
-    // It uses the simulate_pda function to check if the input is valid.
-    else if (mode == "pda") {
-        // Load the PDA definition.
-        PDA pda;
-        std::string err;
-        if (!load_dot_pda(dot_path, pda, err)) {
-            print_error("Failed to load PDA from DOT: " + err);
+    classify_lines(*dfa, req, out);
+}
+
+// Run one request, writing its JSON response (one line) to `out`. Throws
+// ApiError on failure.
+static void run_request(const ApiRequest& req, ApiSession& session, JsonBuffer& out) {
+    if (req.mode == "graph") {
+        run_graph(req, session, out);
+    } else if (req.mode == "grammar") {
+        run_grammar(req, out);
+    } else if (req.mode == "pda_grammar") {
+        run_pda_grammar(req, session, out);
+    } else if (req.mode == "derivation") {
+        run_derivation(req, session, out);
+    } else if (req.mode == "pda_derivation") {
+        run_pda_derivation(req, session, out);
+    } else if (req.mode == "dfa") {
+        run_dfa(req, session, out);
+    } else if (req.mode == "pda") {
+        run_pda(req, session, out);
+    } else if (req.mode == "dfa_batch") {
+        run_dfa_batch(req, session, out);
+    } else {
+        throw ApiError("Unknown mode: " + req.mode);
+    }
+}
+
+// Split a serve-mode request line into argv-style words. Words are separated
+// by whitespace; double quotes group a word (so `--input "a b c"` works for
+// space-separated PDA input) and a backslash escapes the next character.
+static std::vector<std::string> split_request_line(const std::string& line) {
+    std::vector<std::string> words;
+    std::string current;
+    bool in_word = false;
+    bool in_quotes = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (c == '\\' && i + 1 < line.size()) {
+            current.push_back(line[++i]);
+            in_word = true;
+        } else if (c == '"') {
+            in_quotes = !in_quotes;
+            in_word = true;
+        } else if (!in_quotes && (c == ' ' || c == '\t' || c == '\r')) {
+            if (in_word) words.push_back(current);
+            current.clear();
+            in_word = false;
+        } else {
+            current.push_back(c);
+            in_word = true;
         }
+    }
+    if (in_word) words.push_back(current);
+    return words;
+}
+
+// Mode: serve
+// Long-running mode for the backend: each stdin line is one request with the
+// same flags as the CLI (e.g. `--mode dfa --input "proto=tcp,state=S0"`);
+// flags not given on the line default to the ones `serve` was started with.
+// Each request gets exactly one line on stdout with the JSON the one-shot CLI
+// would print, errors included, and the output is flushed per response.
+// Loaded automata are kept across requests (reloaded when their file changes,
+// bounded by --cache-mb). Blank lines are ignored and
+// `quit` (or end of input) stops the server.
+static int serve(const ApiRequest& defaults, ApiSession& session) {
+    std::string line;
+    // One buffer for every response, so it stops growing after the largest.
+    JsonBuffer response;
+    while (std::getline(std::cin, line)) {
+        auto words = split_request_line(line);
+        if (words.empty()) continue;
+        if (words.size() == 1 && words[0] == "quit") break;
+
+        ApiRequest req = parse_request(words, defaults);
+        req.from_server = true;
+        response.clear();
+        try {
+            if (req.mode == "serve") throw ApiError("Nested serve mode is not supported");
+            run_request(req, session, response);
+            response.flush_to(std::cout);
+        } catch (const ApiError& ex) {
+            write_error(std::cout, ex.what());
+        } catch (const std::exception& ex) {
+            // Anything else (a loader's runtime_error, bad_alloc) fails only
+            // this request; the server keeps answering.
+            write_error(std::cout, ex.what());
+        }
+        std::cout.flush();
+    }
+    return 0;
+}
 
-        // Parse input (space-separated).
-        std::vector<std::string> seq;
-        std::stringstream iss(input);
-        std::string tok;
-        while (iss >> tok) seq.push_back(tok);
-
-        // Run the simulation.
-        PDATraceResult res = simulate_pda(pda, seq);
-
-        // Output the result (valid/invalid) and the trace of steps.
-        std::cout << "{ \"valid\": " << (res.ok ? "true" : "false") << ", \"steps\": [";
-        for (size_t i = 0; i < res.steps.size(); ++i) {
-            if (i > 0) std::cout << ", ";
-            const auto& step = res.steps[i];
-            std::cout << "{ \"op\": \"" << json_escape(step.op) << "\", ";
-            std::cout << "\"symbol\": \"" << json_escape(step.symbol) << "\", ";
-            std::cout << "\"stack\": [";
-            for (size_t j = 0; j < step.stack_after.size(); ++j) {
-                if (j > 0) std::cout << ", ";
-                std::cout << "\"" << json_escape(step.stack_after[j]) << "\"";
+// main: The entry point of the program.
+// It reads command-line arguments to decide which mode to run.
+int main(int argc, char** argv) {
+    ApiRequest req = parse_request(std::vector<std::string>(argv + 1, argv + argc));
+
+    // --cache-mb N caps the estimated memory kept by loaded automata (mostly
+    // relevant to serve mode); 0 disables caching.
+    std::size_t cache_bytes = ApiSession::kDefaultCacheBytes;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::string(argv[i]) == "--cache-mb") {
+            try {
+                cache_bytes = static_cast<std::size_t>(std::stoull(argv[i + 1])) << 20;
+            } catch (const std::exception&) {
+                print_error(std::string("Invalid --cache-mb value: ") + argv[i + 1]);
             }
-            std::cout << "], \"current_state\": \"" << json_escape(step.current_state) << "\", ";
-            std::cout << "\"next_state\": \"" << json_escape(step.next_state) << "\" }";
         }
-        std::cout << "] }" << std::endl;
+    }
+    ApiSession session(cache_bytes);
 
-    } else {
-        print_error("Unknown mode: " + mode);
+    if (req.mode == "serve") {
+        ApiRequest defaults = req;
+        defaults.mode.clear();
+        return serve(defaults, session);
     }
 
+    // The response is built in memory so a failing request prints only the
+    // error object.
+    JsonBuffer response;
+    try {
+        run_request(req, session, response);
+    } catch (const ApiError& ex) {
+        print_error(ex.what());
+    } catch (const std::exception& ex) {
+        print_error(ex.what());
+    }
+    response.flush_to(std::cout);
     return 0;
 }
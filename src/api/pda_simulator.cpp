@@ -0,0 +1,308 @@
+#include "pda_simulator.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+namespace automata_security {
+
+namespace {
+
+constexpr uint32_t kEpsilon = numeric_limits<uint32_t>::max();
+constexpr uint32_t kNone = numeric_limits<uint32_t>::max();
+
+// Strings of one simulation (input, pop and push symbols) as dense ids, so
+// matching a transition is an integer compare.
+class SymbolIds {
+public:
+    // An input or pop symbol; "ε" there means none and is kEpsilon.
+    uint32_t intern(const string& s) {
+        if (s == "ε") return kEpsilon;
+        return intern_name(s);
+    }
+    // A pushed symbol. "ε" in a push list is pushed like any other name,
+    // so it always gets a real id that name() can look up.
+    uint32_t intern_name(const string& s) {
+        auto [it, inserted] = ids_.emplace(s, static_cast<uint32_t>(names_.size()));
+        if (inserted) names_.push_back(&it->first);
+        return it->second;
+    }
+    const string& name(uint32_t id) const { return *names_[id]; }
+
+private:
+    unordered_map<string, uint32_t> ids_;
+    vector<const string*> names_;
+};
+
+struct CompiledTransition {
+    uint32_t input;
+    uint32_t pop;
+    vector<uint32_t> push;  // pushed in this order; the last one ends on top
+    uint32_t next_state;
+    const char* op;
+};
+
+// Hash-consed persistent stacks. Stack 0 is the empty stack; every other id
+// is a symbol on top of an older stack, and pushing the same symbol on the
+// same stack always returns the same id.
+class StackPool {
+public:
+    StackPool() : nodes_{{kNone, 0, 0}} {}
+
+    uint32_t push(uint32_t below, uint32_t symbol) {
+        const uint64_t key = (static_cast<uint64_t>(below) << 32) | symbol;
+        auto [it, inserted] = index_.emplace(key, static_cast<uint32_t>(nodes_.size()));
+        if (inserted) nodes_.push_back({symbol, below, nodes_[below].depth + 1});
+        return it->second;
+    }
+    uint32_t top(uint32_t stack) const { return nodes_[stack].symbol; }
+    uint32_t below(uint32_t stack) const { return nodes_[stack].below; }
+    uint32_t depth(uint32_t stack) const { return nodes_[stack].depth; }
+
+    // Bottom first, like the old vector stacks.
+    vector<string> contents(uint32_t stack, const SymbolIds& symbols) const {
+        vector<string> out(nodes_[stack].depth);
+        for (size_t i = out.size(); i > 0; --i, stack = nodes_[stack].below) {
+            out[i - 1] = symbols.name(nodes_[stack].symbol);
+        }
+        return out;
+    }
+
+private:
+    struct Node {
+        uint32_t symbol;
+        uint32_t below;
+        uint32_t depth;
+    };
+    vector<Node> nodes_;
+    unordered_map<uint64_t, uint32_t> index_;
+};
+
+struct Configuration {
+    uint32_t state;
+    uint32_t input_idx;
+    uint32_t stack;
+    bool operator==(const Configuration& o) const {
+        return state == o.state && input_idx == o.input_idx && stack == o.stack;
+    }
+};
+
+struct ConfigurationHash {
+    size_t operator()(const Configuration& c) const {
+        uint64_t h = (static_cast<uint64_t>(c.state) << 32) ^ c.input_idx;
+        h = h * 0x9E3779B97F4A7C15ULL ^ c.stack;
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+};
+
+// One explored configuration and how the search reached it.
+struct SearchNode {
+    Configuration config;
+    uint32_t parent;                       // kNone for the start
+    const CompiledTransition* via;         // nullptr for the start
+    bool consumed;
+};
+
+vector<PDAStep> build_trace(const vector<SearchNode>& nodes, uint32_t last, const PDA& pda,
+                            const vector<string>& input, const StackPool& stacks, const SymbolIds& symbols) {
+    vector<uint32_t> path;
+    for (uint32_t n = last; n != kNone && nodes[n].parent != kNone; n = nodes[n].parent) path.push_back(n);
+    reverse(path.begin(), path.end());
+
+    vector<PDAStep> steps;
+    steps.reserve(path.size());
+    for (uint32_t n : path) {
+        const SearchNode& node = nodes[n];
+        const SearchNode& from = nodes[node.parent];
+        PDAStep step;
+        step.op = node.via->op;
+        step.symbol = node.consumed ? input[from.config.input_idx] : "ε";
+        step.stack_after = stacks.contents(node.config.stack, symbols);
+        step.current_state = pda.states[from.config.state].name;
+        step.next_state = pda.states[node.config.state].name;
+        steps.push_back(std::move(step));
+    }
+    return steps;
+}
+
+// Single pass for a deterministic PDA: every configuration has at most one
+// move, so the BFS frontier never holds more than one configuration. Follows
+// that one path; the result is what the search below returns.
+//
+// Stacks are the search's hash-consed ids, so a move is O(1) and a
+// configuration is three integers. A run of epsilon moves that reaches a
+// configuration it already passed through loops forever (the search would
+// find nothing new to explore), so it ends the path there. Moves are kept as
+// links and only the returned steps are materialized.
+PDATraceResult simulate_deterministic_pda(const PDA& pda, const vector<string>& input,
+                                          const PDASimulationLimits& limits) {
+    struct Move {
+        const PDATransition* via;
+        uint32_t from_state;
+        uint32_t input_idx;   // before the move
+        uint32_t stack_after;
+        bool consumed;
+    };
+
+    SymbolIds symbols;
+    StackPool stacks;
+    auto state = static_cast<uint32_t>(pda.start);
+    uint32_t input_idx = 0;
+    uint32_t stack = 0;
+    vector<Move> moves;
+    // Configurations since input was last consumed.
+    unordered_set<Configuration, ConfigurationHash> epsilon_run;
+    const auto input_size = static_cast<uint32_t>(input.size());
+    // Like the search, report the path up to where the most input was consumed.
+    uint32_t best_input_consumed = 0;
+    size_t best_moves = 0;
+
+    auto trace = [&](size_t count) {
+        vector<PDAStep> steps;
+        steps.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            const Move& m = moves[i];
+            PDAStep step;
+            if (!m.via->push_symbols.empty()) step.op = "PUSH";
+            else if (m.via->pop_symbol != "ε") step.op = "POP";
+            else step.op = "NO_OP";
+            step.symbol = m.consumed ? input[m.input_idx] : "ε";
+            step.stack_after = stacks.contents(m.stack_after, symbols);
+            step.current_state = pda.states[m.from_state].name;
+            step.next_state = pda.states[m.via->next_state].name;
+            steps.push_back(std::move(step));
+        }
+        return steps;
+    };
+
+    for (size_t explored = 0; explored < limits.max_configurations; ++explored) {
+        if (input_idx > best_input_consumed) {
+            best_input_consumed = input_idx;
+            best_moves = moves.size();
+        }
+        const auto& current = pda.states[state];
+        if (input_idx == input_size && current.accepting) return {true, trace(moves.size())};
+
+        const PDATransition* move = nullptr;
+        bool consumes_input = false;
+        for (const auto& trans : current.transitions) {
+            const bool epsilon_input = trans.input_symbol == "ε";
+            if (!epsilon_input && (input_idx >= input_size || trans.input_symbol != input[input_idx])) continue;
+            if (trans.pop_symbol != "ε" && (stack == 0 || symbols.name(stacks.top(stack)) != trans.pop_symbol)) {
+                continue;
+            }
+            move = &trans;
+            consumes_input = !epsilon_input;
+            break;
+        }
+        if (move == nullptr) break;
+        if (consumes_input) {
+            epsilon_run.clear();
+        } else if (!epsilon_run.insert({state, input_idx, stack}).second) {
+            break;
+        }
+
+        const size_t popped = move->pop_symbol != "ε" ? 1 : 0;
+        if (stacks.depth(stack) - popped + move->push_symbols.size() > limits.max_stack_depth) break;
+        if (popped) stack = stacks.below(stack);
+        for (auto it = move->push_symbols.rbegin(); it != move->push_symbols.rend(); ++it) {
+            stack = stacks.push(stack, symbols.intern_name(*it));
+        }
+
+        moves.push_back({move, state, input_idx, stack, consumes_input});
+        state = static_cast<uint32_t>(move->next_state);
+        if (consumes_input) ++input_idx;
+    }
+
+    return {false, trace(best_moves)};
+}
+
+}  // namespace
+
+PDATraceResult simulate_pda(const PDA& pda, const vector<string>& input, const PDASimulationLimits& limits) {
+    if (pda.states.empty()) return {false, {}};
+    if (pda.deterministic) return simulate_deterministic_pda(pda, input, limits);
+
+    SymbolIds symbols;
+    vector<vector<CompiledTransition>> transitions(pda.states.size());
+    for (size_t s = 0; s < pda.states.size(); ++s) {
+        for (const auto& t : pda.states[s].transitions) {
+            CompiledTransition c;
+            c.input = symbols.intern(t.input_symbol);
+            c.pop = symbols.intern(t.pop_symbol);
+            // Pushed in reverse so the first symbol ends up on top.
+            for (auto it = t.push_symbols.rbegin(); it != t.push_symbols.rend(); ++it) {
+                c.push.push_back(symbols.intern_name(*it));
+            }
+            c.next_state = static_cast<uint32_t>(t.next_state);
+            // Label the operation type for the UI (PUSH, POP, or just moving).
+            if (!t.push_symbols.empty()) c.op = "PUSH";
+            else if (t.pop_symbol != "ε") c.op = "POP";
+            else c.op = "NO_OP";
+            transitions[s].push_back(std::move(c));
+        }
+    }
+    vector<uint32_t> input_ids;
+    input_ids.reserve(input.size());
+    for (const auto& sym : input) {
+        // A literal "ε" token matches nothing, as before.
+        const uint32_t id = symbols.intern(sym);
+        input_ids.push_back(id == kEpsilon ? kNone - 1 : id);
+    }
+    const auto input_size = static_cast<uint32_t>(input.size());
+
+    StackPool stacks;
+    // The BFS queue is the tail of `nodes` past `head`.
+    vector<SearchNode> nodes;
+    unordered_set<Configuration, ConfigurationHash> visited;
+    const Configuration start{static_cast<uint32_t>(pda.start), 0, 0};
+    nodes.push_back({start, kNone, nullptr, false});
+    visited.insert(start);
+
+    // The path that consumed the most input, for error reporting.
+    uint32_t best_input_consumed = 0;
+    uint32_t best_node = kNone;
+
+    size_t explored = 0;
+    for (size_t head = 0; head < nodes.size(); ++head) {
+        if (explored++ >= limits.max_configurations) break;
+        const Configuration current = nodes[head].config;
+        const auto node_id = static_cast<uint32_t>(head);
+
+        if (current.input_idx > best_input_consumed) {
+            best_input_consumed = current.input_idx;
+            best_node = node_id;
+        }
+        if (current.input_idx == input_size && pda.states[current.state].accepting) {
+            return {true, build_trace(nodes, node_id, pda, input, stacks, symbols)};
+        }
+
+        for (const auto& trans : transitions[current.state]) {
+            bool consumes_input = false;
+            if (trans.input != kEpsilon) {
+                if (current.input_idx >= input_size || trans.input != input_ids[current.input_idx]) continue;
+                consumes_input = true;
+            }
+
+            uint32_t stack = current.stack;
+            if (trans.pop != kEpsilon) {
+                if (stack == 0 || stacks.top(stack) != trans.pop) continue;
+                stack = stacks.below(stack);
+            }
+            if (stacks.depth(stack) + trans.push.size() > limits.max_stack_depth) continue;
+            for (uint32_t sym : trans.push) stack = stacks.push(stack, sym);
+
+            const Configuration next{trans.next_state, current.input_idx + (consumes_input ? 1U : 0U), stack};
+            if (!visited.insert(next).second) continue;
+            nodes.push_back({next, node_id, &trans, consumes_input});
+        }
+    }
+
+    return {false, build_trace(nodes, best_node, pda, input, stacks, symbols)};
+}
+
+}  // namespace automata_security
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "core.hpp"
+#include "utils.hpp"
+
+namespace automata_security {
+
+// Bounds on one PDA search. Reaching either of them ends (or prunes) the
+// search; the result is then a rejection with the best partial trace.
+struct PDASimulationLimits {
+    // Configurations taken off the BFS queue.
+    std::size_t max_configurations = std::size_t{1} << 20;
+    // Configurations whose stack would grow deeper than this are dropped, so
+    // epsilon-push cycles cannot run forever.
+    std::size_t max_stack_depth = 4096;
+};
+
+// simulate_pda: breadth-first search over PDA configurations (control state,
+// input position, stack). If some path consumes the whole input and ends in
+// an accepting state, returns it; otherwise returns the path that consumed
+// the most input, to show where the input failed.
+//
+// Each configuration is explored once. Stacks are hash-consed persistent
+// lists, so equal stacks share one id and a push/pop costs O(1). Paths are
+// stored as parent links and only the returned trace is materialized; the
+// result is the same path the plain BFS would find first.
+//
+// A PDA flagged `deterministic` (see pda_is_deterministic) skips the search:
+// its single path is followed directly, in time linear in its length. An
+// epsilon loop on that path ends it as soon as a configuration repeats.
+PDATraceResult simulate_pda(const PDA& pda,
+                            const std::vector<std::string>& input,
+                            const PDASimulationLimits& limits = {});
+
+}  // namespace automata_security
@@ -0,0 +1,295 @@
+#include "session.hpp"
+
+#include <fstream>
+#include <string_view>
+
+#include "json_buffer.hpp"
+
+using namespace std;
+
+namespace automata_security {
+
+namespace {
+
+// Rough heap footprint of the cached objects, used only to enforce the cap.
+// Each string or map node is charged its payload plus typical overhead.
+constexpr size_t kNodeOverhead = 48;
+
+size_t string_bytes(const string& s) {
+    return sizeof(string) + s.capacity();
+}
+
+size_t approximate_bytes(const GrammarDFA& dfa) {
+    size_t bytes = sizeof(GrammarDFA);
+    for (const auto& name : dfa.names) bytes += 2 * (string_bytes(name) + kNodeOverhead);
+    for (const auto& row : dfa.trans) {
+        bytes += sizeof(row) + row.bucket_count() * sizeof(void*);
+        for (const auto& [symbol, target] : row) bytes += string_bytes(symbol) + sizeof(target) + kNodeOverhead;
+    }
+    return bytes + dfa.accepting.size() / 8;
+}
+
+size_t approximate_bytes(const FrozenGrammarDFA& dfa) {
+    return sizeof(FrozenGrammarDFA) + dfa.width() * (2 * kNodeOverhead) +
+           dfa.state_count() * (dfa.width() * sizeof(uint32_t) + sizeof(string) + kNodeOverhead);
+}
+
+// Mapped pages are not heap, but count once touched; charge the whole file.
+size_t approximate_bytes(const DfaModel& model) {
+    return sizeof(DfaModel) + model.file_size();
+}
+
+size_t approximate_bytes(const PDA& pda) {
+    size_t bytes = sizeof(PDA);
+    for (const auto& state : pda.states) {
+        bytes += sizeof(state) + 2 * (string_bytes(state.name) + kNodeOverhead);
+        for (const auto& trans : state.transitions) {
+            bytes += sizeof(trans) + string_bytes(trans.input_symbol) + string_bytes(trans.pop_symbol);
+            for (const auto& sym : trans.push_symbols) bytes += string_bytes(sym);
+        }
+    }
+    return bytes;
+}
+
+size_t approximate_bytes(const DerivationIndex& index) {
+    return index.approximate_bytes();
+}
+
+size_t approximate_bytes(const string& json) {
+    return string_bytes(json);
+}
+
+}  // namespace
+
+bool ApiSession::stat_file(const string& path, FileStamp& stamp) {
+    std::error_code ec;
+    stamp.mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) return false;
+    stamp.size = std::filesystem::file_size(path, ec);
+    return !ec;
+}
+
+const ApiSession::Object* ApiSession::find(const Key& key, const FileStamp& stamp) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return nullptr;
+    if (!(it->second.stamp == stamp)) {
+        // The file changed on disk since it was loaded.
+        erase(it);
+        return nullptr;
+    }
+    recency_.splice(recency_.begin(), recency_, it->second.recency);
+    return &it->second.object;
+}
+
+void ApiSession::store(Key key, Object object, const FileStamp& stamp, size_t bytes) {
+    if (bytes > capacity_) return;  // would not fit even in an empty cache
+    evict_to(capacity_ - bytes);
+    recency_.push_front(key);
+    Entry entry{std::move(object), stamp, bytes, recency_.begin()};
+    entries_.emplace(std::move(key), std::move(entry));
+    used_ += bytes;
+}
+
+void ApiSession::erase(std::map<Key, Entry>::iterator it) {
+    used_ -= it->second.bytes;
+    recency_.erase(it->second.recency);
+    entries_.erase(it);
+}
+
+void ApiSession::evict_to(size_t limit) {
+    while (used_ > limit && !recency_.empty()) {
+        erase(entries_.find(recency_.back()));
+    }
+}
+
+// Shared lookup path: serve the cached object while the file is unchanged,
+// otherwise run `load` and cache its result. Files that cannot be stat'ed
+// are still handed to the loader, so it reports the error, but are never
+// cached.
+template <typename T, typename Load>
+shared_ptr<const T> ApiSession::lookup(Kind kind, const string& path, const Load& load) {
+    Key key{kind, path};
+    FileStamp stamp;
+    const bool stamped = stat_file(path, stamp);
+    if (stamped) {
+        if (const Object* object = find(key, stamp)) return get<shared_ptr<const T>>(*object);
+    } else {
+        auto it = entries_.find(key);
+        if (it != entries_.end()) erase(it);
+    }
+
+    auto loaded = make_shared<T>();
+    if (!load(*loaded)) return nullptr;
+    if (stamped) store(std::move(key), shared_ptr<const T>(loaded), stamp, approximate_bytes(*loaded));
+    return loaded;
+}
+
+shared_ptr<const GrammarDFA> ApiSession::dfa(const string& dot_path, string& err) {
+    return lookup<GrammarDFA>(Kind::kDfa, dot_path,
+                              [&](GrammarDFA& out) { return load_dot_dfa(dot_path, out, err); });
+}
+
+shared_ptr<const FrozenGrammarDFA> ApiSession::frozen_dfa(const string& dot_path, string& err) {
+    return lookup<FrozenGrammarDFA>(Kind::kFrozenDfa, dot_path, [&](FrozenGrammarDFA& out) {
+        GrammarDFA dfa;
+        if (!load_dot_dfa(dot_path, dfa, err)) return false;
+        out = FrozenGrammarDFA::from(dfa);
+        return true;
+    });
+}
+
+shared_ptr<const DfaModel> ApiSession::model(const string& path, string& err) {
+    return lookup<DfaModel>(Kind::kModel, path, [&](DfaModel& out) {
+        try {
+            out = DfaModel(path);
+        } catch (const exception& ex) {
+            err = ex.what();
+            return false;
+        }
+        return true;
+    });
+}
+
+shared_ptr<const PDA> ApiSession::pda(const string& dot_path, string& err) {
+    return lookup<PDA>(Kind::kPda, dot_path,
+                       [&](PDA& out) { return load_dot_pda(dot_path, out, err); });
+}
+
+shared_ptr<const DerivationIndex> ApiSession::derivation_index(const string& path) {
+    return lookup<DerivationIndex>(Kind::kDerivationIndex, path, [&](DerivationIndex& out) {
+        Grammar g;
+        if (!load_grammar_for_derivation(path, g)) return false;
+        out = DerivationIndex::from(g);
+        return true;
+    });
+}
+
+shared_ptr<const string> ApiSession::graph_json(const string& dot_path, string& err) {
+    return lookup<string>(Kind::kGraph, dot_path,
+                          [&](string& out) { return render_dot_graph(dot_path, out, err); });
+}
+
+void ApiSession::invalidate(const string& path) {
+    for (Kind kind : {Kind::kDfa, Kind::kFrozenDfa, Kind::kModel, Kind::kPda, Kind::kDerivationIndex, Kind::kGraph}) {
+        auto it = entries_.find(Key{kind, path});
+        if (it != entries_.end()) erase(it);
+    }
+}
+
+bool render_dot_graph(const string& dot_path, string& json, string& err) {
+    ifstream in(dot_path);
+    if (!in.is_open()) {
+        err = "Failed to open DOT file: " + dot_path;
+        return false;
+    }
+
+    // Nodes and edges are each rendered back to back into one buffer;
+    // node_ends[i] is where node i's object ends.
+    JsonBuffer nodes;
+    JsonBuffer edges;
+    vector<size_t> node_ends;
+    string start_node;
+    string line;
+
+    // Read the file line by line.
+    while (getline(in, line)) {
+        // Clean up whitespace.
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t") + 1);
+
+        // Look for the special start marker (e.g., "__start -> s0").
+        if (line.find("__start ->") == 0) {
+            size_t arrow = line.find("->");
+            size_t semi = line.find(";");
+            if (arrow != string::npos && semi != string::npos) {
+                start_node = line.substr(arrow + 2, semi - (arrow + 2));
+                start_node.erase(0, start_node.find_first_not_of(" \t"));
+                start_node.erase(start_node.find_last_not_of(" \t") + 1);
+            }
+
+        // Look for edges (connections between nodes), e.g., "s0 -> s1".
+        } else if (line.find("->") != string::npos) {
+            if (line.find("__start") == 0) continue; // Skip the start marker line itself.
+
+            size_t arrow = line.find("->");
+            size_t bracket = line.find("[");
+            size_t label_pos = line.find("label=\"");
+
+            // If it looks like a valid edge with a label...
+            if (arrow != string::npos && bracket != string::npos && label_pos != string::npos) {
+                // Extract the source and target node names.
+                string src = line.substr(0, arrow);
+                string tgt = line.substr(arrow + 2, bracket - (arrow + 2));
+
+                // Clean up names.
+                src.erase(0, src.find_first_not_of(" \t"));
+                src.erase(src.find_last_not_of(" \t") + 1);
+                tgt.erase(0, tgt.find_first_not_of(" \t"));
+                tgt.erase(tgt.find_last_not_of(" \t") + 1);
+
+                // Extract the label text (what is written on the arrow).
+                size_t label_end = line.find("\"", label_pos + 7);
+                string lbl = line.substr(label_pos + 7, label_end - (label_pos + 7));
+
+                // Format as a JSON object for the edge.
+                if (edges.size() > 0) edges.raw(", ");
+                edges.raw("{ \"source\": ").string(src).raw(", ");
+                edges.raw("\"target\": ").string(tgt).raw(", ");
+                edges.raw("\"label\": ").string(lbl).raw(" }");
+            }
+
+        // Look for node definitions, e.g., "s0 [label=...]".
+        } else if (line.find("[") != string::npos && line.find("label=") != string::npos) {
+            if (line.find("__start") == 0) continue;
+            if (line.find("node [") == 0) continue;
+
+            size_t bracket = line.find("[");
+            string id = line.substr(0, bracket);
+            id.erase(0, id.find_first_not_of(" \t"));
+            id.erase(id.find_last_not_of(" \t") + 1);
+
+            size_t label_pos = line.find("label=\"");
+            if (label_pos != string::npos) {
+                size_t label_end = line.find("\"", label_pos + 7);
+                string label_raw = line.substr(label_pos + 7, label_end - (label_pos + 7));
+                // Take only the first line of the label.
+                string label = label_raw.substr(0, label_raw.find("\\n"));
+
+                // Check if it's an accepting state (marked by doublecircle).
+                bool is_accepting = line.find("doublecircle") != string::npos;
+
+                // Format as a JSON object for the node.
+                nodes.raw("{ \"id\": ").string(id).raw(", ");
+                nodes.raw("\"label\": ").string(label).raw(", ");
+                nodes.raw("\"is_accepting\": ").boolean(is_accepting).raw(", ");
+                nodes.raw("\"is_start\": ").boolean(id == start_node).raw(" }");
+                node_ends.push_back(nodes.size());
+            }
+        }
+    }
+
+    // Assemble the final JSON structure containing nodes and edges. A node
+    // defined before the start marker was read is marked as start here.
+    const string start_id = "\"id\": \"" + start_node + "\"";
+    const string not_start = "\"is_start\": false";
+    JsonBuffer out;
+    out.raw("{ \"nodes\": [");
+    size_t node_begin = 0;
+    for (size_t node_end : node_ends) {
+        if (node_begin > 0) out.raw(", ");
+        string_view node = string_view(nodes.str()).substr(node_begin, node_end - node_begin);
+        size_t pos = string_view::npos;
+        if (!start_node.empty() && node.find(start_id) != string_view::npos) pos = node.find(not_start);
+        if (pos == string_view::npos) {
+            out.raw(node);
+        } else {
+            out.raw(node.substr(0, pos)).raw("\"is_start\": true").raw(node.substr(pos + not_start.size()));
+        }
+        node_begin = node_end;
+    }
+    out.raw("], \"edges\": [").raw(edges.str()).raw("] }");
+    json = out.str();
+    return true;
+}
+
+}  // namespace automata_security
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "automata/dfa_model.hpp"
+#include "core.hpp"
+#include "derivation_index.hpp"
+#include "utils.hpp"
+
+namespace automata_security {
+
+// Error raised by an api request. The one-shot CLI reports it with
+// print_error (and exits 1); serve mode writes the same JSON line and keeps
+// reading requests.
+class ApiError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Automata loaded by an api process, so a long-running `--mode serve`
+// process parses each DOT/grammar file once instead of once per request.
+//
+// Entries are keyed by kind and path and remember the file's modification
+// time and size; a lookup whose file has changed since it was loaded reloads
+// it. Entries are evicted least-recently-used first once their estimated
+// footprint exceeds the memory cap (0 disables caching).
+//
+// Lookups return nullptr (and set `err` where the loader does) when the file
+// cannot be loaded; failures are not cached. The returned objects stay valid
+// for as long as the caller holds them, even if the entry is evicted.
+class ApiSession {
+public:
+    static constexpr std::size_t kDefaultCacheBytes = std::size_t{256} << 20;
+
+    explicit ApiSession(std::size_t cache_bytes = kDefaultCacheBytes) : capacity_(cache_bytes) {}
+
+    std::shared_ptr<const GrammarDFA> dfa(const std::string& dot_path, std::string& err);
+    // Dense integer table of the same DOT DFA, for batch classification.
+    std::shared_ptr<const FrozenGrammarDFA> frozen_dfa(const std::string& dot_path, std::string& err);
+    // Memory-mapped binary model written by `generator --export-model`.
+    std::shared_ptr<const DfaModel> model(const std::string& path, std::string& err);
+    std::shared_ptr<const PDA> pda(const std::string& dot_path, std::string& err);
+    // Grammar file compiled for the derivation modes.
+    std::shared_ptr<const DerivationIndex> derivation_index(const std::string& path);
+    // Rendered `--mode graph` JSON for a DOT file (a pure function of it).
+    std::shared_ptr<const std::string> graph_json(const std::string& dot_path, std::string& err);
+
+    // Drop every cached object loaded from `path`, e.g. after writing it.
+    void invalidate(const std::string& path);
+
+    std::size_t cached_bytes() const { return used_; }
+    std::size_t cached_entries() const { return entries_.size(); }
+
+private:
+    enum class Kind { kDfa, kFrozenDfa, kModel, kPda, kDerivationIndex, kGraph };
+    using Key = std::pair<Kind, std::string>;
+    using Object = std::variant<std::shared_ptr<const GrammarDFA>,
+                                std::shared_ptr<const FrozenGrammarDFA>,
+                                std::shared_ptr<const DfaModel>,
+                                std::shared_ptr<const PDA>,
+                                std::shared_ptr<const DerivationIndex>,
+                                std::shared_ptr<const std::string>>;
+
+    // Identifies one version of a file on disk.
+    struct FileStamp {
+        std::filesystem::file_time_type mtime{};
+        std::uintmax_t size{0};
+        bool operator==(const FileStamp& other) const {
+            return mtime == other.mtime && size == other.size;
+        }
+    };
+
+    struct Entry {
+        Object object;
+        FileStamp stamp;
+        std::size_t bytes{0};
+        std::list<Key>::iterator recency;
+    };
+
+    std::size_t capacity_;
+    std::size_t used_{0};
+    std::map<Key, Entry> entries_;
+    // Most recently used first.
+    std::list<Key> recency_;
+
+    static bool stat_file(const std::string& path, FileStamp& stamp);
+    const Object* find(const Key& key, const FileStamp& stamp);
+    void store(Key key, Object object, const FileStamp& stamp, std::size_t bytes);
+    void erase(std::map<Key, Entry>::iterator it);
+    void evict_to(std::size_t limit);
+
+    template <typename T, typename Load>
+    std::shared_ptr<const T> lookup(Kind kind, const std::string& path, const Load& load);
+};
+
+// Render a DOT file as the visualizer's { nodes, edges } JSON (no newline).
+bool render_dot_graph(const std::string& dot_path, std::string& json, std::string& err);
+
+}  // namespace automata_security
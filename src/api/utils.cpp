@@ -1,5 +1,6 @@
 #include "utils.hpp"
 #include "core.hpp"
+#include "json_buffer.hpp"
 
 #include <fstream>
 #include <algorithm>
@@ -10,32 +11,17 @@ using namespace std;
 namespace automata_security {
 
 string json_escape(const string& s) {
-    ostringstream o;
-    for (char c : s) {
-        switch (c) {
-            case '"': o << "\\\""; break;
-            case '\\': o << "\\\\"; break;
-            case '\b': o << "\\b"; break;
-            case '\f': o << "\\f"; break;
-            case '\n': o << "\\n"; break;
-            case '\r': o << "\\r"; break;
-            case '\t': o << "\\t"; break;
-            default:
-                if ('\x00' <= c && c <= '\x1f') {
-                    o << "\\u" << hex << (int)c;
-                } else {
-                    o << c;
-                }
-        }
-    }
-    return o.str();
-
+    string escaped;
+    append_json_escaped(escaped, s);
+    return escaped;
 }
 
-
+void write_error(ostream& out, const string& msg) {
+    out << "{ \"error\": \"" << json_escape(msg) << "\" }" << endl;
+}
 
 void print_error(const string& msg) {
-    cout << "{ \"error\": \"" << json_escape(msg) << "\" }" << endl;
+    write_error(cout, msg);
     exit(1);
 }
 
@@ -153,6 +139,21 @@ size_t PDA::get_or_add_state(const string& name) {
     return state_map[name];
 }
 
+bool pda_is_deterministic(const PDA& pda) {
+    auto overlap = [](const string& a, const string& b) { return a == "ε" || b == "ε" || a == b; };
+    for (const auto& state : pda.states) {
+        const auto& ts = state.transitions;
+        for (size_t i = 0; i < ts.size(); ++i) {
+            for (size_t j = i + 1; j < ts.size(); ++j) {
+                if (overlap(ts[i].input_symbol, ts[j].input_symbol) && overlap(ts[i].pop_symbol, ts[j].pop_symbol)) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
 bool load_dot_pda(const string& path, PDA& out, string& err) {
     ifstream in(path);
     if (!in.is_open()) {
@@ -257,6 +258,7 @@ bool load_dot_pda(const string& path, PDA& out, string& err) {
              out.start = out.state_map[start_node_name];
         }
     }
+    out.deterministic = pda_is_deterministic(out);
     return true;
 
 }
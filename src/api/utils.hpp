@@ -13,6 +13,10 @@ namespace automata_security {
 // Helper to escape JSON strings
 std::string json_escape(const std::string& s);
 
+// Write `{ "error": msg }` as one JSON line.
+void write_error(std::ostream& out, const std::string& msg);
+
+// write_error to stdout, then exit(1).
 void print_error(const std::string& msg);
 
 struct Grammar {
@@ -44,6 +48,8 @@ struct PDA {
     std::vector<PDAState> states;
     size_t start = 0;
     std::map<std::string, size_t> state_map;
+    // Set by load_dot_pda from pda_is_deterministic().
+    bool deterministic = false;
 
     size_t get_or_add_state(const std::string& name);
 };
@@ -51,4 +57,9 @@ struct PDA {
 // Load PDA DOT file into the PDA structure
 bool load_dot_pda(const std::string& path, PDA& out, std::string& err);
 
+// True when no state has two transitions that can both apply to one
+// configuration: each pair must differ in a non-ε input symbol or in a
+// non-ε pop symbol. Such a PDA has at most one move at every step.
+bool pda_is_deterministic(const PDA& pda);
+
 } // namespace automata_security
@@ -0,0 +1,188 @@
+#include "automata/acyclic_builder.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+namespace automata_security {
+namespace {
+
+// Daciuk, Mihov, Watson & Watson, "Incremental Construction of Minimal
+// Acyclic Finite-State Automata" (2000), sorted-input variant.
+class AcyclicBuilder {
+public:
+    AcyclicBuilder() : root_(new_state()) { path_.push_back(root_); }
+
+    // Words must arrive in strictly increasing lexicographic order.
+    void add_word(const std::vector<SymbolId>& word, std::size_t positive, std::size_t negative) {
+        std::size_t prefix = 0;
+        while (prefix < word.size() && prefix < previous_.size() && word[prefix] == previous_[prefix]) {
+            ++prefix;
+        }
+
+        // Everything past the common prefix is final: no later (greater)
+        // word can pass through it again.
+        replace_or_register(prefix);
+
+        for (std::size_t i = prefix; i < word.size(); ++i) {
+            const auto child = new_state();
+            states_[path_.back()].edges.emplace_back(word[i], child);
+            path_.push_back(child);
+        }
+        auto& last = states_[path_.back()];
+        last.final = true;
+        last.positive_count += positive;
+        last.negative_count += negative;
+        previous_ = word;
+    }
+
+    DFA finish(std::vector<SymbolId> alphabet, const SymbolTable& symbols) {
+        replace_or_register(0);
+
+        // Renumber the live states breadth-first from the root.
+        std::vector<std::size_t> new_id(states_.size(), std::numeric_limits<std::size_t>::max());
+        std::vector<std::uint32_t> order{root_};
+        new_id[root_] = 0;
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            for (const auto& edge : states_[order[i]].edges) {
+                if (new_id[edge.second] == std::numeric_limits<std::size_t>::max()) {
+                    new_id[edge.second] = order.size();
+                    order.push_back(edge.second);
+                }
+            }
+        }
+
+        std::vector<DFA::State> dfa_states(order.size());
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            const auto& source = states_[order[i]];
+            auto& state = dfa_states[i];
+            state.positive_count = source.positive_count;
+            state.negative_count = source.negative_count;
+            state.accepting = source.final;
+            for (const auto& [symbol, target] : source.edges) {
+                state.transitions.emplace(symbol, new_id[target]);
+            }
+        }
+        return DFA::from_states(std::move(dfa_states), 0, std::move(alphabet), symbols);
+    }
+
+private:
+    struct BuildState {
+        // Sorted by symbol, since words arrive in order.
+        std::vector<std::pair<SymbolId, std::uint32_t>> edges;
+        bool final{false};
+        std::size_t positive_count{0};
+        std::size_t negative_count{0};
+    };
+
+    // A state's right language is fixed by its finality and its (already
+    // registered) targets, so that tuple is the register key.
+    using Signature = std::vector<std::uint64_t>;
+
+    struct SignatureHash {
+        std::size_t operator()(const Signature& key) const {
+            std::uint64_t hash = 1469598103934665603ULL;
+            for (const auto value : key) {
+                hash ^= value;
+                hash *= 1099511628211ULL;
+            }
+            return static_cast<std::size_t>(hash ^ (hash >> 32));
+        }
+    };
+
+    std::vector<BuildState> states_;
+    std::vector<std::uint32_t> free_;
+    std::unordered_map<Signature, std::uint32_t, SignatureHash> register_;
+    std::vector<std::uint32_t> path_;
+    std::vector<SymbolId> previous_;
+    std::uint32_t root_;
+    Signature key_;
+
+    std::uint32_t new_state() {
+        std::uint32_t id;
+        if (!free_.empty()) {
+            id = free_.back();
+            free_.pop_back();
+            states_[id] = BuildState{};
+        } else {
+            id = static_cast<std::uint32_t>(states_.size());
+            states_.emplace_back();
+        }
+        return id;
+    }
+
+    // Register (or merge into an equivalent registered state) every state of
+    // the previous word's path deeper than `depth`, deepest first.
+    void replace_or_register(std::size_t depth) {
+        while (path_.size() > depth + 1) {
+            const auto child = path_.back();
+            path_.pop_back();
+            const auto parent = path_.back();
+
+            const auto& state = states_[child];
+            key_.clear();
+            key_.push_back(state.final ? 1U : 0U);
+            for (const auto& [symbol, target] : state.edges) {
+                key_.push_back((static_cast<std::uint64_t>(symbol) << 32) | target);
+            }
+
+            auto [it, inserted] = register_.emplace(key_, child);
+            if (inserted) {
+                continue;
+            }
+            // Equivalent state already registered: redirect the parent's
+            // newest edge to it and recycle the duplicate.
+            auto& kept = states_[it->second];
+            kept.positive_count += state.positive_count;
+            kept.negative_count += state.negative_count;
+            states_[parent].edges.back().second = it->second;
+            states_[child].edges = {};
+            free_.push_back(child);
+        }
+    }
+};
+
+}  // namespace
+
+DFA build_minimal_acyclic_dfa(const std::vector<LabeledSequence>& samples,
+                              const SymbolTable& symbols) {
+    // Sort by sequence so duplicates are adjacent and the accepted words come
+    // out in the order the builder requires.
+    std::vector<const LabeledSequence*> sorted;
+    sorted.reserve(samples.size());
+    std::unordered_set<SymbolId> alphabet_set;
+    for (const auto& sample : samples) {
+        sorted.push_back(&sample);
+        alphabet_set.insert(sample.symbols.begin(), sample.symbols.end());
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const LabeledSequence* lhs, const LabeledSequence* rhs) {
+                  return lhs->symbols < rhs->symbols;
+              });
+
+    AcyclicBuilder builder;
+    for (std::size_t i = 0; i < sorted.size();) {
+        const auto& word = sorted[i]->symbols;
+        std::size_t positive = 0;
+        std::size_t negative = 0;
+        for (; i < sorted.size() && sorted[i]->symbols == word; ++i) {
+            if (sorted[i]->label) {
+                ++positive;
+            } else {
+                ++negative;
+            }
+        }
+        // Same majority vote as DFA::from_pta on the PTA leaf.
+        if (positive > negative) {
+            builder.add_word(word, positive, negative);
+        }
+    }
+
+    std::vector<SymbolId> alphabet(alphabet_set.begin(), alphabet_set.end());
+    return builder.finish(std::move(alphabet), symbols);
+}
+
+}  // namespace automata_security
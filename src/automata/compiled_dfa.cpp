@@ -0,0 +1,103 @@
+#include "automata/compiled_dfa.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "automata/dfa.hpp"
+#include "automata/interleaved_walk.hpp"
+
+namespace automata_security {
+
+CompiledDFA CompiledDFA::from_dfa(const DFA& dfa) {
+    CompiledDFA compiled;
+    const auto& states = dfa.states();
+
+    // Table width: one column per symbol id up to the largest id in the
+    // alphabet, plus the trailing "out of alphabet" column.
+    SymbolId max_symbol = 0;
+    for (const auto symbol : dfa.alphabet()) {
+        max_symbol = std::max(max_symbol, symbol);
+    }
+    if (max_symbol >= std::numeric_limits<std::uint32_t>::max() - 1) {
+        throw std::runtime_error("Symbol id too large to compile DFA table.");
+    }
+    compiled.width_ = dfa.alphabet().empty() ? 1U : max_symbol + 2U;
+
+    // Reuse the DFA's sink as dead state if it has one; otherwise append an
+    // absorbing row so unknown symbols (or an invalid start) reject, exactly
+    // as DFA::classify() does when no transition and no sink exist.
+    const bool has_sink = dfa.sink_state() < states.size();
+    const std::size_t rows = has_sink ? states.size() : states.size() + 1;
+    if (rows >= std::numeric_limits<StateId>::max()) {
+        throw std::runtime_error("DFA has too many states to compile.");
+    }
+    compiled.state_count_ = rows;
+    compiled.dead_ = static_cast<StateId>(has_sink ? dfa.sink_state() : states.size());
+    compiled.start_ = dfa.start_state() < states.size()
+                          ? static_cast<StateId>(dfa.start_state())
+                          : compiled.dead_;
+
+    compiled.table_.assign(rows * compiled.width_, compiled.dead_);
+    compiled.accepting_.assign((rows + 63) / 64, 0);
+
+    for (std::size_t i = 0; i < states.size(); ++i) {
+        const auto& state = states[i];
+        auto* row = compiled.table_.data() + i * compiled.width_;
+        for (const auto& [symbol, target] : state.transitions) {
+            if (target >= states.size()) {
+                throw std::runtime_error("DFA transition target out of bounds while compiling.");
+            }
+            if (symbol + 1U >= compiled.width_) {
+                throw std::runtime_error("DFA transition symbol outside alphabet while compiling.");
+            }
+            row[symbol] = static_cast<StateId>(target);
+        }
+        if (state.accepting) {
+            compiled.accepting_[i >> 6] |= std::uint64_t{1} << (i & 63U);
+        }
+    }
+
+    return compiled;
+}
+
+void CompiledDFA::classify_batch(const std::vector<SymbolId>* const* sequences,
+                                 std::size_t count,
+                                 std::uint64_t* verdicts) const {
+    // Sequences per block; a multiple of 64 so blocks start on a verdict word.
+    constexpr std::size_t kBlock = 256;
+    const std::size_t table_bytes = table_.size() * sizeof(table_[0]);
+
+    // Decide block by block, while the sequences just measured are in cache.
+    for (std::size_t first = 0; first < count; first += kBlock) {
+        const std::size_t size = std::min(kBlock, count - first);
+        const std::vector<SymbolId>* const* block = sequences + first;
+        std::uint64_t* words = verdicts + first / 64;
+        std::fill(words, words + (size + 63) / 64, 0);
+
+        std::size_t symbols = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            symbols += block[i]->size();
+        }
+        if (!worth_interleaving(table_bytes, symbols, size)) {
+            for (std::size_t i = 0; i < size; ++i) {
+                words[i >> 6] |= std::uint64_t{classify(*block[i])} << (i & 63U);
+            }
+            continue;
+        }
+        walk_interleaved<SymbolId>(
+            size,
+            start_,
+            [&](std::size_t i) {
+                const auto* data = block[i]->data();
+                return std::make_pair(data, data + block[i]->size());
+            },
+            [&](StateId state, SymbolId symbol) { return step(state, symbol); },
+            [&](std::size_t i, StateId state) {
+                words[i >> 6] |= std::uint64_t{accepting(state)} << (i & 63U);
+            });
+    }
+}
+
+}  // namespace automata_security
@@ -2,59 +2,71 @@
 
 #include <algorithm>
 #include <limits>
-#include <queue>
 #include <set>
 #include <sstream>
 #include <stdexcept>
 #include <unordered_set>
 #include <cassert>
 
+#include "utils/thread_pool.hpp"
+
 namespace automata_security {
 
 DFA::DFA() : start_state_(0), sink_state_(std::numeric_limits<std::size_t>::max()) {}
 
-DFA DFA::from_pta(const PTA& pta) {
+DFA DFA::from_pta(const PTA& pta, const SymbolTable& symbols) {
     DFA dfa;
-    const auto& pta_nodes = pta.nodes();
+    dfa.symbols_ = symbols;
+    const std::size_t node_count = pta.size();
     // basic sanity: PTA must contain nodes
-    assert(!pta_nodes.empty());
-    dfa.states_.resize(pta_nodes.size());
+    assert(node_count > 0);
+    dfa.states_.resize(node_count);
     dfa.start_state_ = pta.start_state();
     // start state must be a valid index into states_
     assert(dfa.start_state_ < dfa.states_.size());
 
-    std::unordered_set<std::string> alphabet_set;
+    // Symbols are dense ids, so one flag per table entry collects the alphabet.
+    std::vector<char> in_alphabet(symbols.size(), 0);
 
-    // Copy PTA nodes into DFA states. For each PTA node we:
+    // Copy PTA nodes into DFA states (node ids are kept). For each PTA node we:
     //  - propagate positive/negative example counts
     //  - set accepting flag by majority vote (positive_count > negative_count)
     //  - copy outgoing transitions and collect alphabet symbols
-    for (const auto& node : pta_nodes) {
-        if (node.id >= dfa.states_.size()) {
-            throw std::runtime_error("PTA node id out of bounds while constructing DFA.");
-        }
-        auto& state = dfa.states_[node.id];
+    for (std::size_t id = 0; id < node_count; ++id) {
+        const auto node = static_cast<PTA::NodeId>(id);
+        auto& state = dfa.states_[id];
 
         // Transfer example counts and compute accepting/rejecting
-        state.positive_count = node.positive_count;
-        state.negative_count = node.negative_count;
+        state.positive_count = pta.positive_count(node);
+        state.negative_count = pta.negative_count(node);
         state.accepting = state.positive_count > state.negative_count;
 
         // Copy transitions from PTA node to DFA state. Also collect each
         // observed symbol into the alphabet set for later completion.
-        for (const auto& [symbol, target] : node.transitions) {
+        pta.for_each_child(node, [&](SymbolId symbol, PTA::NodeId target) {
             // ensure transition targets are within PTA node bounds
-            if (target >= pta_nodes.size()) {
+            if (target >= node_count) {
                 throw std::runtime_error("PTA transition target out of bounds while constructing DFA.");
             }
+            if (symbol >= symbols.size()) {
+                throw std::runtime_error("PTA transition symbol missing from symbol table.");
+            }
             state.transitions[symbol] = target;
-            alphabet_set.insert(symbol);
-        }
+            in_alphabet[symbol] = 1;
+        });
     }
 
-    // Move collected alphabet into the DFA and sort it for deterministic order
-    dfa.alphabet_.assign(alphabet_set.begin(), alphabet_set.end());
-    std::sort(dfa.alphabet_.begin(), dfa.alphabet_.end());
+    // Move collected alphabet into the DFA and sort it by symbol string so the
+    // exported DOT/definition/grammar stay in a deterministic order.
+    for (std::size_t symbol = 0; symbol < in_alphabet.size(); ++symbol) {
+        if (in_alphabet[symbol]) {
+            dfa.alphabet_.push_back(static_cast<SymbolId>(symbol));
+        }
+    }
+    std::sort(dfa.alphabet_.begin(), dfa.alphabet_.end(),
+              [&symbols](SymbolId lhs, SymbolId rhs) {
+                  return symbols.name(lhs) < symbols.name(rhs);
+              });
 
     // Ensure DFA has a defined transition for every state-symbol pair.
     // This may create a sink state if any transitions are missing.
@@ -62,6 +74,120 @@ DFA DFA::from_pta(const PTA& pta) {
     return dfa;
 }
 
+DFA DFA::from_pta_classes(const PTA& pta,
+                          const SymbolTable& symbols,
+                          const std::vector<std::uint32_t>& class_of,
+                          std::uint32_t sink_class) {
+    const std::size_t node_count = pta.size();
+    if (class_of.size() != node_count) {
+        throw std::runtime_error("PTA class map does not match the PTA.");
+    }
+
+    DFA dfa;
+    dfa.symbols_ = symbols;
+    std::vector<char> in_alphabet(symbols.size(), 0);
+    for (std::size_t node = 1; node < node_count; ++node) {
+        const SymbolId symbol = pta.edge_symbol(static_cast<PTA::NodeId>(node));
+        if (symbol >= symbols.size()) {
+            throw std::runtime_error("PTA transition symbol missing from symbol table.");
+        }
+        in_alphabet[symbol] = 1;
+    }
+    for (std::size_t symbol = 0; symbol < in_alphabet.size(); ++symbol) {
+        if (in_alphabet[symbol]) {
+            dfa.alphabet_.push_back(static_cast<SymbolId>(symbol));
+        }
+    }
+    std::sort(dfa.alphabet_.begin(), dfa.alphabet_.end(),
+              [&symbols](SymbolId lhs, SymbolId rhs) {
+                  return symbols.name(lhs) < symbols.name(rhs);
+              });
+
+    // from_pta adds a sink whenever there is an alphabet (leaves have no
+    // edges); it is state `node_count` and belongs to `sink_class`. Number
+    // the classes by smallest member, as quotient() does.
+    const bool has_sink = !dfa.alphabet_.empty();
+    const std::size_t total = has_sink ? node_count + 1 : node_count;
+    constexpr std::size_t kUnnumbered = std::numeric_limits<std::size_t>::max();
+    std::vector<std::size_t> new_id;
+    std::vector<std::size_t> representative;
+    auto class_at = [&](std::size_t s) { return s < node_count ? class_of[s] : sink_class; };
+    for (std::size_t s = 0; s < total; ++s) {
+        const std::uint32_t block = class_at(s);
+        if (block >= new_id.size()) {
+            new_id.resize(static_cast<std::size_t>(block) + 1, kUnnumbered);
+        }
+        if (new_id[block] == kUnnumbered) {
+            new_id[block] = representative.size();
+            representative.push_back(s);
+        }
+    }
+
+    dfa.states_.resize(representative.size());
+    dfa.start_state_ = new_id[class_of[pta.start_state()]];
+    for (std::size_t s = 0; s < node_count; ++s) {
+        auto& merged = dfa.states_[new_id[class_of[s]]];
+        merged.positive_count += pta.positive_count(static_cast<PTA::NodeId>(s));
+        merged.negative_count += pta.negative_count(static_cast<PTA::NodeId>(s));
+    }
+    if (has_sink) {
+        // ensure_complete_transitions records the sink as one pseudo-negative.
+        dfa.states_[new_id[sink_class]].negative_count += 1;
+    }
+
+    for (std::size_t idx = 0; idx < representative.size(); ++idx) {
+        auto& state = dfa.states_[idx];
+        state.accepting = state.positive_count > state.negative_count;
+        const std::size_t rep = representative[idx];
+        const std::size_t fallback = has_sink ? new_id[sink_class] : idx;
+        for (const auto symbol : dfa.alphabet_) {
+            state.transitions[symbol] = rep == node_count ? idx : fallback;
+        }
+        if (rep < node_count) {
+            pta.for_each_child(static_cast<PTA::NodeId>(rep), [&](SymbolId symbol, PTA::NodeId child) {
+                state.transitions[symbol] = new_id[class_of[child]];
+            });
+        }
+    }
+
+    dfa.sink_state_ = has_sink ? new_id[sink_class] : std::numeric_limits<std::size_t>::max();
+    dfa.compiled_ = dfa.compile();
+    return dfa;
+}
+
+DFA DFA::from_states(std::vector<State> states,
+                     std::size_t start_state,
+                     std::vector<SymbolId> alphabet,
+                     const SymbolTable& symbols) {
+    if (!states.empty() && start_state >= states.size()) {
+        throw std::runtime_error("DFA start state out of bounds.");
+    }
+    for (const auto& state : states) {
+        for (const auto& [symbol, target] : state.transitions) {
+            if (target >= states.size()) {
+                throw std::runtime_error("DFA transition target out of bounds.");
+            }
+            if (symbol >= symbols.size()) {
+                throw std::runtime_error("DFA transition symbol missing from symbol table.");
+            }
+        }
+    }
+
+    DFA dfa;
+    dfa.symbols_ = symbols;
+    dfa.states_ = std::move(states);
+    dfa.start_state_ = start_state;
+    dfa.alphabet_ = std::move(alphabet);
+    std::sort(dfa.alphabet_.begin(), dfa.alphabet_.end(),
+              [&symbols](SymbolId lhs, SymbolId rhs) {
+                  return symbols.name(lhs) < symbols.name(rhs);
+              });
+    dfa.alphabet_.erase(std::unique(dfa.alphabet_.begin(), dfa.alphabet_.end()),
+                        dfa.alphabet_.end());
+    dfa.ensure_complete_transitions();
+    return dfa;
+}
+
 void DFA::ensure_complete_transitions() {
     if (alphabet_.empty()) {
         sink_state_ = std::numeric_limits<std::size_t>::max();
@@ -110,7 +236,13 @@ void DFA::ensure_complete_transitions() {
     }
 }
 
-bool DFA::classify(const std::vector<std::string>& sequence) const {
+bool DFA::classify(const std::vector<SymbolId>& sequence) const {
+    // Minimized DFAs carry a frozen dense table; walking it avoids a hash
+    // lookup and the sink fallback branch on every symbol.
+    if (!compiled_.empty()) {
+        return compiled_.classify(sequence);
+    }
+
     if (states_.empty()) {
         return false;
     }
@@ -142,193 +274,650 @@ bool DFA::classify(const std::vector<std::string>& sequence) const {
     return states_[current].accepting;
 }
 
-DFA DFA::minimize() const {
-    if (states_.empty()) {
-        return *this;
+void DFA::classify_batch(const std::vector<SymbolId>* const* sequences,
+                         std::size_t count,
+                         std::uint64_t* verdicts) const {
+    if (!compiled_.empty()) {
+        compiled_.classify_batch(sequences, count, verdicts);
+        return;
     }
+    std::fill(verdicts, verdicts + (count + 63) / 64, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        verdicts[i >> 6] |= std::uint64_t{classify(*sequences[i])} << (i & 63U);
+    }
+}
 
-    std::size_t n = states_.size();
-    // Hopcroft's minimization algorithm (partition refinement)
-    // 1. Initialize partitions into accepting and rejecting states
-    // 2. Use a work queue of (partition, symbol) to find states that transition
-    //    into the partition on that symbol; split partitions based on this info
-    //    until no more splits occur.
-    std::vector<std::vector<std::size_t>> partitions;
-    partitions.reserve(n);
-
-    std::vector<std::size_t> accepting;
-    std::vector<std::size_t> rejecting;
-    accepting.reserve(n);
-    rejecting.reserve(n);
+namespace {
+
+// Refinable partition of the states 0..n-1 (Valmari & Lehtinen). Each block
+// is a contiguous range of `elements_`; marking a state swaps it to the front
+// of its block, so splitting a block off its marked prefix is O(marked).
+class RefinablePartition {
+public:
+    explicit RefinablePartition(std::size_t n)
+        : elements_(n), location_(n), block_of_(n, 0) {
+        for (std::size_t i = 0; i < n; ++i) {
+            elements_[i] = i;
+            location_[i] = i;
+        }
+        if (n > 0) {
+            first_.push_back(0);
+            past_.push_back(n);
+            marked_end_.push_back(0);
+        }
+    }
 
-    for (std::size_t i = 0; i < n; ++i) {
-        if (states_[i].accepting) {
-            accepting.push_back(i);
-        } else {
-            rejecting.push_back(i);
+    std::size_t block_count() const { return first_.size(); }
+    std::size_t block_of(std::size_t state) const { return block_of_[state]; }
+    std::size_t block_size(std::size_t block) const { return past_[block] - first_[block]; }
+    const std::vector<std::size_t>& block_ids() const { return block_of_; }
+
+    // Members of `block`, valid until the next mark().
+    const std::size_t* begin(std::size_t block) const { return elements_.data() + first_[block]; }
+    const std::size_t* end(std::size_t block) const { return elements_.data() + past_[block]; }
+
+    void mark(std::size_t state) {
+        const std::size_t block = block_of_[state];
+        const std::size_t position = location_[state];
+        const std::size_t target = marked_end_[block];
+        if (position < target) {
+            return;  // already marked
+        }
+        if (target == first_[block]) {
+            touched_.push_back(block);
         }
+        std::swap(elements_[position], elements_[target]);
+        location_[elements_[position]] = position;
+        location_[elements_[target]] = target;
+        ++marked_end_[block];
     }
 
-    std::vector<int> state_partition(n, -1);
+    // Split every block that has both marked and unmarked states. The smaller
+    // side becomes the new block, so that `on_split(new_block)` can apply
+    // Hopcroft's "process the smaller half" rule. Clears all marks.
+    template <typename OnSplit>
+    void split_marked(OnSplit&& on_split) {
+        for (const auto block : touched_) {
+            const std::size_t marked = marked_end_[block] - first_[block];
+            const std::size_t unmarked = past_[block] - marked_end_[block];
+            if (unmarked == 0) {
+                marked_end_[block] = first_[block];
+                continue;
+            }
 
-    if (!accepting.empty()) {
-        partitions.push_back(accepting);
-        for (auto state : partitions.back()) {
-            state_partition[state] = static_cast<int>(partitions.size() - 1);
+            const std::size_t created = first_.size();
+            if (marked <= unmarked) {
+                first_.push_back(first_[block]);
+                past_.push_back(marked_end_[block]);
+                first_[block] = marked_end_[block];
+            } else {
+                first_.push_back(marked_end_[block]);
+                past_.push_back(past_[block]);
+                past_[block] = marked_end_[block];
+            }
+            marked_end_[block] = first_[block];
+            marked_end_.push_back(first_[created]);
+            for (std::size_t i = first_[created]; i < past_[created]; ++i) {
+                block_of_[elements_[i]] = created;
+            }
+            on_split(created);
         }
+        touched_.clear();
     }
-    if (!rejecting.empty()) {
-        partitions.push_back(rejecting);
-        for (auto state : partitions.back()) {
-            state_partition[state] = static_cast<int>(partitions.size() - 1);
+
+    // Move the states for which `pred` holds into a new block. Used to set up
+    // the initial partition.
+    template <typename Pred>
+    void separate(Pred&& pred) {
+        for (std::size_t state = 0; state < elements_.size(); ++state) {
+            if (pred(state)) {
+                mark(state);
+            }
         }
+        split_marked([](std::size_t) {});
     }
 
-    if (partitions.empty()) {
-        // Degenerate case: no states? ensure at least one partition
-        partitions.push_back({0});
-        state_partition[0] = 0;
+private:
+    std::vector<std::size_t> elements_;
+    std::vector<std::size_t> location_;
+    std::vector<std::size_t> block_of_;
+    std::vector<std::size_t> first_;
+    std::vector<std::size_t> past_;
+    std::vector<std::size_t> marked_end_;
+    std::vector<std::size_t> touched_;
+};
+
+// Fewest states per task in minimize_moore(); smaller ranges cost more in
+// scheduling than they save.
+constexpr std::size_t kMinStatesPerChunk = 4096;
+
+}  // namespace
+
+DFA DFA::minimize() const {
+    if (states_.empty()) {
+        return *this;
     }
 
-    // Work queue contains pairs (partition_index, symbol) to examine
-    std::queue<std::pair<std::size_t, std::string>> work;
-    for (std::size_t idx = 0; idx < partitions.size(); ++idx) {
-        for (const auto& symbol : alphabet_) {
-            work.emplace(idx, symbol);
+    // Hopcroft's algorithm, O(n·k·log n) for n states and k symbols:
+    //  1. Precompute inverse transitions per symbol, so a splitter (B, a)
+    //     only visits the predecessors of B instead of every state.
+    //  2. Keep the partition in a refinable-partition structure; a split
+    //     touches only the blocks that contain marked predecessors.
+    //  3. After a split only the smaller half is queued for every symbol.
+    //     (If (B, a) was already queued it still covers the larger half;
+    //     otherwise either half suffices.)
+    //
+    // Missing transitions are routed to a phantom state n that forms its own
+    // block, so partial automata are refined exactly as if the missing edge
+    // led somewhere distinct from every real state.
+    const std::size_t n = states_.size();
+    const std::size_t k = alphabet_.size();
+
+    std::vector<std::size_t> column;
+    for (std::size_t c = 0; c < k; ++c) {
+        const auto symbol = alphabet_[c];
+        if (symbol >= column.size()) {
+            column.resize(static_cast<std::size_t>(symbol) + 1, k);
         }
+        column[symbol] = c;
     }
 
-    // Temporary structures used during refinement
-    std::vector<char> involved_flag(n, 0);
-    std::vector<std::size_t> touched;
-    touched.reserve(n);
+    // Dense successor table, then counting sort into per-symbol CSR lists of
+    // predecessors keyed by target: preds of t on column c are
+    // inverse_sources[inverse_offsets[c*(n+2) + t] .. inverse_offsets[c*(n+2) + t + 1]).
+    const std::size_t phantom = n;
+    bool partial = false;
+    std::vector<std::size_t> successor(n * k, phantom);
+    for (std::size_t s = 0; s < n; ++s) {
+        std::size_t present = 0;
+        for (const auto& [symbol, target] : states_[s].transitions) {
+            if (symbol < column.size() && column[symbol] < k && target < n) {
+                successor[s * k + column[symbol]] = target;
+                ++present;
+            }
+        }
+        partial = partial || present < k;
+    }
 
-    // Main refinement loop: while work queue not empty, use the (P, a) pair to
-    // split partitions accordingly.
-    while (!work.empty()) {
-        auto [part_idx, symbol] = work.front();
-        work.pop();
-
-        // Find all states that on `symbol` transition into any state of partition
-        // `part_idx`. We mark those 'involved' states (involved_flag) and
-        // collect them in `touched` so we can later reset marks efficiently.
-        // This identifies which states in each block will be separated by the
-        // current refinement predicate.
+    const std::size_t total = partial ? n + 1 : n;
+    const std::size_t stride = total + 1;
+    std::vector<std::size_t> inverse_offsets(k * stride + 1, 0);
+    for (std::size_t s = 0; s < n; ++s) {
+        for (std::size_t c = 0; c < k; ++c) {
+            ++inverse_offsets[c * stride + successor[s * k + c] + 1];
+        }
+    }
+    for (std::size_t i = 1; i < inverse_offsets.size(); ++i) {
+        inverse_offsets[i] += inverse_offsets[i - 1];
+    }
+    std::vector<std::size_t> inverse_sources(inverse_offsets.back());
+    {
+        std::vector<std::size_t> cursor(inverse_offsets.begin(), inverse_offsets.end() - 1);
         for (std::size_t s = 0; s < n; ++s) {
-            auto it = states_[s].transitions.find(symbol);
-            if (it != states_[s].transitions.end() &&
-                state_partition[it->second] == static_cast<int>(part_idx)) {
-                if (!involved_flag[s]) {
-                    involved_flag[s] = 1;
-                    touched.push_back(s);
-                }
+            for (std::size_t c = 0; c < k; ++c) {
+                inverse_sources[cursor[c * stride + successor[s * k + c]]++] = s;
             }
         }
+    }
+    successor.clear();
+    successor.shrink_to_fit();
+
+    // Initial partition: accepting / rejecting (/ phantom).
+    RefinablePartition partition(total);
+    partition.separate([&](std::size_t s) { return s < n && states_[s].accepting; });
+    if (partial) {
+        partition.separate([&](std::size_t s) { return s == phantom; });
+    }
 
-        // For each partition, split into subset (states that lead into `part_idx`)
-        // and remainder (others). Replace original block with subset and append remainder
-        // as a new partition when both are non-empty.
-        // Examine each partition block and split it into two parts:
-        //  - subset: states that have a transition on `symbol` into `part_idx`
-        //  - remainder: the other states
-        // If both vectors are non-empty, the block is refined (split). We
-        // replace the original block with `subset` and append `remainder` as a
-        // new partition. We also update `state_partition` for each affected state
-        // so the partition mapping stays accurate.
-        for (std::size_t idx = 0; idx < partitions.size(); ++idx) {
-            auto& block = partitions[idx];
-            std::vector<std::size_t> subset;
-            std::vector<std::size_t> remainder;
-            subset.reserve(block.size());
-            remainder.reserve(block.size());
-
-            for (auto state : block) {
-                if (involved_flag[state]) {
-                    subset.push_back(state);
-                } else {
-                    remainder.push_back(state);
-                }
+    // Seed the work list with every initial block but the largest.
+    std::vector<std::pair<std::size_t, std::size_t>> work;
+    std::size_t largest = 0;
+    for (std::size_t b = 1; b < partition.block_count(); ++b) {
+        if (partition.block_size(b) > partition.block_size(largest)) {
+            largest = b;
+        }
+    }
+    for (std::size_t b = 0; b < partition.block_count(); ++b) {
+        if (b == largest) {
+            continue;
+        }
+        for (std::size_t c = 0; c < k; ++c) {
+            work.emplace_back(b, c);
+        }
+    }
+
+    std::vector<std::size_t> predecessors;
+    while (!work.empty()) {
+        const auto [splitter, c] = work.back();
+        work.pop_back();
+
+        // Collect first: marking reorders states inside blocks, including
+        // the splitter itself.
+        predecessors.clear();
+        for (const auto* t = partition.begin(splitter); t != partition.end(splitter); ++t) {
+            const std::size_t base = c * stride + *t;
+            predecessors.insert(predecessors.end(),
+                                inverse_sources.begin() + inverse_offsets[base],
+                                inverse_sources.begin() + inverse_offsets[base + 1]);
+        }
+        for (const auto s : predecessors) {
+            partition.mark(s);
+        }
+        partition.split_marked([&](std::size_t created) {
+            for (std::size_t symbol = 0; symbol < k; ++symbol) {
+                work.emplace_back(created, symbol);
             }
+        });
+    }
+
+    std::vector<std::size_t> block_of(partition.block_ids().begin(),
+                                      partition.block_ids().begin() + n);
+    return quotient(block_of);
+}
+
+DFA DFA::minimize_moore(ThreadPool& pool) const {
+    if (states_.empty()) {
+        return *this;
+    }
+
+    // As in minimize(), missing transitions go to a phantom state n. It is
+    // always present here: nothing uses it unless a transition is missing,
+    // and then it sits in a block of its own.
+    const std::size_t n = states_.size();
+    const std::size_t k = alphabet_.size();
+    const std::size_t total = n + 1;
+    if (total >= std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("DFA too large for minimize_moore().");
+    }
+    const auto phantom = static_cast<std::uint32_t>(n);
+
+    std::vector<std::size_t> column;
+    for (std::size_t c = 0; c < k; ++c) {
+        const auto symbol = alphabet_[c];
+        if (symbol >= column.size()) {
+            column.resize(static_cast<std::size_t>(symbol) + 1, k);
+        }
+        column[symbol] = c;
+    }
+
+    // Every pass runs over the same ranges of states, and a round hashes
+    // the states into as many buckets as there are ranges.
+    const std::size_t chunk_count =
+        std::clamp<std::size_t>(total / kMinStatesPerChunk, 1, pool.size() * 4);
+    auto for_each_chunk = [&](auto&& body) {
+        pool.parallel_for(chunk_count, [&](std::size_t chunk) {
+            body(chunk, total * chunk / chunk_count, total * (chunk + 1) / chunk_count);
+        });
+    };
 
-            // If the block can be split into non-empty subset and remainder,
-            // perform the partition update and re-enqueue refinement work for
-            // both produced blocks across all symbols. This ensures further
-            // cascading splits are discovered.
-            if (!subset.empty() && !remainder.empty()) {
-                block = std::move(subset);
-                auto new_index = partitions.size();
-                partitions.push_back(std::move(remainder));
-
-                for (auto state : partitions[idx]) {
-                    state_partition[state] = static_cast<int>(idx);
+    std::vector<std::uint32_t> successor(total * k, phantom);
+    std::vector<std::uint32_t> block(total);
+    for_each_chunk([&](std::size_t, std::size_t begin, std::size_t end) {
+        for (std::size_t s = begin; s < end; ++s) {
+            if (s == phantom) {
+                block[s] = 2;
+                continue;
+            }
+            for (const auto& [symbol, target] : states_[s].transitions) {
+                if (symbol < column.size() && column[symbol] < k && target < n) {
+                    successor[s * k + column[symbol]] = static_cast<std::uint32_t>(target);
                 }
-                for (auto state : partitions[new_index]) {
-                    state_partition[state] = static_cast<int>(new_index);
+            }
+            block[s] = states_[s].accepting ? 1 : 0;
+        }
+    });
+    // Initial blocks: rejecting, accepting, phantom (the first two may be empty).
+    std::size_t block_count = 1;
+    block_count += std::any_of(states_.begin(), states_.end(),
+                               [](const State& s) { return s.accepting; });
+    block_count += std::any_of(states_.begin(), states_.end(),
+                               [](const State& s) { return !s.accepting; });
+
+    // Row s of `signature` is block[s] followed by the block of each
+    // successor; `hash` caches a hash of each row.
+    const std::size_t width = k + 1;
+    std::vector<std::uint32_t> signature(total * width);
+    std::vector<std::uint64_t> hash(total);
+    auto row_hash = [&](std::uint32_t s) { return static_cast<std::size_t>(hash[s]); };
+    auto row_equal = [&](std::uint32_t lhs, std::uint32_t rhs) {
+        return std::equal(signature.begin() + lhs * width, signature.begin() + (lhs + 1) * width,
+                          signature.begin() + rhs * width);
+    };
+    using Groups = std::unordered_map<std::uint32_t, std::uint32_t, decltype(row_hash),
+                                      decltype(row_equal)>;
+
+    // bucket_cursor[chunk * chunk_count + bucket]: states of `chunk` in
+    // `bucket`, then where the chunk writes them in `order`.
+    std::vector<std::size_t> bucket_cursor(chunk_count * chunk_count);
+    std::vector<std::size_t> bucket_begin(chunk_count + 1);
+    std::vector<std::uint32_t> order(total);
+    std::vector<std::uint32_t> local_id(total);
+    std::vector<std::uint32_t> group_base(chunk_count + 1);
+    while (true) {
+        for_each_chunk([&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            std::size_t* counts = bucket_cursor.data() + chunk * chunk_count;
+            std::fill_n(counts, chunk_count, 0);
+            for (std::size_t s = begin; s < end; ++s) {
+                std::uint32_t* row = signature.data() + s * width;
+                row[0] = block[s];
+                for (std::size_t c = 0; c < k; ++c) {
+                    row[c + 1] = block[successor[s * k + c]];
                 }
-
-                // Enqueue refinement tasks for both blocks for every alphabet
-                // symbol. This drives further splitting until fixpoint.
-                for (const auto& sym : alphabet_) {
-                    work.emplace(idx, sym);
-                    work.emplace(new_index, sym);
+                std::uint64_t h = 0xcbf29ce484222325ULL;
+                for (std::size_t i = 0; i < width; ++i) {
+                    h = (h ^ row[i]) * 0x100000001b3ULL;
                 }
+                hash[s] = h ^ (h >> 29);
+                ++counts[hash[s] % chunk_count];
+            }
+        });
+
+        // Counting sort by bucket. Chunks are laid out in index order inside
+        // each bucket, so the numbering below does not depend on scheduling.
+        std::size_t offset = 0;
+        for (std::size_t bucket = 0; bucket < chunk_count; ++bucket) {
+            bucket_begin[bucket] = offset;
+            for (std::size_t chunk = 0; chunk < chunk_count; ++chunk) {
+                const std::size_t count = bucket_cursor[chunk * chunk_count + bucket];
+                bucket_cursor[chunk * chunk_count + bucket] = offset;
+                offset += count;
             }
         }
+        bucket_begin[chunk_count] = offset;
+        for_each_chunk([&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            std::size_t* cursor = bucket_cursor.data() + chunk * chunk_count;
+            for (std::size_t s = begin; s < end; ++s) {
+                order[cursor[hash[s] % chunk_count]++] = static_cast<std::uint32_t>(s);
+            }
+        });
+
+        // Equal rows hash to the same bucket, so each bucket numbers its own
+        // groups.
+        pool.parallel_for(chunk_count, [&](std::size_t bucket) {
+            Groups groups(16, row_hash, row_equal);
+            for (std::size_t i = bucket_begin[bucket]; i < bucket_begin[bucket + 1]; ++i) {
+                const std::uint32_t s = order[i];
+                local_id[s] =
+                    groups.emplace(s, static_cast<std::uint32_t>(groups.size())).first->second;
+            }
+            group_base[bucket + 1] = static_cast<std::uint32_t>(groups.size());
+        });
+        group_base[0] = 0;
+        for (std::size_t bucket = 0; bucket < chunk_count; ++bucket) {
+            group_base[bucket + 1] += group_base[bucket];
+        }
 
-        // Reset temporary marks
-        for (auto state : touched) {
-            involved_flag[state] = 0;
+        // Rows start with the old block, so blocks only ever split: the same
+        // count means no block split and the partition is stable.
+        if (group_base[chunk_count] == block_count) {
+            break;
         }
-        touched.clear();
+        block_count = group_base[chunk_count];
+        for_each_chunk([&](std::size_t, std::size_t begin, std::size_t end) {
+            for (std::size_t s = begin; s < end; ++s) {
+                block[s] = group_base[hash[s] % chunk_count] + local_id[s];
+            }
+        });
     }
 
-    DFA minimized;
-    minimized.alphabet_ = alphabet_;
-    minimized.states_.resize(partitions.size());
-    minimized.start_state_ = partitions.empty()
-                                 ? 0
-                                 : static_cast<std::size_t>(state_partition[start_state_]);
+    return quotient(std::vector<std::size_t>(block.begin(), block.begin() + n));
+}
 
-    std::vector<std::size_t> representative(partitions.size(), 0);
-    for (std::size_t idx = 0; idx < partitions.size(); ++idx) {
-        if (!partitions[idx].empty()) {
-            representative[idx] = partitions[idx].front();
+DFA DFA::quotient(const std::vector<std::size_t>& block_of) const {
+    const std::size_t n = states_.size();
+
+    // Number the classes in order of their smallest member, so the result is
+    // independent of how the refinement happened to label its blocks. The
+    // smallest member also serves as the representative whose edges are kept.
+    std::vector<std::size_t> class_of_block;
+    std::vector<std::size_t> new_id(n);
+    std::vector<std::size_t> representative;
+    for (std::size_t s = 0; s < n; ++s) {
+        const std::size_t block = block_of[s];
+        if (block >= class_of_block.size()) {
+            class_of_block.resize(block + 1, std::numeric_limits<std::size_t>::max());
+        }
+        if (class_of_block[block] == std::numeric_limits<std::size_t>::max()) {
+            class_of_block[block] = representative.size();
+            representative.push_back(s);
         }
+        new_id[s] = class_of_block[block];
     }
 
-    for (std::size_t idx = 0; idx < partitions.size(); ++idx) {
-        const auto& block = partitions[idx];
-        auto& new_state = minimized.states_[idx];
-        new_state.positive_count = 0;
-        new_state.negative_count = 0;
+    DFA minimized;
+    minimized.alphabet_ = alphabet_;
+    minimized.symbols_ = symbols_;
+    minimized.states_.resize(representative.size());
+    minimized.start_state_ = start_state_ < n ? new_id[start_state_] : 0;
+
+    for (std::size_t s = 0; s < n; ++s) {
+        auto& merged = minimized.states_[new_id[s]];
+        merged.positive_count += states_[s].positive_count;
+        merged.negative_count += states_[s].negative_count;
+    }
 
-        for (auto state : block) {
-            new_state.positive_count += states_[state].positive_count;
-            new_state.negative_count += states_[state].negative_count;
-        }
+    for (std::size_t idx = 0; idx < representative.size(); ++idx) {
+        auto& new_state = minimized.states_[idx];
         new_state.accepting = new_state.positive_count > new_state.negative_count;
 
-        const auto rep = representative[idx];
-        for (const auto& [symbol, target] : states_[rep].transitions) {
-            // Recreate transitions for the representative state's outgoing
-            // edges. Targets are mapped to their partition index (new state id)
-            // using the state_partition array so the minimized DFA transitions
-            // refer to the compressed state space.
-            new_state.transitions[symbol] =
-                static_cast<std::size_t>(state_partition[target]);
+        // Recreate the representative's outgoing edges with targets mapped to
+        // their class, which is the new state id.
+        for (const auto& [symbol, target] : states_[representative[idx]].transitions) {
+            new_state.transitions[symbol] = new_id[target];
         }
     }
 
-    if (sink_state_ < states_.size()) {
-        minimized.sink_state_ =
-            static_cast<std::size_t>(state_partition[sink_state_]);
+    if (sink_state_ < n) {
+        minimized.sink_state_ = new_id[sink_state_];
     } else {
         minimized.sink_state_ = std::numeric_limits<std::size_t>::max();
     }
 
+    minimized.compiled_ = minimized.compile();
     return minimized;
 }
 
+std::vector<std::size_t> DFA::breadth_first_order(std::size_t& reachable) const {
+    const std::size_t n = states_.size();
+    std::vector<char> queued(n, 0);
+    std::vector<std::size_t> order;
+    order.reserve(n);
+    if (sink_state_ < n) {
+        queued[sink_state_] = 1;
+    }
+    if (start_state_ < n && !queued[start_state_]) {
+        queued[start_state_] = 1;
+        order.push_back(start_state_);
+    }
+    // `order` doubles as the queue.
+    for (std::size_t head = 0; head < order.size(); ++head) {
+        const auto& transitions = states_[order[head]].transitions;
+        for (const auto symbol : alphabet_) {
+            auto it = transitions.find(symbol);
+            if (it != transitions.end() && !queued[it->second]) {
+                queued[it->second] = 1;
+                order.push_back(it->second);
+            }
+        }
+    }
+    reachable = order.size();
+    for (std::size_t s = 0; s < n; ++s) {
+        if (!queued[s]) {
+            order.push_back(s);
+        }
+    }
+    return order;
+}
+
+DFA DFA::permuted(const std::vector<std::size_t>& order) const {
+    const std::size_t n = states_.size();
+    std::vector<std::size_t> new_id(n);
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        new_id[order[i]] = i;
+    }
+    if (sink_state_ < n) {
+        new_id[sink_state_] = n - 1;
+    }
+
+    DFA renumbered;
+    renumbered.alphabet_ = alphabet_;
+    renumbered.symbols_ = symbols_;
+    renumbered.states_.resize(n);
+    for (std::size_t s = 0; s < n; ++s) {
+        auto& state = renumbered.states_[new_id[s]];
+        state.positive_count = states_[s].positive_count;
+        state.negative_count = states_[s].negative_count;
+        state.accepting = states_[s].accepting;
+        state.transitions.reserve(states_[s].transitions.size());
+        for (const auto& [symbol, target] : states_[s].transitions) {
+            state.transitions.emplace(symbol, new_id[target]);
+        }
+    }
+    renumbered.start_state_ = start_state_ < n ? new_id[start_state_] : start_state_;
+    renumbered.sink_state_ = sink_state_ < n ? n - 1 : sink_state_;
+    if (!compiled_.empty()) {
+        renumbered.compiled_ = renumbered.compile();
+    }
+    return renumbered;
+}
+
+DFA DFA::renumber_breadth_first() const {
+    std::size_t reachable = 0;
+    return permuted(breadth_first_order(reachable));
+}
+
+DFA DFA::renumber_by_visits(const std::vector<std::size_t>& visits) const {
+    const std::size_t n = states_.size();
+    if (visits.size() != n) {
+        throw std::runtime_error("State visit counts do not match the DFA.");
+    }
+
+    // Depth-first from the start state, most visited successor first (ties in
+    // alphabet order). A walk mostly follows its hottest successor, so the
+    // hot paths come out as runs of consecutive rows, hottest first; sorting
+    // the states by count alone would scatter every path across the table.
+    std::vector<char> numbered(n, 0);
+    if (sink_state_ < n) {
+        numbered[sink_state_] = 1;
+    }
+    std::vector<std::size_t> order;
+    order.reserve(n);
+    std::vector<std::size_t> stack;
+    std::vector<std::size_t> successors;
+    if (start_state_ < n) {
+        stack.push_back(start_state_);
+    }
+    while (!stack.empty()) {
+        const std::size_t state = stack.back();
+        stack.pop_back();
+        if (numbered[state]) {
+            continue;
+        }
+        numbered[state] = 1;
+        order.push_back(state);
+
+        successors.clear();
+        const auto& transitions = states_[state].transitions;
+        for (const auto symbol : alphabet_) {
+            auto it = transitions.find(symbol);
+            if (it != transitions.end() && !numbered[it->second]) {
+                successors.push_back(it->second);
+            }
+        }
+        std::stable_sort(successors.begin(), successors.end(),
+                         [&](std::size_t lhs, std::size_t rhs) { return visits[lhs] > visits[rhs]; });
+        // Pushed coldest first so the hottest is expanded next.
+        stack.insert(stack.end(), successors.rbegin(), successors.rend());
+    }
+    for (std::size_t s = 0; s < n; ++s) {
+        if (!numbered[s]) {
+            order.push_back(s);
+        }
+    }
+    return permuted(order);
+}
+
+void DFA::count_visits(const std::vector<SymbolId>& sequence,
+                       std::size_t weight,
+                       std::vector<std::size_t>& visits) const {
+    if (states_.empty() || start_state_ >= states_.size()) {
+        return;
+    }
+    if (visits.size() != states_.size()) {
+        throw std::runtime_error("State visit counts do not match the DFA.");
+    }
+
+    std::size_t current = start_state_;
+    visits[current] += weight;
+    for (const auto symbol : sequence) {
+        if (!compiled_.empty()) {
+            // The compiled dead state is a row past the DFA's states when
+            // there is no sink; nothing is counted from there on.
+            current = compiled_.step(static_cast<CompiledDFA::StateId>(current), symbol);
+            if (current >= states_.size()) {
+                return;
+            }
+        } else {
+            const auto& transitions = states_[current].transitions;
+            auto it = transitions.find(symbol);
+            if (it != transitions.end()) {
+                current = it->second;
+            } else if (sink_state_ < states_.size()) {
+                current = sink_state_;
+            } else {
+                return;
+            }
+        }
+        visits[current] += weight;
+    }
+}
+
+bool DFA::same_language(const DFA& other) const {
+    // Index `size` of either side stands for the implicit dead state.
+    const std::size_t dead_left = states_.size();
+    const std::size_t dead_right = other.states_.size();
+    auto accepts = [](const DFA& dfa, std::size_t state) {
+        return state < dfa.states_.size() && dfa.states_[state].accepting;
+    };
+    auto step = [](const DFA& dfa, std::size_t state, SymbolId symbol) {
+        if (state >= dfa.states_.size()) {
+            return state;
+        }
+        const auto& transitions = dfa.states_[state].transitions;
+        auto it = transitions.find(symbol);
+        return it == transitions.end() ? dfa.states_.size() : it->second;
+    };
+
+    std::vector<SymbolId> alphabet = alphabet_;
+    alphabet.insert(alphabet.end(), other.alphabet_.begin(), other.alphabet_.end());
+    std::sort(alphabet.begin(), alphabet.end());
+    alphabet.erase(std::unique(alphabet.begin(), alphabet.end()), alphabet.end());
+
+    const std::size_t left_start = states_.empty() ? dead_left : start_state_;
+    const std::size_t right_start = other.states_.empty() ? dead_right : other.start_state_;
+    const std::size_t right_width = dead_right + 1;
+
+    // Only reachable pairs are stored; a dense |Q1| x |Q2| bitmap would not
+    // fit for two large automata.
+    std::unordered_set<std::size_t> visited{left_start * right_width + right_start};
+    std::vector<std::pair<std::size_t, std::size_t>> frontier{{left_start, right_start}};
+    while (!frontier.empty()) {
+        const auto [left, right] = frontier.back();
+        frontier.pop_back();
+        if (accepts(*this, left) != accepts(other, right)) {
+            return false;
+        }
+        for (const auto symbol : alphabet) {
+            const auto next_left = step(*this, left, symbol);
+            const auto next_right = step(other, right, symbol);
+            if (visited.insert(next_left * right_width + next_right).second) {
+                frontier.emplace_back(next_left, next_right);
+            }
+        }
+    }
+    return true;
+}
+
 std::string DFA::to_dot() const {
     std::ostringstream out;
     out << "digraph DFA {\n";
@@ -351,10 +940,17 @@ std::string DFA::to_dot() const {
         out << "];\n";
     }
 
+    // Emit edges in alphabet order (rather than hash-map order) so the DOT
+    // output is stable across runs and platforms.
     for (std::size_t i = 0; i < states_.size(); ++i) {
-        for (const auto& [symbol, target] : states_[i].transitions) {
-            out << "  s" << i << " -> s" << target << " [label=\"" << symbol
-                << "\"];\n";
+        const auto& transitions = states_[i].transitions;
+        for (const auto symbol : alphabet_) {
+            auto it = transitions.find(symbol);
+            if (it == transitions.end()) {
+                continue;
+            }
+            out << "  s" << i << " -> s" << it->second << " [label=\""
+                << symbols_.name(symbol) << "\"];\n";
         }
     }
 
@@ -381,7 +977,7 @@ std::string DFA::to_definition() const {
         if (i != 0) {
             out << ", ";
         }
-        out << alphabet_[i];
+        out << symbols_.name(alphabet_[i]);
     }
     out << "}\n";
 
@@ -409,8 +1005,11 @@ std::string DFA::to_definition() const {
 
     out << "Transitions (δ):\n";
     for (std::size_t i = 0; i < states_.size(); ++i) {
-        std::vector<std::pair<std::string, std::size_t>> transitions(states_[i].transitions.begin(),
-                                                                     states_[i].transitions.end());
+        std::vector<std::pair<std::string, std::size_t>> transitions;
+        transitions.reserve(states_[i].transitions.size());
+        for (const auto& [symbol, target] : states_[i].transitions) {
+            transitions.emplace_back(symbols_.name(symbol), target);
+        }
         std::sort(transitions.begin(), transitions.end(),
                   [](const auto& lhs, const auto& rhs) {
                       if (lhs.first == rhs.first) {
@@ -451,7 +1050,7 @@ std::string DFA::to_chomsky() const {
     out << "Terminals: {";
     for (std::size_t i = 0; i < alphabet_.size(); ++i) {
         if (i != 0) out << ", ";
-        out << quote(alphabet_[i]);
+        out << quote(symbols_.name(alphabet_[i]));
     }
     out << "}\n";
 
@@ -481,7 +1080,7 @@ std::string DFA::to_chomsky() const {
     out << "Start: S\n";
 
     // We'll create helper nonterminals T0..Tk mapping to terminals
-    std::unordered_map<std::string, std::string> term_to_T;
+    std::unordered_map<SymbolId, std::string> term_to_T;
     term_to_T.reserve(alphabet_.size());
     for (std::size_t i = 0; i < alphabet_.size(); ++i) {
         term_to_T[alphabet_[i]] = "T" + std::to_string(i);
@@ -491,7 +1090,7 @@ std::string DFA::to_chomsky() const {
 
     // Emit terminal nonterminal mappings first: Tn -> terminal (quoted as needed)
     for (std::size_t i = 0; i < alphabet_.size(); ++i) {
-        out << "  T" << i << " -> " << quote(alphabet_[i]) << "\n";
+        out << "  T" << i << " -> " << quote(symbols_.name(alphabet_[i])) << "\n";
     }
 
     // For each DFA-state nonterminal A_i produce CNF productions
@@ -527,7 +1126,7 @@ std::string DFA::to_chomsky() const {
             // production Tn -> terminal emitted above.
             if (target < states_.size() && states_[target].accepting) {
                 std::ostringstream termprod;
-                termprod << quote(symbol);
+                termprod << quote(symbols_.name(symbol));
                 opts.insert(termprod.str());
             }
         }
@@ -0,0 +1,397 @@
+#include "automata/dfa.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "project_config.hpp"
+
+namespace automata_security {
+
+namespace {
+
+// The hash the generated header evaluates at compile time. It is written
+// out verbatim below, so both sides must stay identical.
+constexpr std::uint64_t kFnvBasis = 0xcbf29ce484222325ULL;
+
+std::uint64_t fnv1a(std::uint64_t hash, const std::string& text) {
+    for (const char c : text) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+std::uint32_t mix(std::uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x85ebca6bU;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35U;
+    x ^= x >> 16;
+    return x;
+}
+
+const char* const kHashSource =
+    "// 64-bit FNV-1a of `text`, continuing from `hash`: hashing a prefix and\n"
+    "// then a value gives the hash of their concatenation.\n"
+    "constexpr std::uint64_t fnv1a(std::uint64_t hash, std::string_view text) {\n"
+    "    for (const char c : text) {\n"
+    "        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;\n"
+    "    }\n"
+    "    return hash;\n"
+    "}\n"
+    "\n"
+    "constexpr std::uint32_t mix(std::uint32_t x) {\n"
+    "    x ^= x >> 16;\n"
+    "    x *= 0x85ebca6bU;\n"
+    "    x ^= x >> 13;\n"
+    "    x *= 0xc2b2ae35U;\n"
+    "    x ^= x >> 16;\n"
+    "    return x;\n"
+    "}\n";
+
+// Generated lists wrap before this column; starting a list here puts its
+// first item on a new line.
+constexpr std::size_t kWrapColumn = 96;
+
+std::size_t next_power_of_two(std::size_t n) {
+    std::size_t power = 1;
+    while (power < n) {
+        power *= 2;
+    }
+    return power;
+}
+
+// Perfect hash of the alphabet by hash-and-displace, at half load: the upper half
+// of a label's hash picks a bucket, and the bucket's seed, mixed with the
+// lower half, picks a slot. Seeds are searched bucket by bucket, largest
+// first, until every label has a slot of its own.
+struct PerfectHash {
+    std::vector<std::uint32_t> seeds;  // one per bucket
+    std::vector<std::uint32_t> slots;  // column per slot; `empty` when unused
+
+    PerfectHash(const std::vector<std::string>& labels, std::uint32_t empty) {
+        const std::size_t bucket_count = next_power_of_two(std::max<std::size_t>(1, labels.size() / 2));
+        const std::size_t slot_count = next_power_of_two(std::max<std::size_t>(1, 2 * labels.size()));
+        seeds.assign(bucket_count, 0);
+        slots.assign(slot_count, empty);
+
+        std::vector<std::uint64_t> hashes(labels.size());
+        std::vector<std::vector<std::uint32_t>> buckets(bucket_count);
+        for (std::size_t column = 0; column < labels.size(); ++column) {
+            hashes[column] = fnv1a(kFnvBasis, labels[column]);
+            buckets[(hashes[column] >> 32) & (bucket_count - 1)].push_back(
+                static_cast<std::uint32_t>(column));
+        }
+        std::vector<std::size_t> order(bucket_count);
+        for (std::size_t b = 0; b < bucket_count; ++b) {
+            order[b] = b;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) {
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+
+        constexpr std::uint32_t kMaxSeedTries = 1U << 24;
+        std::vector<std::size_t> placed;
+        for (const auto bucket : order) {
+            const auto& members = buckets[bucket];
+            if (members.empty()) {
+                break;
+            }
+            bool found = false;
+            for (std::uint32_t seed = 0; seed < kMaxSeedTries && !found; ++seed) {
+                placed.clear();
+                found = true;
+                for (const auto column : members) {
+                    const std::size_t slot =
+                        mix(static_cast<std::uint32_t>(hashes[column]) ^ seed) & (slot_count - 1);
+                    if (slots[slot] != empty ||
+                        std::find(placed.begin(), placed.end(), slot) != placed.end()) {
+                        found = false;
+                        break;
+                    }
+                    placed.push_back(slot);
+                }
+                if (found) {
+                    seeds[bucket] = seed;
+                    for (std::size_t i = 0; i < members.size(); ++i) {
+                        slots[placed[i]] = members[i];
+                    }
+                }
+            }
+            if (!found) {
+                // Only labels with equal 64-bit hashes can get here.
+                throw std::runtime_error("Failed to build a perfect hash for the DFA alphabet.");
+            }
+        }
+    }
+};
+
+// Smallest unsigned type that holds `max_value`.
+const char* table_type(std::size_t max_value) {
+    if (max_value <= std::numeric_limits<std::uint8_t>::max()) {
+        return "std::uint8_t";
+    }
+    if (max_value <= std::numeric_limits<std::uint16_t>::max()) {
+        return "std::uint16_t";
+    }
+    return "std::uint32_t";
+}
+
+bool valid_namespace(const std::string& name) {
+    // One or more identifiers joined by "::".
+    std::size_t begin = 0;
+    while (true) {
+        const std::size_t end = std::min(name.find("::", begin), name.size());
+        if (end == begin || std::isdigit(static_cast<unsigned char>(name[begin]))) {
+            return false;
+        }
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto c = static_cast<unsigned char>(name[i]);
+            if (!std::isalnum(c) && c != '_') {
+                return false;
+            }
+        }
+        if (end == name.size()) {
+            return true;
+        }
+        begin = end + 2;
+    }
+}
+
+std::string cpp_string_literal(const std::string& text) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    std::string out = "\"";
+    for (const char c : text) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (byte < 0x20 || byte >= 0x7F) {
+            // Hex escapes are greedy, so close the literal after each one.
+            out += "\\x";
+            out += kHex[byte >> 4];
+            out += kHex[byte & 0xF];
+            out += "\" \"";
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+    return out;
+}
+
+// `values` as a brace list that starts at `column` of the current line and
+// wraps onto lines starting with `indent`.
+template <typename Values, typename Format>
+void write_list(std::ostringstream& out,
+                const Values& values,
+                std::size_t column,
+                const char* indent,
+                Format&& format) {
+    out << "{";
+    ++column;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        const std::string item = format(values[i]) + (i + 1 < values.size() ? "," : "");
+        if (column + item.size() + 1 > kWrapColumn) {
+            out << "\n" << indent;
+            column = std::char_traits<char>::length(indent);
+        } else if (i > 0) {
+            out << " ";
+            ++column;
+        }
+        out << item;
+        column += item.size();
+    }
+    out << "}";
+}
+
+}  // namespace
+
+std::string DFA::to_cpp_header(const std::string& name_space, const SequenceOptions& sequences) const {
+    if (!valid_namespace(name_space)) {
+        throw std::runtime_error("Invalid C++ namespace for header export: " + name_space);
+    }
+    if (states_.empty()) {
+        throw std::runtime_error("Cannot export a DFA without states.");
+    }
+    if (states_.size() >= std::numeric_limits<std::uint32_t>::max() ||
+        alphabet_.size() >= std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("DFA too large for header export.");
+    }
+
+    // Columns follow the alphabet (sorted by label), as in the binary model,
+    // plus a last "unknown symbol" column whose transitions stay put.
+    const std::size_t symbol_count = alphabet_.size();
+    const std::size_t width = symbol_count + 1;
+    std::vector<std::string> labels;
+    std::unordered_map<SymbolId, std::uint32_t> column_of;
+    for (std::size_t column = 0; column < symbol_count; ++column) {
+        labels.push_back(symbols_.name(alphabet_[column]));
+        column_of.emplace(alphabet_[column], static_cast<std::uint32_t>(column));
+    }
+    std::vector<std::uint32_t> table(states_.size() * width);
+    std::vector<bool> accepting(states_.size());
+    for (std::size_t state = 0; state < states_.size(); ++state) {
+        auto* row = table.data() + state * width;
+        std::fill(row, row + width, static_cast<std::uint32_t>(state));
+        for (const auto& [symbol, target] : states_[state].transitions) {
+            const auto it = column_of.find(symbol);
+            if (it == column_of.end() || target >= states_.size()) {
+                throw std::runtime_error("DFA transition outside the automaton while exporting header.");
+            }
+            row[it->second] = static_cast<std::uint32_t>(target);
+        }
+        accepting[state] = states_[state].accepting;
+    }
+    const auto unknown = static_cast<std::uint32_t>(symbol_count);
+    const PerfectHash hash(labels, unknown);
+    const std::size_t sink = sink_state_ < states_.size() ? sink_state_ : states_.size();
+
+    // classify_record() rebuilds a per-row sequence of proto=/state=/service=
+    // symbols, so it only matches a model trained on those.
+    const bool per_row = sequences.per_row_defaults();
+    auto number = [](std::uint32_t value) { return std::to_string(value); };
+    std::ostringstream out;
+    out << "// Generated by security-dfa-gen " << kVersion << " (generator --export-header)\n"
+        << "// from a minimized DFA with " << states_.size() << " states over " << symbol_count
+        << " symbols. Do not edit.\n"
+        << "//\n"
+        << "// The transition table and a perfect hash of the symbol labels are\n"
+        << "// constexpr, so classification needs no model file and no runtime setup:\n"
+        << "//\n"
+        << "//   " << name_space << "::classify({\"proto=tcp\", \"state=S0\"})\n";
+    if (per_row) {
+        out << "//   " << name_space << "::classify_record(proto, conn_state, service)\n";
+    } else {
+        out << "//\n"
+            << "// The model was trained on sequences built with\n"
+            << "//   " << sequence_flags(sequences) << "\n"
+            << "// which classify_record(proto, conn_state, service) cannot rebuild, so it\n"
+            << "// is not generated.\n";
+    }
+    out << "//\n"
+        << "// As with the binary model (api --model), a symbol outside the alphabet\n"
+        << "// leaves the state unchanged.\n"
+        << "#pragma once\n\n"
+        << "#include <cstdint>\n"
+        << "#include <initializer_list>\n"
+        << "#include <string_view>\n\n"
+        << "namespace " << name_space << " {\n\n"
+        << "inline constexpr std::uint32_t kStateCount = " << states_.size() << ";\n"
+        << "inline constexpr std::uint32_t kSymbolCount = " << symbol_count << ";\n"
+        << "inline constexpr std::uint32_t kStartState = " << start_state_ << ";\n"
+        << "// kStateCount when the DFA has no sink.\n"
+        << "inline constexpr std::uint32_t kSinkState = " << sink << ";\n"
+        << "// Column of every symbol outside the alphabet.\n"
+        << "inline constexpr std::uint32_t kUnknownSymbol = kSymbolCount;\n\n";
+
+    out << "// Label of each column, sorted.\n"
+        << "inline constexpr std::string_view kSymbols[kSymbolCount + 1] = ";
+    labels.emplace_back();  // the unknown column, so the array is never empty
+    write_list(out, labels, kWrapColumn, "    ", cpp_string_literal);
+    labels.pop_back();
+    out << ";\n\n";
+
+    out << "// kTransitions[state][column]; the last column is kUnknownSymbol.\n"
+        << "inline constexpr " << table_type(states_.size() - 1)
+        << " kTransitions[kStateCount][kSymbolCount + 1] = {\n";
+    for (std::size_t state = 0; state < states_.size(); ++state) {
+        const std::vector<std::uint32_t> row(table.begin() + state * width,
+                                             table.begin() + (state + 1) * width);
+        out << "    ";
+        write_list(out, row, 4, "     ", number);
+        out << ",\n";
+    }
+    out << "};\n\n";
+
+    out << "inline constexpr bool kAccepting[kStateCount] = ";
+    write_list(out, accepting, kWrapColumn, "    ", [](bool value) -> std::string { return value ? "true" : "false"; });
+    out << ";\n\n";
+
+    out << "namespace detail {\n\n"
+        << kHashSource << "\n"
+        << "// Perfect hash of the labels: the upper half of a label's hash picks a\n"
+        << "// bucket, and the bucket's seed mixed with the lower half picks its slot.\n"
+        << "inline constexpr std::uint64_t kHashBasis = 0x" << std::hex << kFnvBasis << std::dec
+        << "ULL;\n"
+        << "inline constexpr std::uint32_t kBucketMask = " << hash.seeds.size() - 1 << ";\n"
+        << "inline constexpr std::uint32_t kSlotMask = " << hash.slots.size() - 1 << ";\n"
+        << "inline constexpr std::uint32_t kBucketSeeds[kBucketMask + 1] = ";
+    write_list(out, hash.seeds, kWrapColumn, "    ", number);
+    out << ";\n"
+        << "// Column stored at each slot, or kUnknownSymbol for a free slot.\n"
+        << "inline constexpr " << table_type(unknown) << " kSlotColumns[kSlotMask + 1] = ";
+    write_list(out, hash.slots, kWrapColumn, "    ", number);
+    out << ";\n\n"
+        << "constexpr std::uint32_t column_of_hash(std::uint64_t hash) {\n"
+        << "    const std::uint32_t seed = kBucketSeeds[static_cast<std::uint32_t>(hash >> 32) & kBucketMask];\n"
+        << "    return kSlotColumns[mix(static_cast<std::uint32_t>(hash) ^ seed) & kSlotMask];\n"
+        << "}\n\n"
+        << "}  // namespace detail\n\n";
+
+    out << "// Column of `symbol` (e.g. \"proto=tcp\"), or kUnknownSymbol.\n"
+        << "constexpr std::uint32_t column(std::string_view symbol) {\n"
+        << "    const std::uint32_t column = detail::column_of_hash(detail::fnv1a(detail::kHashBasis, symbol));\n"
+        << "    return kSymbols[column] == symbol ? column : kUnknownSymbol;\n"
+        << "}\n\n"
+        << "// Column of the symbol `prefix` + `value` (e.g. \"proto=\", \"tcp\"), without\n"
+        << "// building the string.\n"
+        << "constexpr std::uint32_t column(std::string_view prefix, std::string_view value) {\n"
+        << "    const std::uint32_t column =\n"
+        << "        detail::column_of_hash(detail::fnv1a(detail::fnv1a(detail::kHashBasis, prefix), value));\n"
+        << "    const std::string_view label = kSymbols[column];\n"
+        << "    const bool match = label.size() == prefix.size() + value.size() &&\n"
+        << "                       label.substr(0, prefix.size()) == prefix &&\n"
+        << "                       label.substr(prefix.size()) == value;\n"
+        << "    return match ? column : kUnknownSymbol;\n"
+        << "}\n\n"
+        << "constexpr std::uint32_t step(std::uint32_t state, std::uint32_t column) {\n"
+        << "    return kTransitions[state][column];\n"
+        << "}\n\n"
+        << "constexpr bool accepting(std::uint32_t state) {\n"
+        << "    return kAccepting[state];\n"
+        << "}\n\n"
+        << "// True when the DFA accepts `symbols`, a range of labels convertible to\n"
+        << "// std::string_view.\n"
+        << "template <typename Symbols>\n"
+        << "constexpr bool classify(const Symbols& symbols) {\n"
+        << "    std::uint32_t state = kStartState;\n"
+        << "    for (const auto& symbol : symbols) {\n"
+        << "        state = step(state, column(std::string_view(symbol)));\n"
+        << "    }\n"
+        << "    return accepting(state);\n"
+        << "}\n\n"
+        << "constexpr bool classify(std::initializer_list<std::string_view> symbols) {\n"
+        << "    return classify<std::initializer_list<std::string_view>>(symbols);\n"
+        << "}\n\n";
+    if (per_row) {
+        out << "// One conn.log record, tokenized like the trainer's parser: a proto=,\n"
+            << "// state= and service= symbol for each field that is not empty or \"-\",\n"
+            << "// or symbol=unknown when none is.\n"
+            << "constexpr bool classify_record(std::string_view proto,\n"
+            << "                               std::string_view conn_state,\n"
+            << "                               std::string_view service) {\n"
+            << "    std::uint32_t state = kStartState;\n"
+            << "    bool any = false;\n"
+            << "    const std::string_view fields[3][2] = {\n"
+            << "        {\"proto=\", proto}, {\"state=\", conn_state}, {\"service=\", service}};\n"
+            << "    for (const auto& field : fields) {\n"
+            << "        if (!field[1].empty() && field[1] != \"-\") {\n"
+            << "            state = step(state, column(field[0], field[1]));\n"
+            << "            any = true;\n"
+            << "        }\n"
+            << "    }\n"
+            << "    if (!any) {\n"
+            << "        state = step(state, column(\"symbol=unknown\"));\n"
+            << "    }\n"
+            << "    return accepting(state);\n"
+            << "}\n\n";
+    }
+    out << "}  // namespace " << name_space << "\n";
+    return out.str();
+}
+
+}  // namespace automata_security
@@ -0,0 +1,243 @@
+#include "automata/dfa_model.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "automata/dfa.hpp"
+
+namespace automata_security {
+namespace {
+
+constexpr std::uint32_t kNoColumn = std::numeric_limits<std::uint32_t>::max();
+// Version 1 headers end where the sequence fields start.
+constexpr std::size_t kVersion1HeaderSize = offsetof(DfaModelHeader, row_features);
+
+// The sections are written and mapped as native integers, so the format is
+// only defined for little-endian hosts (x86-64, AArch64).
+bool host_is_little_endian() {
+    const std::uint16_t probe = 1;
+    unsigned char low = 0;
+    std::memcpy(&low, &probe, 1);
+    return low == 1;
+}
+
+std::uint64_t align8(std::uint64_t offset) {
+    return (offset + 7U) & ~std::uint64_t{7};
+}
+
+template <typename T>
+void write_at(std::string& out, std::uint64_t offset, const T* values, std::size_t count) {
+    if (count != 0) {
+        std::memcpy(&out[static_cast<std::size_t>(offset)], values, count * sizeof(T));
+    }
+}
+
+}  // namespace
+
+std::string serialize_dfa_model(const DFA& dfa, const SequenceOptions& sequences) {
+    if (!host_is_little_endian()) {
+        throw std::runtime_error("DFA model format requires a little-endian host.");
+    }
+    const auto& states = dfa.states();
+    const auto& alphabet = dfa.alphabet();
+    const auto& symbols = dfa.symbols();
+    if (states.empty()) {
+        throw std::runtime_error("Cannot export a DFA without states.");
+    }
+    if (states.size() >= kDfaModelNoSink || alphabet.size() >= kDfaModelNoSink) {
+        throw std::runtime_error("DFA too large for the model format.");
+    }
+    const auto state_count = static_cast<std::uint32_t>(states.size());
+    const auto symbol_count = static_cast<std::uint32_t>(alphabet.size());
+
+    // Labels in alphabet order, which is already sorted by name.
+    std::vector<std::uint32_t> label_offsets(static_cast<std::size_t>(symbol_count) + 1, 0);
+    std::vector<std::uint32_t> column_of(symbols.size(), kNoColumn);
+    std::string label_bytes;
+    for (std::uint32_t column = 0; column < symbol_count; ++column) {
+        const auto& name = symbols.name(alphabet[column]);
+        if (column > 0 && !(symbols.name(alphabet[column - 1]) < name)) {
+            throw std::runtime_error("DFA alphabet is not sorted by label.");
+        }
+        label_bytes += name;
+        if (label_bytes.size() >= std::numeric_limits<std::uint32_t>::max()) {
+            throw std::runtime_error("DFA labels too large for the model format.");
+        }
+        label_offsets[column + 1] = static_cast<std::uint32_t>(label_bytes.size());
+        column_of[alphabet[column]] = column;
+    }
+
+    std::vector<std::uint32_t> table(static_cast<std::size_t>(state_count) * symbol_count);
+    std::vector<std::uint64_t> accepting((static_cast<std::size_t>(state_count) + 63) / 64, 0);
+    std::vector<std::uint64_t> positive(state_count);
+    std::vector<std::uint64_t> negative(state_count);
+    for (std::uint32_t state = 0; state < state_count; ++state) {
+        auto* row = table.data() + static_cast<std::size_t>(state) * symbol_count;
+        std::fill(row, row + symbol_count, state);
+        for (const auto& [symbol, target] : states[state].transitions) {
+            if (symbol >= column_of.size() || column_of[symbol] == kNoColumn) {
+                throw std::runtime_error("DFA transition symbol outside alphabet while exporting model.");
+            }
+            if (target >= states.size()) {
+                throw std::runtime_error("DFA transition target out of bounds while exporting model.");
+            }
+            row[column_of[symbol]] = static_cast<std::uint32_t>(target);
+        }
+        if (states[state].accepting) {
+            accepting[state >> 6] |= std::uint64_t{1} << (state & 63U);
+        }
+        positive[state] = states[state].positive_count;
+        negative[state] = states[state].negative_count;
+    }
+
+    DfaModelHeader header{};
+    std::memcpy(header.magic, kDfaModelMagic, sizeof(header.magic));
+    header.version = kDfaModelVersion;
+    header.header_size = sizeof(DfaModelHeader);
+    header.state_count = state_count;
+    header.symbol_count = symbol_count;
+    header.start_state = static_cast<std::uint32_t>(dfa.start_state());
+    header.sink_state = dfa.sink_state() < states.size() ? static_cast<std::uint32_t>(dfa.sink_state())
+                                                         : kDfaModelNoSink;
+    header.label_offsets_offset = align8(sizeof(DfaModelHeader));
+    header.label_bytes_offset = align8(header.label_offsets_offset + label_offsets.size() * sizeof(std::uint32_t));
+    header.table_offset = align8(header.label_bytes_offset + label_bytes.size());
+    header.accepting_offset = align8(header.table_offset + table.size() * sizeof(std::uint32_t));
+    header.positive_counts_offset = header.accepting_offset + accepting.size() * sizeof(std::uint64_t);
+    header.negative_counts_offset = header.positive_counts_offset + positive.size() * sizeof(std::uint64_t);
+    header.file_size = header.negative_counts_offset + negative.size() * sizeof(std::uint64_t);
+    if (sequences.window_rows > std::numeric_limits<std::uint32_t>::max() ||
+        sequences.stride > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("Sequence window too large for the model format.");
+    }
+    header.row_features = (sequences.duration_symbols ? kDfaModelDurationSymbols : 0U) |
+                          (sequences.byte_symbols ? kDfaModelByteSymbols : 0U);
+    header.group_by = static_cast<std::uint32_t>(sequences.group_by);
+    header.window = static_cast<std::uint32_t>(sequences.window);
+    header.window_rows = static_cast<std::uint32_t>(sequences.window_rows);
+    header.window_stride = static_cast<std::uint32_t>(sequences.stride);
+
+    // Padding between sections stays zero.
+    std::string out(static_cast<std::size_t>(header.file_size), '\0');
+    write_at(out, 0, &header, 1);
+    write_at(out, header.label_offsets_offset, label_offsets.data(), label_offsets.size());
+    write_at(out, header.label_bytes_offset, label_bytes.data(), label_bytes.size());
+    write_at(out, header.table_offset, table.data(), table.size());
+    write_at(out, header.accepting_offset, accepting.data(), accepting.size());
+    write_at(out, header.positive_counts_offset, positive.data(), positive.size());
+    write_at(out, header.negative_counts_offset, negative.data(), negative.size());
+    return out;
+}
+
+DfaModel::DfaModel(const std::string& path) : file_(path) {
+    const auto fail = [&path](const std::string& what) {
+        throw std::runtime_error("Invalid DFA model " + path + ": " + what);
+    };
+    if (!host_is_little_endian()) {
+        fail("model format requires a little-endian host");
+    }
+
+    const char* base = file_.data();
+    const std::uint64_t size = file_.size();
+    if (size < kVersion1HeaderSize) {
+        fail("file too small");
+    }
+    header_ = reinterpret_cast<const DfaModelHeader*>(base);
+    if (std::memcmp(header_->magic, kDfaModelMagic, sizeof(kDfaModelMagic)) != 0) {
+        fail("bad magic");
+    }
+    if (header_->version != 1 && header_->version != kDfaModelVersion) {
+        fail("unsupported version " + std::to_string(header_->version));
+    }
+    const std::uint64_t header_size = header_->version == 1 ? kVersion1HeaderSize : sizeof(DfaModelHeader);
+    if (header_->header_size != header_size || header_->file_size != size || size < header_size) {
+        fail("size mismatch");
+    }
+    if (header_->version != 1) {
+        if ((header_->row_features & ~(kDfaModelDurationSymbols | kDfaModelByteSymbols)) != 0 ||
+            header_->group_by > static_cast<std::uint32_t>(SequenceOptions::GroupBy::kUid) ||
+            header_->window > static_cast<std::uint32_t>(SequenceOptions::Window::kSliding) ||
+            header_->window_rows == 0 || header_->window_stride == 0) {
+            fail("bad sequence options");
+        }
+        sequences_.duration_symbols = (header_->row_features & kDfaModelDurationSymbols) != 0;
+        sequences_.byte_symbols = (header_->row_features & kDfaModelByteSymbols) != 0;
+        sequences_.group_by = static_cast<SequenceOptions::GroupBy>(header_->group_by);
+        sequences_.window = static_cast<SequenceOptions::Window>(header_->window);
+        sequences_.window_rows = header_->window_rows;
+        sequences_.stride = header_->window_stride;
+    }
+
+    const std::uint64_t states = header_->state_count;
+    const std::uint64_t symbols = header_->symbol_count;
+    if (states == 0 || states >= kDfaModelNoSink || symbols >= kDfaModelNoSink) {
+        fail("bad state or symbol count");
+    }
+    if (header_->start_state >= states ||
+        (header_->sink_state != kDfaModelNoSink && header_->sink_state >= states)) {
+        fail("start or sink state out of range");
+    }
+
+    // Every section must be aligned and lie inside the file. Counts are
+    // 32-bit, so none of these products overflow 64 bits.
+    const auto section = [&](std::uint64_t offset, std::uint64_t bytes) {
+        if (offset % 8 != 0 || offset < header_size || offset > size || bytes > size - offset) {
+            fail("section out of bounds");
+        }
+        return base + offset;
+    };
+    label_offsets_ = reinterpret_cast<const std::uint32_t*>(
+        section(header_->label_offsets_offset, (symbols + 1) * sizeof(std::uint32_t)));
+    const std::uint64_t label_size = label_offsets_[symbols];
+    label_bytes_ = section(header_->label_bytes_offset, label_size);
+    table_ = reinterpret_cast<const std::uint32_t*>(
+        section(header_->table_offset, states * symbols * sizeof(std::uint32_t)));
+    accepting_ = reinterpret_cast<const std::uint64_t*>(
+        section(header_->accepting_offset, (states + 63) / 64 * sizeof(std::uint64_t)));
+    positive_counts_ = reinterpret_cast<const std::uint64_t*>(
+        section(header_->positive_counts_offset, states * sizeof(std::uint64_t)));
+    negative_counts_ = reinterpret_cast<const std::uint64_t*>(
+        section(header_->negative_counts_offset, states * sizeof(std::uint64_t)));
+
+    // column() binary-searches the labels, so they must be strictly sorted.
+    if (label_offsets_[0] != 0) {
+        fail("bad label offsets");
+    }
+    for (std::uint32_t column = 0; column < symbols; ++column) {
+        if (label_offsets_[column + 1] < label_offsets_[column]) {
+            fail("bad label offsets");
+        }
+        if (column > 0 && !(label(column - 1) < label(column))) {
+            fail("labels not sorted");
+        }
+    }
+
+    const std::uint32_t* const end = table_ + states * symbols;
+    if (std::any_of(table_, end, [states](std::uint32_t target) { return target >= states; })) {
+        fail("transition target out of range");
+    }
+}
+
+std::uint32_t DfaModel::column(std::string_view label_view) const {
+    std::uint32_t low = 0;
+    std::uint32_t high = header_->symbol_count;
+    while (low < high) {
+        const std::uint32_t mid = low + (high - low) / 2;
+        const int order = label(mid).compare(label_view);
+        if (order == 0) {
+            return mid;
+        }
+        if (order < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return header_->symbol_count;
+}
+
+}  // namespace automata_security
@@ -0,0 +1,138 @@
+#include "automata/incremental_minimizer.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace automata_security {
+
+std::size_t IncrementalMinimizer::SignatureHash::operator()(const Signature& signature) const {
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const auto value : signature) {
+        hash = (hash ^ value) * 0x100000001b3ULL;
+    }
+    return static_cast<std::size_t>(hash ^ (hash >> 32));
+}
+
+IncrementalMinimizer::IncrementalMinimizer(PTA& pta) : pta_(pta) {
+    // The dead class is pinned by the sink, which is not a PTA node.
+    acquire(Signature{0});
+    class_of_.assign(pta_.size(), kNoClass);
+    dirty_flag_.assign(pta_.size(), 0);
+    // Children always have larger ids than their parent, so descending ids
+    // visit every node after its children.
+    for (std::size_t node = pta_.size(); node-- > 0;) {
+        classify(static_cast<PTA::NodeId>(node));
+    }
+}
+
+template <typename Sample>
+void IncrementalMinimizer::add_samples(const std::vector<Sample>& samples) {
+    for (const auto& sample : samples) {
+        pta_.insert(sample);
+        auto node = static_cast<PTA::NodeId>(pta_.start_state());
+        mark_dirty(node);
+        for (const auto symbol : sample.symbols) {
+            node = pta_.child(node, symbol);
+            mark_dirty(node);
+        }
+    }
+}
+
+void IncrementalMinimizer::add(const std::vector<LabeledSequence>& samples) {
+    add_samples(samples);
+}
+
+void IncrementalMinimizer::add(const std::vector<WeightedSequence>& records) {
+    add_samples(records);
+}
+
+void IncrementalMinimizer::mark_dirty(PTA::NodeId node) {
+    if (node >= dirty_flag_.size()) {
+        dirty_flag_.resize(pta_.size(), 0);
+    }
+    if (!dirty_flag_[node]) {
+        dirty_flag_[node] = 1;
+        dirty_.push_back(node);
+    }
+}
+
+void IncrementalMinimizer::refresh() {
+    class_of_.resize(pta_.size(), kNoClass);
+    std::sort(dirty_.begin(), dirty_.end(), std::greater<PTA::NodeId>());
+
+    std::vector<ClassId> vacated;
+    for (const auto node : dirty_) {
+        dirty_flag_[node] = 0;
+        const ClassId old_class = class_of_[node];
+        classify(node);
+        if (old_class != kNoClass && members_[old_class] == 0) {
+            vacated.push_back(old_class);
+        }
+    }
+    dirty_.clear();
+
+    // Empty classes are dropped only now: until every marked node has been
+    // reclassified, stale signatures may still name them, and reusing their
+    // ids early could merge states that differ.
+    for (const auto cls : vacated) {
+        if (members_[cls] == 0 && signature_of_[cls] != nullptr) {
+            register_.erase(*signature_of_[cls]);
+            signature_of_[cls] = nullptr;
+            free_classes_.push_back(cls);
+        }
+    }
+}
+
+DFA IncrementalMinimizer::dfa(const SymbolTable& symbols) {
+    refresh();
+    return DFA::from_pta_classes(pta_, symbols, class_of_, kDeadClass);
+}
+
+void IncrementalMinimizer::signature(PTA::NodeId node, Signature& out) {
+    out.clear();
+    out.push_back(pta_.positive_count(node) > pta_.negative_count(node) ? 1U : 0U);
+    child_classes_.clear();
+    pta_.for_each_child(node, [&](SymbolId symbol, PTA::NodeId child) {
+        if (class_of_[child] != kDeadClass) {
+            child_classes_.emplace_back(symbol, class_of_[child]);
+        }
+    });
+    std::sort(child_classes_.begin(), child_classes_.end());
+    for (const auto& [symbol, cls] : child_classes_) {
+        out.push_back(symbol);
+        out.push_back(cls);
+    }
+}
+
+IncrementalMinimizer::ClassId IncrementalMinimizer::acquire(const Signature& signature) {
+    auto it = register_.find(signature);
+    if (it != register_.end()) {
+        ++members_[it->second];
+        return it->second;
+    }
+    ClassId cls;
+    if (!free_classes_.empty()) {
+        cls = free_classes_.back();
+        free_classes_.pop_back();
+    } else {
+        cls = static_cast<ClassId>(members_.size());
+        members_.push_back(0);
+        signature_of_.push_back(nullptr);
+    }
+    // Element addresses in an unordered_map survive rehashing.
+    signature_of_[cls] = &register_.emplace(signature, cls).first->first;
+    members_[cls] = 1;
+    return cls;
+}
+
+void IncrementalMinimizer::classify(PTA::NodeId node) {
+    signature(node, scratch_);
+    const ClassId cls = acquire(scratch_);
+    const ClassId old_class = class_of_[node];
+    if (old_class != kNoClass) {
+        --members_[old_class];
+    }
+    class_of_[node] = cls;
+}
+
+}  // namespace automata_security
@@ -1,73 +1,544 @@
 #include "automata/pta.hpp"
 #include <stdexcept>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string_view>
+#include <utility>
+
+#include "utils/mapped_file.hpp"
+#include "utils/thread_pool.hpp"
 
 namespace automata_security {
 
+namespace {
+
+// Snapshot layout (little-endian), written and read in this order:
+//
+//   SnapshotHeader
+//   uint32 label_offsets[symbol_count + 1], then the label bytes
+//   uint32 first_child[node_count], next_sibling[node_count],
+//          edge_symbol[node_count] (snapshot-local symbol ids)
+//   uint64 positive_count[node_count], negative_count[node_count]
+//
+// Snapshot symbol ids number the labels in the file; the root's edge symbol
+// is kInvalidSymbol.
+struct SnapshotHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::uint64_t node_count;
+    std::uint64_t symbol_count;
+};
+
+constexpr char kSnapshotMagic[8] = {'S', 'D', 'F', 'A', 'P', 'T', 'A', '\0'};
+constexpr std::uint32_t kSnapshotVersion = 1;
+
+bool little_endian() {
+    const std::uint32_t one = 1;
+    return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+template <typename T>
+void write_array(std::ofstream& out, const std::vector<T>& values) {
+    out.write(reinterpret_cast<const char*>(values.data()),
+              static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+// Bounds-checked sequential reader over a mapped snapshot.
+class SnapshotReader {
+public:
+    SnapshotReader(std::string_view bytes, const std::string& path) : bytes_(bytes), path_(path) {}
+
+    [[noreturn]] void fail(const std::string& what) const {
+        throw std::runtime_error("Invalid PTA snapshot " + path_ + ": " + what);
+    }
+
+    const char* take(std::uint64_t size) {
+        if (size > bytes_.size() - pos_) {
+            fail("truncated file");
+        }
+        const char* data = bytes_.data() + pos_;
+        pos_ += static_cast<std::size_t>(size);
+        return data;
+    }
+
+    template <typename T>
+    void read_array(std::vector<T>& out, std::uint64_t count) {
+        if (count > (bytes_.size() - pos_) / sizeof(T)) {
+            fail("truncated file");
+        }
+        out.resize(static_cast<std::size_t>(count));
+        std::memcpy(out.data(), take(count * sizeof(T)), out.size() * sizeof(T));
+    }
+
+    bool at_end() const { return pos_ == bytes_.size(); }
+
+private:
+    std::string_view bytes_;
+    const std::string& path_;
+    std::size_t pos_{0};
+};
+
+// Below this many samples per chunk the parallel build is not worth the merge.
+constexpr std::size_t kMinSamplesPerChunk = 16384;
+
+// Trie of one contiguous chunk of the samples. creator[n] is the index (in
+// the whole sample list) of the sample that created local node n.
+struct ChunkTrie {
+    PTA trie;
+    std::vector<std::size_t> creator{0};
+};
+
+// Union of the chunk tries below one depth-1 node; local node 0 is that
+// node. A node keeps the creator from the first chunk that has it: chunks
+// are in sample order, so that is the sample that creates it in a
+// sequential build.
+struct MergedSubtree {
+    std::vector<PTA::NodeId> first_child;
+    std::vector<PTA::NodeId> next_sibling;
+    std::vector<SymbolId> symbol;
+    std::vector<std::size_t> positive;
+    std::vector<std::size_t> negative;
+    std::vector<std::size_t> creator;
+    std::vector<std::size_t> depth;
+
+    PTA::NodeId add(PTA::NodeId parent, SymbolId edge, std::size_t created_by, std::size_t at_depth) {
+        const auto node = static_cast<PTA::NodeId>(first_child.size());
+        first_child.push_back(PTA::kNoNode);
+        next_sibling.push_back(parent == PTA::kNoNode ? PTA::kNoNode : first_child[parent]);
+        symbol.push_back(edge);
+        positive.push_back(0);
+        negative.push_back(0);
+        creator.push_back(created_by);
+        depth.push_back(at_depth);
+        if (parent != PTA::kNoNode) {
+            first_child[parent] = node;
+        }
+        return node;
+    }
+
+    PTA::NodeId child(PTA::NodeId node, SymbolId edge) const {
+        for (PTA::NodeId c = first_child[node]; c != PTA::kNoNode; c = next_sibling[c]) {
+            if (symbol[c] == edge) {
+                return c;
+            }
+        }
+        return PTA::kNoNode;
+    }
+
+    // Add the subtree of `chunk` below its depth-1 node `top`.
+    void merge(const ChunkTrie& chunk, PTA::NodeId top) {
+        if (first_child.empty()) {
+            add(PTA::kNoNode, chunk.trie.edge_symbol(top), chunk.creator[top], 1);
+        }
+        std::vector<std::pair<PTA::NodeId, PTA::NodeId>> pending{{top, 0}};
+        while (!pending.empty()) {
+            const auto [local, merged] = pending.back();
+            pending.pop_back();
+            positive[merged] += chunk.trie.positive_count(local);
+            negative[merged] += chunk.trie.negative_count(local);
+            chunk.trie.for_each_child(local, [&](SymbolId edge, PTA::NodeId local_child) {
+                PTA::NodeId merged_child = child(merged, edge);
+                if (merged_child == PTA::kNoNode) {
+                    merged_child = add(merged, edge, chunk.creator[local_child], depth[merged] + 1);
+                }
+                pending.emplace_back(local_child, merged_child);
+            });
+        }
+    }
+};
+
+}  // namespace
+
 PTA::PTA() : start_state_(0) {
     ensure_root();
 }
 
 std::size_t PTA::ensure_root() {
-    if (nodes_.empty()) {
-        Node root;
-        root.id = 0;
-        nodes_.push_back(std::move(root));
+    if (first_child_.empty()) {
+        first_child_.push_back(kNoNode);
+        next_sibling_.push_back(kNoNode);
+        edge_symbol_.push_back(kInvalidSymbol);
+        positive_count_.push_back(0);
+        negative_count_.push_back(0);
     }
     start_state_ = 0;
     return start_state_;
 }
 
-std::size_t PTA::add_node() {
-    Node node;
-    node.id = nodes_.size();
-    nodes_.push_back(std::move(node));
-    return nodes_.back().id;
+PTA::NodeId PTA::add_child(NodeId parent, SymbolId symbol) {
+    if (first_child_.size() >= kNoNode) {
+        throw std::runtime_error("PTA node limit exceeded.");
+    }
+    const auto child = static_cast<NodeId>(first_child_.size());
+    // Prepend to the parent's sibling list; lookups scan it linearly, which
+    // is cheap for the typical fan-out of one or two.
+    first_child_.push_back(kNoNode);
+    next_sibling_.push_back(first_child_[parent]);
+    edge_symbol_.push_back(symbol);
+    positive_count_.push_back(0);
+    negative_count_.push_back(0);
+    first_child_[parent] = child;
+    return child;
 }
 
-void PTA::build(const std::vector<LabeledSequence>& samples) {
+PTA::NodeId PTA::child(NodeId node, SymbolId symbol) const {
+    for (NodeId c = first_child_[node]; c != kNoNode; c = next_sibling_[c]) {
+        if (edge_symbol_[c] == symbol) {
+            return c;
+        }
+    }
+    return kNoNode;
+}
+
+void PTA::reset() {
     // Rebuild PTA from scratch: clear existing nodes and create root
-    nodes_.clear();
+    first_child_.clear();
+    next_sibling_.clear();
+    edge_symbol_.clear();
+    positive_count_.clear();
+    negative_count_.clear();
     ensure_root();
+}
 
-    // For each labeled sequence, walk (or grow) the trie according to symbols
-    // encountered. Each symbol corresponds to an edge labeled with the token
-    // (e.g. `proto=tcp`). The node reached after consuming all symbols of the
-    // sequence is updated with positive/negative counts depending on the label.
-    for (const auto& sample : samples) {
-        std::size_t current = start_state_;
-        // basic invariant: current must always be a valid node index
-        assert(current < nodes_.size());
-
-        for (const auto& symbol : sample.symbols) {
-            // Ensure current is valid before accessing its transitions
-            assert(current < nodes_.size());
-
-            // If the transition for this symbol doesn't exist, create a new node
-            // and wire the edge from `current` to the new child.
-            auto it = nodes_[current].transitions.find(symbol);
-            if (it == nodes_[current].transitions.end()) {
-                std::size_t child_id = add_node();
-                // add_node() should append a node and return a valid id
-                assert(child_id < nodes_.size());
-                nodes_[current].transitions.emplace(symbol, child_id);
-                current = child_id;
-            } else {
-                // Reuse existing branch in the trie
-                assert(it->second < nodes_.size());
-                current = it->second;
+void PTA::build(const std::vector<LabeledSequence>& samples) {
+    reset();
+    add(samples);
+}
+
+void PTA::build(const std::vector<WeightedSequence>& records) {
+    reset();
+    add(records);
+}
+
+template <typename Sample>
+void PTA::build_parallel(const std::vector<Sample>& samples, ThreadPool& pool) {
+    const std::size_t size = samples.size();
+    const std::size_t chunk_count =
+        std::clamp<std::size_t>(size / kMinSamplesPerChunk, 1, pool.size());
+    if (chunk_count == 1) {
+        build(samples);
+        return;
+    }
+
+    std::vector<ChunkTrie> chunks(chunk_count);
+    pool.parallel_for(chunk_count, [&](std::size_t chunk) {
+        const std::size_t begin = size * chunk / chunk_count;
+        const std::size_t end = size * (chunk + 1) / chunk_count;
+        auto& local = chunks[chunk];
+        for (std::size_t i = begin; i < end; ++i) {
+            local.trie.insert(samples[i]);
+            local.creator.resize(local.trie.size(), i);
+        }
+    });
+
+    // Subtrees below different depth-1 nodes share no nodes, so each one is
+    // merged (and later written out) by its own task.
+    std::vector<SymbolId> tops;
+    for (const auto& chunk : chunks) {
+        chunk.trie.for_each_child(0, [&](SymbolId symbol, NodeId) { tops.push_back(symbol); });
+    }
+    std::sort(tops.begin(), tops.end());
+    tops.erase(std::unique(tops.begin(), tops.end()), tops.end());
+
+    // A sequential build numbers nodes in creation order: by creating sample,
+    // then by depth, since a sample creates the deepest nodes of its path.
+    // created[i] counts the nodes sample i creates; all of them lie below
+    // its first symbol, so each subtree task writes its own entries.
+    std::vector<MergedSubtree> subtrees(tops.size());
+    std::vector<std::size_t> created(size, 0);
+    pool.parallel_for(tops.size(), [&](std::size_t t) {
+        auto& subtree = subtrees[t];
+        for (const auto& chunk : chunks) {
+            const NodeId top = chunk.trie.child(0, tops[t]);
+            if (top != kNoNode) {
+                subtree.merge(chunk, top);
             }
         }
+        for (const auto creator : subtree.creator) {
+            ++created[creator];
+        }
+    });
 
-        // Update leaf counts: positive_count for labelled-positive samples,
-        // negative_count otherwise. These counts are later used to mark
-        // accepting/rejecting behavior when converting to DFA.
-        if (sample.label) {
-            nodes_[current].positive_count += 1;
-        } else {
-            nodes_[current].negative_count += 1;
+    // first_id[i]: id of the first node sample i creates.
+    std::vector<std::size_t> first_id(size);
+    std::size_t next_id = 1;
+    for (std::size_t i = 0; i < size; ++i) {
+        first_id[i] = next_id;
+        next_id += created[i];
+    }
+    if (next_id >= kNoNode) {
+        throw std::runtime_error("PTA node limit exceeded.");
+    }
+    auto global_id = [&](const MergedSubtree& subtree, NodeId node) {
+        const std::size_t creator = subtree.creator[node];
+        const std::size_t first_depth = samples[creator].symbols.size() - created[creator] + 1;
+        return static_cast<NodeId>(first_id[creator] + subtree.depth[node] - first_depth);
+    };
+
+    first_child_.assign(next_id, kNoNode);
+    next_sibling_.assign(next_id, kNoNode);
+    edge_symbol_.assign(next_id, kInvalidSymbol);
+    positive_count_.assign(next_id, 0);
+    negative_count_.assign(next_id, 0);
+    start_state_ = 0;
+    for (const auto& chunk : chunks) {
+        positive_count_[0] += chunk.trie.positive_count(0);
+        negative_count_[0] += chunk.trie.negative_count(0);
+    }
+
+    // Sibling lists are prepended on insertion, so they run from the newest
+    // child to the oldest: by descending id.
+    auto link_children = [this](NodeId parent, std::vector<NodeId>& children) {
+        std::sort(children.begin(), children.end(), std::greater<NodeId>());
+        first_child_[parent] = children.empty() ? kNoNode : children.front();
+        for (std::size_t c = 0; c + 1 < children.size(); ++c) {
+            next_sibling_[children[c]] = children[c + 1];
+        }
+    };
+    pool.parallel_for(tops.size(), [&](std::size_t t) {
+        const auto& subtree = subtrees[t];
+        std::vector<NodeId> children;
+        for (NodeId node = 0; node < subtree.symbol.size(); ++node) {
+            const NodeId id = global_id(subtree, node);
+            edge_symbol_[id] = subtree.symbol[node];
+            positive_count_[id] = subtree.positive[node];
+            negative_count_[id] = subtree.negative[node];
+            children.clear();
+            for (NodeId c = subtree.first_child[node]; c != kNoNode; c = subtree.next_sibling[c]) {
+                children.push_back(global_id(subtree, c));
+            }
+            link_children(id, children);
         }
+    });
+    std::vector<NodeId> roots;
+    for (const auto& subtree : subtrees) {
+        roots.push_back(global_id(subtree, 0));
     }
+    link_children(0, roots);
+}
+
+void PTA::build(const std::vector<LabeledSequence>& samples, ThreadPool& pool) {
+    build_parallel(samples, pool);
+}
+
+void PTA::build(const std::vector<WeightedSequence>& records, ThreadPool& pool) {
+    build_parallel(records, pool);
+}
+
+void PTA::add(const std::vector<LabeledSequence>& samples) {
+    for (const auto& sample : samples) {
+        insert(sample);
+    }
+}
+
+void PTA::add(const std::vector<WeightedSequence>& records) {
+    for (const auto& record : records) {
+        insert(record);
+    }
+}
+
+PTA::NodeId PTA::walk(const std::vector<SymbolId>& symbols) {
+    // Walk (or grow) the trie according to the symbols of the sample. Each
+    // symbol corresponds to an edge labeled with the interned id of the token
+    // (e.g. `proto=tcp`), so stepping the trie only compares integers.
+    auto current = static_cast<NodeId>(start_state_);
+    // basic invariant: current must always be a valid node index
+    assert(current < size());
+
+    for (const auto& symbol : symbols) {
+        // If the transition for this symbol doesn't exist, create a new node
+        // and wire the edge from `current` to the new child. Otherwise reuse
+        // the existing branch in the trie.
+        const NodeId next = child(current, symbol);
+        current = next != kNoNode ? next : add_child(current, symbol);
+        assert(current < size());
+    }
+    return current;
+}
+
+void PTA::insert(const LabeledSequence& sample) {
+    const NodeId current = walk(sample.symbols);
+    // Update leaf counts: positive_count for labelled-positive samples,
+    // negative_count otherwise. These counts are later used to mark
+    // accepting/rejecting behavior when converting to DFA.
+    if (sample.label) {
+        positive_count_[current] += 1;
+    } else {
+        negative_count_[current] += 1;
+    }
+}
+
+void PTA::insert(const WeightedSequence& record) {
+    insert(record.symbols, record.positive_count, record.negative_count);
+}
+
+void PTA::insert(const std::vector<SymbolId>& symbols, std::size_t positive, std::size_t negative) {
+    const NodeId current = walk(symbols);
+    positive_count_[current] += positive;
+    negative_count_[current] += negative;
+}
+
+void PTA::save(const std::string& path, const SymbolTable& symbols) const {
+    if (!little_endian()) {
+        throw std::runtime_error("PTA snapshots require a little-endian host.");
+    }
+    const std::size_t n = size();
+
+    // Only the symbols that label an edge are stored, renumbered in order of
+    // their ids so reloading into an empty table reproduces the same ids.
+    std::vector<SymbolId> local_id(symbols.size(), kInvalidSymbol);
+    for (std::size_t node = 1; node < n; ++node) {
+        if (edge_symbol_[node] >= symbols.size()) {
+            throw std::runtime_error("PTA edge symbol missing from symbol table.");
+        }
+        local_id[edge_symbol_[node]] = 0;
+    }
+    std::vector<std::uint32_t> label_offsets{0};
+    std::string labels;
+    SymbolId next_local = 0;
+    for (std::size_t id = 0; id < local_id.size(); ++id) {
+        if (local_id[id] == kInvalidSymbol) {
+            continue;
+        }
+        local_id[id] = next_local++;
+        labels += symbols.name(static_cast<SymbolId>(id));
+        if (labels.size() >= std::numeric_limits<std::uint32_t>::max()) {
+            throw std::runtime_error("PTA symbol names too large for a snapshot.");
+        }
+        label_offsets.push_back(static_cast<std::uint32_t>(labels.size()));
+    }
+    std::vector<SymbolId> edges(n, kInvalidSymbol);
+    for (std::size_t node = 1; node < n; ++node) {
+        edges[node] = local_id[edge_symbol_[node]];
+    }
+    const std::vector<std::uint64_t> positive(positive_count_.begin(), positive_count_.end());
+    const std::vector<std::uint64_t> negative(negative_count_.begin(), negative_count_.end());
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.version = kSnapshotVersion;
+    header.node_count = n;
+    header.symbol_count = next_local;
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to open PTA snapshot for writing: " + path);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_array(out, label_offsets);
+    out.write(labels.data(), static_cast<std::streamsize>(labels.size()));
+    write_array(out, first_child_);
+    write_array(out, next_sibling_);
+    write_array(out, edges);
+    write_array(out, positive);
+    write_array(out, negative);
+    if (!out) {
+        throw std::runtime_error("Failed to write PTA snapshot: " + path);
+    }
+}
+
+PTA PTA::load(const std::string& path, SymbolTable& symbols) {
+    if (!little_endian()) {
+        throw std::runtime_error("PTA snapshots require a little-endian host.");
+    }
+    const MappedFile file(path);
+    SnapshotReader reader(file.view(), path);
+
+    SnapshotHeader header;
+    std::memcpy(&header, reader.take(sizeof(header)), sizeof(header));
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+        reader.fail("bad magic");
+    }
+    if (header.version != kSnapshotVersion) {
+        reader.fail("unsupported version " + std::to_string(header.version));
+    }
+    if (header.node_count == 0 || header.node_count >= kNoNode || header.symbol_count >= kInvalidSymbol) {
+        reader.fail("bad node or symbol count");
+    }
+    const auto n = static_cast<std::size_t>(header.node_count);
+
+    std::vector<std::uint32_t> label_offsets;
+    reader.read_array(label_offsets, header.symbol_count + 1);
+    if (label_offsets[0] != 0) {
+        reader.fail("bad label offsets");
+    }
+    const char* labels = reader.take(label_offsets.back());
+    std::vector<SymbolId> remap(static_cast<std::size_t>(header.symbol_count));
+    for (std::size_t id = 0; id < remap.size(); ++id) {
+        if (label_offsets[id + 1] < label_offsets[id]) {
+            reader.fail("bad label offsets");
+        }
+        remap[id] = symbols.intern(std::string(labels + label_offsets[id], label_offsets[id + 1] - label_offsets[id]));
+    }
+
+    PTA pta;
+    std::vector<std::uint64_t> positive;
+    std::vector<std::uint64_t> negative;
+    reader.read_array(pta.first_child_, n);
+    reader.read_array(pta.next_sibling_, n);
+    reader.read_array(pta.edge_symbol_, n);
+    reader.read_array(positive, n);
+    reader.read_array(negative, n);
+    if (!reader.at_end()) {
+        reader.fail("trailing bytes");
+    }
+
+    // The links must form a tree rooted at node 0. Children are appended
+    // after their parent and prepended to its sibling list, so a first-child
+    // link points forward and a sibling link backward; each node may be the
+    // target of one link only.
+    std::vector<char> linked(n, 0);
+    const auto link = [&](NodeId target) {
+        if (target == kNoNode) {
+            return;
+        }
+        if (linked[target]) {
+            reader.fail("node linked twice");
+        }
+        linked[target] = 1;
+    };
+    if (pta.edge_symbol_[0] != kInvalidSymbol || pta.next_sibling_[0] != kNoNode) {
+        reader.fail("bad root");
+    }
+    for (std::size_t node = 0; node < n; ++node) {
+        const NodeId child = pta.first_child_[node];
+        const NodeId sibling = pta.next_sibling_[node];
+        if ((child != kNoNode && (child <= node || child >= n)) || (sibling != kNoNode && sibling >= node)) {
+            reader.fail("bad node links");
+        }
+        link(child);
+        link(sibling);
+        if (node > 0) {
+            if (pta.edge_symbol_[node] >= remap.size()) {
+                reader.fail("edge symbol out of range");
+            }
+            pta.edge_symbol_[node] = remap[pta.edge_symbol_[node]];
+        }
+    }
+    // A walk from the root must then reach every node (a detached cycle of
+    // links would otherwise pass the checks above).
+    std::size_t reached = 0;
+    std::vector<NodeId> pending{0};
+    while (!pending.empty()) {
+        const NodeId node = pending.back();
+        pending.pop_back();
+        ++reached;
+        for (NodeId c = pta.first_child_[node]; c != kNoNode; c = pta.next_sibling_[c]) {
+            pending.push_back(c);
+        }
+    }
+    if (reached != n) {
+        reader.fail("unreachable node");
+    }
+
+    pta.positive_count_.assign(positive.begin(), positive.end());
+    pta.negative_count_.assign(negative.begin(), negative.end());
+    pta.start_state_ = 0;
+    return pta;
 }
 
 }  // namespace automata_security
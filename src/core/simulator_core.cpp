@@ -65,6 +65,46 @@ std::pair<bool, std::string> GrammarDFA::classify_with_reason(const std::vector<
     return {false, oss.str()};
 }
 
+FrozenGrammarDFA FrozenGrammarDFA::from(const GrammarDFA& dfa) {
+    FrozenGrammarDFA frozen;
+    frozen.names_ = dfa.names;
+    frozen.accepting_.assign(dfa.accepting.begin(), dfa.accepting.end());
+    frozen.start_ = static_cast<std::uint32_t>(dfa.start);
+
+    // Number the labels in first-seen order, then lay out the table with one
+    // extra identity column for labels outside the alphabet.
+    std::unordered_map<std::string, std::uint32_t> label_ids;
+    for (const auto& row : dfa.trans) {
+        for (const auto& [label, target] : row) {
+            if (label_ids.emplace(label, static_cast<std::uint32_t>(frozen.labels_.size())).second) {
+                frozen.labels_.push_back(label);
+            }
+        }
+    }
+    for (std::size_t i = 0; i < frozen.labels_.size(); ++i) {
+        frozen.columns_.emplace(frozen.labels_[i], static_cast<std::uint32_t>(i));
+    }
+    frozen.width_ = static_cast<std::uint32_t>(frozen.labels_.size() + 1);
+
+    const std::size_t states = dfa.names.size();
+    frozen.table_.resize(states * frozen.width_);
+    for (std::size_t state = 0; state < states; ++state) {
+        auto* row = frozen.table_.data() + state * frozen.width_;
+        for (std::uint32_t c = 0; c < frozen.width_; ++c) row[c] = static_cast<std::uint32_t>(state);
+        for (const auto& [label, target] : dfa.trans[state]) {
+            row[label_ids[label]] = static_cast<std::uint32_t>(target);
+        }
+    }
+    return frozen;
+}
+
+std::uint32_t FrozenGrammarDFA::find_state(const std::string& name) const {
+    for (std::size_t i = 0; i < names_.size(); ++i) {
+        if (names_[i] == name) return static_cast<std::uint32_t>(i);
+    }
+    return static_cast<std::uint32_t>(names_.size());
+}
+
 bool load_cnf_grammar(const std::string& path, GrammarDFA& out, std::string& err) {
     std::ifstream in(path);
     if (!in.is_open()) { err = "failed to open grammar file"; return false; }
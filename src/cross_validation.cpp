@@ -0,0 +1,207 @@
+#include "cross_validation.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <stdexcept>
+
+#include "automata/dfa.hpp"
+#include "automata/pta.hpp"
+#include "utils/parser.hpp"
+
+namespace automata_security {
+namespace {
+
+struct LabelCounts {
+    std::size_t positive{0};
+    std::size_t negative{0};
+};
+
+// Classify every record that has test samples once, and count it as many
+// times as it has test samples of each label.
+ConfusionCounts tally_records(const DFA& dfa,
+                              const std::vector<WeightedSequence>& records,
+                              const std::vector<LabelCounts>& test) {
+    constexpr std::size_t kBatchSize = 64;
+    ConfusionCounts counts;
+    const std::vector<SymbolId>* sequences[kBatchSize];
+    std::size_t members[kBatchSize];
+    std::size_t batch = 0;
+    auto flush = [&]() {
+        std::uint64_t verdicts = 0;
+        dfa.classify_batch(sequences, batch, &verdicts);
+        for (std::size_t i = 0; i < batch; ++i) {
+            const auto& weight = test[members[i]];
+            if (((verdicts >> i) & 1U) != 0) {
+                counts.true_positive += weight.positive;
+                counts.false_positive += weight.negative;
+            } else {
+                counts.false_negative += weight.positive;
+                counts.true_negative += weight.negative;
+            }
+        }
+        batch = 0;
+    };
+    for (std::size_t r = 0; r < records.size(); ++r) {
+        if (test[r].positive + test[r].negative == 0) {
+            continue;
+        }
+        sequences[batch] = &records[r].symbols;
+        members[batch] = r;
+        if (++batch == kBatchSize) {
+            flush();
+        }
+    }
+    if (batch > 0) {
+        flush();
+    }
+    return counts;
+}
+
+}  // namespace
+
+SweepData SweepData::from_samples(const std::vector<LabeledSequence>& samples) {
+    SweepData data;
+    data.records = deduplicate(samples, data.record_of);
+    data.label_of.reserve(samples.size());
+    for (const auto& sample : samples) {
+        data.label_of.push_back(sample.label ? 1 : 0);
+    }
+    return data;
+}
+
+std::string SweepRun::name() const {
+    std::ostringstream out;
+    if (folds == 0) {
+        out << "ratio=" << train_ratio;
+    } else {
+        out << "fold=" << fold + 1 << "/" << folds;
+    }
+    out << " seed=" << seed;
+    return out.str();
+}
+
+std::string SweepRun::group() const {
+    std::ostringstream out;
+    if (folds == 0) {
+        out << "ratio=" << train_ratio;
+    } else {
+        out << folds << "-fold seed=" << seed;
+    }
+    return out.str();
+}
+
+std::vector<SweepRun> split_runs(const std::vector<double>& ratios,
+                                 const std::vector<unsigned int>& seeds) {
+    std::vector<SweepRun> runs;
+    for (const double ratio : ratios) {
+        if (ratio <= 0.0 || ratio >= 1.0) {
+            throw std::invalid_argument("train_ratio must be in (0, 1).");
+        }
+        for (const unsigned int seed : seeds) {
+            SweepRun run;
+            run.train_ratio = ratio;
+            run.seed = seed;
+            runs.push_back(run);
+        }
+    }
+    return runs;
+}
+
+std::vector<SweepRun> k_fold_runs(std::size_t folds, const std::vector<unsigned int>& seeds) {
+    if (folds < 2) {
+        throw std::invalid_argument("Cross-validation needs at least two folds.");
+    }
+    std::vector<SweepRun> runs;
+    for (const unsigned int seed : seeds) {
+        for (std::size_t fold = 0; fold < folds; ++fold) {
+            SweepRun run;
+            run.train_ratio = static_cast<double>(folds - 1) / static_cast<double>(folds);
+            run.seed = seed;
+            run.fold = fold;
+            run.folds = folds;
+            runs.push_back(run);
+        }
+    }
+    return runs;
+}
+
+std::vector<SweepResult> run_sweep(const SweepData& data,
+                                   const SymbolTable& symbols,
+                                   const std::vector<SweepRun>& runs,
+                                   ThreadPool& pool) {
+    const std::size_t n = data.sample_count();
+    if (n < 2) {
+        throw std::runtime_error("A sweep needs at least two samples.");
+    }
+    for (const auto& run : runs) {
+        if (run.folds > n) {
+            throw std::runtime_error("More folds than samples.");
+        }
+    }
+
+    // Every run of a seed shares one shuffled order (the folds of a seed
+    // must, so that they partition the samples).
+    std::vector<unsigned int> seeds;
+    for (const auto& run : runs) {
+        seeds.push_back(run.seed);
+    }
+    std::sort(seeds.begin(), seeds.end());
+    seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+    std::vector<std::vector<std::size_t>> orders(seeds.size());
+    pool.parallel_for(seeds.size(), [&](std::size_t i) { orders[i] = shuffled_order(n, seeds[i]); });
+
+    std::vector<SweepResult> results(runs.size());
+    pool.parallel_for(runs.size(), [&](std::size_t index) {
+        const auto start = std::chrono::steady_clock::now();
+        const SweepRun& run = runs[index];
+        const auto& order =
+            orders[static_cast<std::size_t>(std::lower_bound(seeds.begin(), seeds.end(), run.seed) - seeds.begin())];
+
+        // Test positions: the fold's slice, or everything past the
+        // training prefix for a split run.
+        std::size_t test_begin = train_split_size(n, run.train_ratio);
+        std::size_t test_end = n;
+        if (run.folds > 0) {
+            test_begin = n * run.fold / run.folds;
+            test_end = n * (run.fold + 1) / run.folds;
+        }
+
+        std::vector<LabelCounts> train(data.records.size());
+        std::vector<LabelCounts> test(data.records.size());
+        for (std::size_t position = 0; position < n; ++position) {
+            const std::size_t sample = order[position];
+            const bool tested = position >= test_begin && position < test_end;
+            auto& weight = (tested ? test : train)[data.record_of[sample]];
+            ++(data.label_of[sample] ? weight.positive : weight.negative);
+        }
+
+        // Records without training samples stay out of the PTA; the trie is
+        // then the one the run's training partition builds.
+        PTA pta;
+        for (std::size_t r = 0; r < data.records.size(); ++r) {
+            if (train[r].positive + train[r].negative > 0) {
+                pta.insert(data.records[r].symbols, train[r].positive, train[r].negative);
+            }
+        }
+        const DFA dfa = DFA::from_pta(pta, symbols);
+        const auto minimize_start = std::chrono::steady_clock::now();
+        const DFA minimized = dfa.minimize();
+        const auto minimize_end = std::chrono::steady_clock::now();
+
+        SweepResult& result = results[index];
+        result.run = run;
+        result.test_size = test_end - test_begin;
+        result.train_size = n - result.test_size;
+        result.metrics = metrics_from_counts(tally_records(minimized, data.records, test));
+        result.metrics.states_before = dfa.states().size();
+        result.metrics.states_after = minimized.states().size();
+        result.metrics.minimization_ms =
+            std::chrono::duration<double, std::milli>(minimize_end - minimize_start).count();
+        result.wall_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    });
+    return results;
+}
+
+}  // namespace automata_security
@@ -0,0 +1,377 @@
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "automata/dfa_model.hpp"
+#include "project_config.hpp"
+#include "stream_detector.hpp"
+
+namespace automata_security {
+namespace {
+
+struct CommandLineOptions {
+    std::string model_path;
+    // "-" reads stdin.
+    std::string input_path{"-"};
+    DetectorOptions detector;
+    // Keep reading as the file grows, like `tail -f`.
+    bool follow{false};
+    // Skip the records already in the file (the header is still read).
+    bool from_end{false};
+    std::size_t poll_ms{200};
+    bool stats{false};
+};
+
+std::atomic<bool> g_stop{false};
+
+void request_stop(int) {
+    g_stop = true;
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " --model=FILE [--input=conn.log] [--follow]\n";
+    std::cout << "Options:\n"
+              << "  --model=FILE        Binary DFA model (generator --export-model).\n"
+              << "  --input=FILE        Zeek conn.log or IoT-23 CSV to read; - for stdin (default).\n"
+              << "  --follow            Keep reading as the file grows; start over if it shrinks.\n"
+              << "  --from-end          With --follow, skip the records already in the file.\n"
+              << "  --poll-ms=N         Wait between reads at end of file (default 200).\n"
+              << "  --window=W          record (default): classify each record on its own;\n"
+              << "                      session: chain a key's records into windows, for models\n"
+              << "                      trained with --group-by=host|uid --window=tumbling.\n"
+              << "  --key=K             Session key: host (id.orig_h, default) or uid; must match\n"
+              << "                      the model's --group-by.\n"
+              << "  --unknown=U         Symbols outside the model: reject (default) leads to the\n"
+              << "                      sink, like the offline evaluation; ignore keeps the state.\n"
+              << "  --idle-timeout=SEC  Drop sessions idle for SEC seconds of log time (default 300).\n"
+              << "  --max-entries=N     Most sessions tracked at once (default 1048576).\n"
+              << "  --stats             Print record and alert counts to stderr at exit.\n"
+              << "  --version           Print version information.\n"
+              << "  --help              Show this message.\n";
+}
+
+bool parse_argument(const std::string& arg, CommandLineOptions& opts, const char* program) {
+    if (arg == "--help" || arg == "-h") {
+        print_usage(program);
+        std::exit(0);
+    }
+    if (arg == "--version") {
+        std::cout << "security-dfa-gen detector " << kVersion << std::endl;
+        std::exit(0);
+    }
+
+    auto parse_key_value = [](const std::string& option,
+                              const std::string& prefix) -> std::optional<std::string> {
+        if (option.rfind(prefix, 0) == 0) {
+            return option.substr(prefix.size());
+        }
+        return std::nullopt;
+    };
+
+    if (auto value = parse_key_value(arg, "--model=")) {
+        opts.model_path = *value;
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--input=")) {
+        opts.input_path = *value;
+        return true;
+    }
+    if (arg == "--follow") {
+        opts.follow = true;
+        return true;
+    }
+    if (arg == "--from-end") {
+        opts.from_end = true;
+        return true;
+    }
+    if (arg == "--stats") {
+        opts.stats = true;
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--poll-ms=")) {
+        opts.poll_ms = static_cast<std::size_t>(std::stoull(*value));
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--window=")) {
+        if (*value == "record") {
+            opts.detector.window = DetectorWindow::kRecord;
+        } else if (*value == "session") {
+            opts.detector.window = DetectorWindow::kSession;
+        } else {
+            std::cerr << "Unknown window: " << *value << " (expected record or session)\n";
+            return false;
+        }
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--key=")) {
+        if (*value == "host") {
+            opts.detector.key = DetectorKey::kHost;
+        } else if (*value == "uid") {
+            opts.detector.key = DetectorKey::kUid;
+        } else {
+            std::cerr << "Unknown key: " << *value << " (expected host or uid)\n";
+            return false;
+        }
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--unknown=")) {
+        if (*value == "reject") {
+            opts.detector.unknown = DetectorUnknown::kReject;
+        } else if (*value == "ignore") {
+            opts.detector.unknown = DetectorUnknown::kIgnore;
+        } else {
+            std::cerr << "Unknown --unknown value: " << *value << " (expected reject or ignore)\n";
+            return false;
+        }
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--idle-timeout=")) {
+        opts.detector.idle_timeout = std::stod(*value);
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--max-entries=")) {
+        opts.detector.max_entries = static_cast<std::size_t>(std::stoull(*value));
+        if (opts.detector.max_entries == 0) {
+            std::cerr << "--max-entries must be positive.\n";
+            return false;
+        }
+        return true;
+    }
+
+    std::cerr << "Unknown argument: " << arg << "\n";
+    print_usage(program);
+    return false;
+}
+
+// Whatever `file` has ready, up to `size` bytes, in one read(2): a pipe or
+// terminal returns what has been written so far instead of waiting for the
+// whole block to fill, as fread would. 0 at end of file or on error.
+std::size_t read_available(std::FILE* file, char* data, std::size_t size) {
+#ifdef _WIN32
+    const int read = ::_read(::_fileno(file), data, static_cast<unsigned int>(size));
+#else
+    ssize_t read = 0;
+    do {
+        read = ::read(::fileno(file), data, size);
+    } while (read < 0 && errno == EINTR && !g_stop);
+#endif
+    return read > 0 ? static_cast<std::size_t>(read) : 0;
+}
+
+bool regular_file(std::FILE* file) {
+#ifdef _WIN32
+    struct _stat info {};
+    return ::_fstat(::_fileno(file), &info) == 0 && (info.st_mode & _S_IFREG) != 0;
+#else
+    struct stat info {};
+    return ::fstat(::fileno(file), &info) == 0 && S_ISREG(info.st_mode);
+#endif
+}
+
+// Moves the descriptor under `file` to `offset`, for read_available() after
+// stdio calls that read ahead.
+void seek_descriptor(std::FILE* file, std::uint64_t offset) {
+#ifdef _WIN32
+    ::_lseeki64(::_fileno(file), static_cast<long long>(offset), SEEK_SET);
+#else
+    ::lseek(::fileno(file), static_cast<off_t>(offset), SEEK_SET);
+#endif
+}
+
+// Reads a growing log in blocks and hands complete lines to the detector.
+// A partial last line is kept until its newline arrives (or, without
+// --follow, until end of file). Alerts are flushed after every block read
+// from a pipe or terminal, so a live feed is not held back until a buffer
+// fills; a regular file is flushed when its end is reached.
+class LogTail {
+public:
+    LogTail(const CommandLineOptions& options, StreamDetector& detector)
+        : options_(options), detector_(detector), buffer_(1 << 20) {}
+
+    void run() {
+        open();
+        if (options_.follow && options_.from_end && file_ != stdin) {
+            skip_existing_records();
+        }
+        while (!g_stop) {
+            const std::size_t read = read_available(file_, buffer_.data(), buffer_.size());
+            if (read > 0) {
+                offset_ += read;
+                consume(std::string_view(buffer_.data(), read));
+                if (!regular_) {
+                    detector_.flush();
+                }
+                continue;
+            }
+            if (!options_.follow || file_ == stdin) {
+                break;
+            }
+            // At end of file: publish what we have, then wait for more.
+            detector_.flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(options_.poll_ms));
+            if (truncated()) {
+                // Rotated or truncated in place: the new content starts over,
+                // header included.
+                partial_.clear();
+                detector_.reset_header();
+                reopen();
+            }
+        }
+        if (!partial_.empty()) {
+            detector_.process_line(partial_);
+            partial_.clear();
+        }
+        close();
+    }
+
+private:
+    const CommandLineOptions& options_;
+    StreamDetector& detector_;
+    std::vector<char> buffer_;
+    std::string partial_;
+    std::FILE* file_{nullptr};
+    std::uint64_t offset_{0};
+    bool regular_{false};
+
+    void open() {
+        if (options_.input_path == "-") {
+            file_ = stdin;
+        } else {
+            file_ = std::fopen(options_.input_path.c_str(), "rb");
+            if (file_ == nullptr) {
+                throw std::runtime_error("Failed to open input: " + options_.input_path);
+            }
+            offset_ = 0;
+        }
+        regular_ = regular_file(file_);
+    }
+
+    void close() {
+        if (file_ != nullptr && file_ != stdin) {
+            std::fclose(file_);
+        }
+        file_ = nullptr;
+    }
+
+    void reopen() {
+        close();
+        open();
+    }
+
+    bool truncated() const {
+        std::error_code error;
+        const auto size = std::filesystem::file_size(options_.input_path, error);
+        return !error && size < offset_;
+    }
+
+    void consume(std::string_view block) {
+        std::size_t begin = 0;
+        for (std::size_t newline = block.find('\n'); newline != std::string_view::npos;
+             newline = block.find('\n', begin)) {
+            std::string_view line = block.substr(begin, newline - begin);
+            if (!partial_.empty()) {
+                partial_.append(line.data(), line.size());
+                detector_.process_line(partial_);
+                partial_.clear();
+            } else {
+                detector_.process_line(line);
+            }
+            begin = newline + 1;
+        }
+        partial_.append(block.data() + begin, block.size() - begin);
+    }
+
+    // Read lines only until the header is known, then jump to the end.
+    void skip_existing_records() {
+        std::string line;
+        int c = 0;
+        while (!detector_.has_header() && (c = std::fgetc(file_)) != EOF) {
+            if (c != '\n') {
+                line += static_cast<char>(c);
+                continue;
+            }
+            detector_.process_line(line);
+            line.clear();
+        }
+        std::fseek(file_, 0, SEEK_END);
+        offset_ = static_cast<std::uint64_t>(std::ftell(file_));
+        seek_descriptor(file_, offset_);
+    }
+};
+
+}  // namespace
+}  // namespace automata_security
+
+// -----------------------------------------------------------------------------
+// detector: classify a Zeek conn.log as it is written.
+//
+// Loads a binary model, reads the log line by line (tailing it with --follow)
+// and writes one JSON line per alert to stdout. See StreamDetector for how
+// records map to DFA input.
+// -----------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+    using namespace automata_security;
+
+    CommandLineOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (!parse_argument(argv[i], options, argv[0])) {
+            return 1;
+        }
+    }
+    if (options.model_path.empty()) {
+        std::cerr << "--model=FILE is required." << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, request_stop);
+    std::signal(SIGTERM, request_stop);
+
+    try {
+        const DfaModel model(options.model_path);
+        std::ios::sync_with_stdio(false);
+        StreamDetector detector(model, options.detector, std::cout);
+
+        const auto start = std::chrono::steady_clock::now();
+        LogTail(options, detector).run();
+        detector.flush();
+
+        if (options.stats) {
+            const double seconds =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            const auto& stats = detector.stats();
+            std::cerr << std::fixed << std::setprecision(0);
+            std::cerr << "records: " << stats.records << ", alerts: " << stats.alerts
+                      << ", malformed: " << stats.malformed << "\n";
+            std::cerr << "sessions: " << detector.table().size() << " tracked, "
+                      << stats.evicted_idle << " evicted idle, " << detector.table().displaced()
+                      << " displaced (" << detector.table().memory_bytes() / 1024 << " KiB)\n";
+            std::cerr << "throughput: " << (seconds > 0.0 ? stats.records / seconds : 0.0)
+                      << " records/s\n";
+        }
+    } catch (const std::exception& ex) {
+        std::cerr << "Error: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include "state_table.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace automata_security {
+
+namespace {
+
+// Longest run of occupied slots searched for an entry to displace.
+constexpr std::size_t kDisplaceScan = 64;
+
+}  // namespace
+
+StateTable::StateTable(std::size_t max_entries) : max_entries_(max_entries) {
+    if (max_entries == 0) {
+        throw std::invalid_argument("StateTable needs room for at least one entry.");
+    }
+    std::size_t capacity = 2;
+    while (capacity < 2 * max_entries) {
+        capacity *= 2;
+    }
+    slots_.assign(capacity, Entry{0, 0.0F, 0, 0});
+    mask_ = capacity - 1;
+}
+
+std::size_t StateTable::home(std::uint64_t key) const {
+    // Keys are already hashes; one multiply spreads their low bits.
+    return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask_;
+}
+
+float StateTable::relative(double ts) {
+    if (!has_base_) {
+        base_time_ = ts;
+        has_base_ = true;
+    }
+    return static_cast<float>(ts - base_time_);
+}
+
+StateTable::Entry& StateTable::find_or_insert(std::uint64_t key,
+                                              std::uint32_t initial_state,
+                                              double ts) {
+    key = key == 0 ? 1 : key;
+    const float seen = relative(ts);
+    std::size_t slot = home(key);
+    while (slots_[slot].key != 0) {
+        if (slots_[slot].key == key) {
+            slots_[slot].last_seen = seen;
+            return slots_[slot];
+        }
+        slot = (slot + 1) & mask_;
+    }
+
+    if (size_ == max_entries_) {
+        // Make room with the stalest entry near the new key's slot, then
+        // look for the free slot again: the erase may have shifted entries.
+        std::size_t victim = slots_.size();
+        std::size_t probe = home(key);
+        for (std::size_t scanned = 0; scanned < kDisplaceScan || victim == slots_.size();
+             probe = (probe + 1) & mask_) {
+            if (slots_[probe].key == 0) {
+                continue;
+            }
+            if (victim == slots_.size() || slots_[probe].last_seen < slots_[victim].last_seen) {
+                victim = probe;
+            }
+            ++scanned;
+        }
+        erase_at(victim);
+        ++displaced_;
+        slot = home(key);
+        while (slots_[slot].key != 0) {
+            slot = (slot + 1) & mask_;
+        }
+    }
+
+    slots_[slot] = Entry{key, seen, initial_state, 0};
+    ++size_;
+    return slots_[slot];
+}
+
+void StateTable::erase(Entry& entry) {
+    erase_at(static_cast<std::size_t>(&entry - slots_.data()));
+}
+
+void StateTable::erase_at(std::size_t slot) {
+    // Backward-shift deletion: pull later entries of the same probe run into
+    // the hole when their home slot allows it, so lookups never need
+    // tombstones.
+    std::size_t hole = slot;
+    for (std::size_t next = (hole + 1) & mask_; slots_[next].key != 0; next = (next + 1) & mask_) {
+        const std::size_t want = home(slots_[next].key);
+        // `next` may move into `hole` unless its home lies in (hole, next].
+        const bool stays = hole <= next ? (hole < want && want <= next)
+                                        : (hole < want || want <= next);
+        if (!stays) {
+            slots_[hole] = slots_[next];
+            hole = next;
+        }
+    }
+    slots_[hole].key = 0;
+    --size_;
+}
+
+std::size_t StateTable::evict_idle(double cutoff) {
+    if (!has_base_ || size_ == 0) {
+        return 0;
+    }
+    const float limit = static_cast<float>(cutoff - base_time_);
+    std::size_t evicted = 0;
+    for (std::size_t slot = 0; slot < slots_.size();) {
+        if (slots_[slot].key != 0 && slots_[slot].last_seen < limit) {
+            // Stay on this slot: the erase may have shifted a later entry
+            // into it. (One shifted across the end of the array into a slot
+            // already passed waits for the next sweep.)
+            erase_at(slot);
+            ++evicted;
+        } else {
+            ++slot;
+        }
+    }
+    return evicted;
+}
+
+}  // namespace automata_security
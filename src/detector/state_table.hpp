@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace automata_security {
+
+// Current DFA state per tracked key (host, uid, ...), in one flat
+// open-addressing array.
+//
+// Keys are 64-bit hashes of the key string; the string itself is not kept,
+// so an entry is 24 bytes however long the key. Slots are probed linearly
+// and removed with backward shifting, so there are no tombstones and the
+// table never needs rehashing. The array holds at least twice `max_entries`
+// slots. When it is full, the least recently seen of the entries probed
+// from the new key's slot makes room.
+class StateTable {
+public:
+    struct Entry {
+        std::uint64_t key;  // 0 marks an empty slot
+        float last_seen;    // ts of the last record, relative to the first record seen
+        std::uint32_t state;
+        std::uint32_t rows;  // records chained into `state` since the key (re)started
+    };
+
+    explicit StateTable(std::size_t max_entries);
+
+    // Entry for `key`, inserted in `initial_state` with no rows when
+    // missing, marked as seen at `ts`. The reference is valid until the next insert or erase.
+    Entry& find_or_insert(std::uint64_t key, std::uint32_t initial_state, double ts);
+    void erase(Entry& entry);
+
+    // Remove every entry last seen before `cutoff`; returns how many.
+    std::size_t evict_idle(double cutoff);
+
+    std::size_t size() const { return size_; }
+    std::size_t max_entries() const { return max_entries_; }
+    // Entries removed to make room for new keys.
+    std::size_t displaced() const { return displaced_; }
+    // Bytes held by the slot array.
+    std::size_t memory_bytes() const { return slots_.size() * sizeof(Entry); }
+
+private:
+    std::vector<Entry> slots_;
+    std::size_t mask_;
+    std::size_t size_{0};
+    std::size_t max_entries_;
+    std::size_t displaced_{0};
+    // Timestamps are stored relative to the first record's, so a float keeps
+    // sub-second precision for days of log time.
+    double base_time_{0.0};
+    bool has_base_{false};
+
+    std::size_t home(std::uint64_t key) const;
+    float relative(double ts);
+    void erase_at(std::size_t slot);
+};
+
+}  // namespace automata_security
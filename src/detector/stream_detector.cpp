@@ -0,0 +1,284 @@
+#include "stream_detector.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "utils/json_escape.hpp"
+#include "utils/line_tokenizer.hpp"
+
+namespace automata_security {
+
+namespace {
+
+constexpr std::size_t kMissingColumn = std::numeric_limits<std::size_t>::max();
+// Alerts are written out once this much output is buffered (and on flush()).
+constexpr std::size_t kAlertBufferBytes = 64 * 1024;
+
+std::uint64_t fnv1a(std::uint64_t hash, std::string_view bytes) {
+    for (const char c : bytes) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+bool starts_with(std::string_view text, std::string_view prefix) {
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+// Value of a Zeek `#separator` line: a literal character or a \xNN escape.
+char parse_separator(std::string_view value) {
+    if (value.size() == 4 && value[0] == '\\' && value[1] == 'x') {
+        unsigned int code = 0;
+        std::from_chars(value.data() + 2, value.data() + 4, code, 16);
+        return static_cast<char>(code);
+    }
+    return value.empty() ? '\t' : value[0];
+}
+
+// A record only gives its own proto=/state=/service= symbols. A per-row
+// model classifies it on its own; a model trained on tumbling windows of one
+// host's (or connection's) rows is fed the same windows by a session keyed
+// the same way. Sliding windows and bucketed features cannot be rebuilt.
+const DfaModel& detector_model(const DfaModel& model, const DetectorOptions& options) {
+    const SequenceOptions& sequences = model.sequences();
+    const std::string trained = "Model was trained with " + sequence_flags(sequences);
+    if (sequences.duration_symbols || sequences.byte_symbols) {
+        throw std::runtime_error(trained + "; the detector only builds proto=/state=/service= symbols.");
+    }
+    if (!sequences.grouped()) {
+        if (options.window == DetectorWindow::kSession) {
+            throw std::runtime_error(
+                "--window=session needs a model trained with --group-by=host|uid --window=tumbling; "
+                "this one classifies single records.");
+        }
+        return model;
+    }
+    if (sequences.window != SequenceOptions::Window::kTumbling) {
+        throw std::runtime_error(trained + "; the detector only follows tumbling windows.");
+    }
+    const bool by_host = sequences.group_by == SequenceOptions::GroupBy::kHost;
+    if (options.window != DetectorWindow::kSession ||
+        options.key != (by_host ? DetectorKey::kHost : DetectorKey::kUid)) {
+        throw std::runtime_error(trained + "; run the detector with --window=session --key=" +
+                                 (by_host ? "host." : "uid."));
+    }
+    return model;
+}
+
+}  // namespace
+
+StreamDetector::StreamDetector(const DfaModel& model,
+                               const DetectorOptions& options,
+                               std::ostream& alerts)
+    : model_(detector_model(model, options)),
+      options_(options),
+      alerts_(alerts),
+      // Per-record classification keeps no state between records.
+      table_(options.window == DetectorWindow::kSession ? options.max_entries : 1),
+      window_rows_(model.sequences().window_rows),
+      unknown_column_(model.column("symbol=unknown")),
+      dead_state_(model.sink_state() < model.state_count() ? model.sink_state() : kDfaModelNoSink) {}
+
+StreamDetector::~StreamDetector() {
+    flush();
+}
+
+void StreamDetector::flush() {
+    if (!out_.empty()) {
+        alerts_.write(out_.data(), static_cast<std::streamsize>(out_.size()));
+        out_.clear();
+    }
+    alerts_.flush();
+}
+
+void StreamDetector::process_line(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    if (line.empty()) {
+        return;
+    }
+    if (line[0] == '#') {
+        // `#separator` opens a log (also one appended to another); it only
+        // applies to the `#fields` line, since IoT-23 CSVs keep Zeek's line
+        // but use '|'.
+        if (starts_with(line, "#separator ")) {
+            separator_ = parse_separator(line.substr(11));
+            has_header_ = false;
+        } else if (starts_with(line, "#fields") && line.size() > 8) {
+            read_header(line.substr(8), separator_);
+        }
+        return;
+    }
+    if (!has_header_) {
+        // IoT-23 labeled CSVs put a plain header line first.
+        const char delimiter = line.find('|') != std::string_view::npos    ? '|'
+                               : line.find('\t') != std::string_view::npos ? '\t'
+                                                                           : ',';
+        read_header(line, delimiter);
+        return;
+    }
+
+    split_fields(line, delimiter_, fields_, scratch_);
+    if (fields_.size() < required_fields_) {
+        ++stats_.malformed;
+        return;
+    }
+    process_record();
+}
+
+void StreamDetector::read_header(std::string_view fields_line, char delimiter) {
+    delimiter_ = delimiter;
+    split_fields(fields_line, delimiter, fields_, scratch_);
+    auto column = [&](std::string_view name) {
+        const auto it = std::find(fields_.begin(), fields_.end(), name);
+        return it != fields_.end() ? static_cast<std::size_t>(it - fields_.begin())
+                                   : kMissingColumn;
+    };
+    columns_.ts = column("ts");
+    columns_.uid = column("uid");
+    columns_.orig_h = column("id.orig_h");
+    columns_.resp_h = column("id.resp_h");
+    columns_.proto = column("proto");
+    columns_.conn_state = column("conn_state");
+    columns_.service = column("service");
+    required_fields_ = 0;
+    for (const auto index : {columns_.ts, columns_.uid, columns_.orig_h, columns_.resp_h,
+                             columns_.proto, columns_.conn_state, columns_.service}) {
+        if (index != kMissingColumn) {
+            required_fields_ = std::max(required_fields_, index + 1);
+        }
+    }
+    has_header_ = true;
+}
+
+std::string_view StreamDetector::field(std::size_t column) const {
+    return column < fields_.size() ? fields_[column] : std::string_view{};
+}
+
+std::uint32_t StreamDetector::step(std::uint32_t state,
+                                   const char* prefix,
+                                   std::string_view value,
+                                   bool& any) {
+    // Same tokens as the parser: empty and "-" values contribute no symbol.
+    if (value.empty() || value == "-") {
+        return state;
+    }
+    any = true;
+    symbol_key_.assign(prefix);
+    symbol_key_.append(value.data(), value.size());
+    return advance(state, model_.column(symbol_key_));
+}
+
+std::uint32_t StreamDetector::advance(std::uint32_t state, std::uint32_t column) const {
+    if (options_.unknown == DetectorUnknown::kReject &&
+        (column >= model_.symbol_count() || state >= model_.state_count())) {
+        return dead_state_;
+    }
+    return model_.step(state, column);
+}
+
+void StreamDetector::process_record() {
+    const std::string_view ts_field = field(columns_.ts);
+    double ts = 0.0;
+    const auto parsed = std::from_chars(ts_field.data(), ts_field.data() + ts_field.size(), ts);
+    const bool ts_valid = parsed.ec == std::errc() &&
+                          parsed.ptr == ts_field.data() + ts_field.size() && std::isfinite(ts);
+    if (!ts_valid) {
+        ts = 0.0;
+    }
+    ++stats_.records;
+
+    StateTable::Entry* entry = nullptr;
+    std::uint32_t state = model_.start_state();
+    if (options_.window == DetectorWindow::kSession) {
+        sweep(ts);
+        std::uint64_t key = 0xcbf29ce484222325ULL;
+        switch (options_.key) {
+            case DetectorKey::kHost:
+                key = fnv1a(key, field(columns_.orig_h));
+                break;
+            case DetectorKey::kUid:
+                key = fnv1a(key, field(columns_.uid));
+                break;
+        }
+        entry = &table_.find_or_insert(key, state, ts);
+        state = entry->state;
+    }
+
+    bool any = false;
+    state = step(state, "proto=", field(columns_.proto), any);
+    state = step(state, "state=", field(columns_.conn_state), any);
+    state = step(state, "service=", field(columns_.service), any);
+    if (!any) {
+        state = advance(state, unknown_column_);
+    }
+
+    if (state < model_.state_count() && model_.accepting(state)) {
+        alert(ts, state);
+        if (entry != nullptr) {
+            table_.erase(*entry);
+        }
+    } else if (entry != nullptr) {
+        // A full window starts the key over, as the generator cuts the next
+        // tumbling window there.
+        if (state == dead_state_ || ++entry->rows >= window_rows_) {
+            table_.erase(*entry);
+        } else {
+            entry->state = state;
+        }
+    }
+}
+
+void StreamDetector::alert(double ts, std::uint32_t state) {
+    ++stats_.alerts;
+    // The shortest digits that read back as `ts`; always a JSON number, as
+    // process_record() only keeps finite values.
+    char ts_text[32];
+    const auto written = std::to_chars(ts_text, ts_text + sizeof(ts_text), ts);
+    out_ += "{\"ts\":";
+    out_.append(ts_text, written.ptr);
+    out_ += ",\"uid\":";
+    append_json_string(out_, field(columns_.uid));
+    out_ += ",\"orig_h\":";
+    append_json_string(out_, field(columns_.orig_h));
+    out_ += ",\"resp_h\":";
+    append_json_string(out_, field(columns_.resp_h));
+    out_ += ",\"proto\":";
+    append_json_string(out_, field(columns_.proto));
+    out_ += ",\"conn_state\":";
+    append_json_string(out_, field(columns_.conn_state));
+    out_ += ",\"service\":";
+    append_json_string(out_, field(columns_.service));
+    out_ += ",\"state\":\"s";
+    out_ += std::to_string(state);
+    out_ += "\",\"positive\":";
+    out_ += std::to_string(model_.positive_count(state));
+    out_ += ",\"negative\":";
+    out_ += std::to_string(model_.negative_count(state));
+    out_ += "}\n";
+    if (out_.size() >= kAlertBufferBytes) {
+        flush();
+    }
+}
+
+void StreamDetector::sweep(double ts) {
+    if (options_.idle_timeout <= 0.0) {
+        return;
+    }
+    // A sweep walks the whole table, so it runs a few times per timeout of
+    // log time rather than per record.
+    const double interval = options_.idle_timeout / 4;
+    if (!swept_) {
+        next_sweep_ = ts + interval;
+        swept_ = true;
+    } else if (ts >= next_sweep_) {
+        stats_.evicted_idle += table_.evict_idle(ts - options_.idle_timeout);
+        next_sweep_ = ts + interval;
+    }
+}
+
+}  // namespace automata_security
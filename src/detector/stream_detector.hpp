@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "automata/dfa_model.hpp"
+#include "state_table.hpp"
+
+namespace automata_security {
+
+// What a tracked DFA state belongs to; the model's --group-by.
+enum class DetectorKey {
+    kHost,  // id.orig_h
+    kUid,   // uid (one Zeek connection)
+};
+
+// How far a key's records are chained into one input sequence.
+enum class DetectorWindow {
+    // Every record is classified on its own, like the offline evaluation.
+    kRecord,
+    // A key's records are concatenated, like the generator's --group-by
+    // windows, until an alert, the sink, a full window or idle eviction
+    // restarts it from the start state.
+    kSession,
+};
+
+// Where a symbol outside the model's alphabet leads.
+enum class DetectorUnknown {
+    // To the sink (or a rejecting dead end without one), like DFA::classify
+    // and CompiledDFA in the offline evaluation.
+    kReject,
+    // Nowhere: the state is kept, like DfaModel::step and the api's --model.
+    kIgnore,
+};
+
+struct DetectorOptions {
+    DetectorKey key{DetectorKey::kHost};
+    DetectorWindow window{DetectorWindow::kRecord};
+    DetectorUnknown unknown{DetectorUnknown::kReject};
+    // Seconds of log time (ts) after which an idle key is dropped.
+    double idle_timeout{300.0};
+    std::size_t max_entries{std::size_t{1} << 20};
+};
+
+struct DetectorStats {
+    std::size_t records{0};
+    std::size_t alerts{0};
+    // Lines with fewer fields than the columns used, e.g. a partial write.
+    std::size_t malformed{0};
+    std::size_t evicted_idle{0};
+};
+
+// Classifies a Zeek conn.log (or IoT-23 labeled CSV) line by line with a
+// binary DFA model.
+//
+// Each record becomes the same symbols the parser extracts (proto=, state=,
+// service=) and advances its key's state with DfaModel::step; symbols the
+// model has never seen are handled as `options.unknown` says. When the state
+// is accepting, one JSON alert line is written to `alerts` and the key
+// starts over. Keys whose state reaches the sink are dropped, since no
+// continuation can be accepted.
+//
+// The header is taken from a Zeek `#fields` line (with `#separator`) or,
+// for the IoT-23 CSV, from the first line that is not a `#` comment.
+//
+// A per-row model is used with kRecord. A model trained with --group-by=host
+// (or uid) --window=tumbling is used with kSession and the matching key, and
+// a key restarts after the model's --window-rows records. The constructor
+// throws std::runtime_error for any other combination, and for models
+// trained with sliding windows or --features.
+class StreamDetector {
+public:
+    // `model` must outlive the detector.
+    StreamDetector(const DfaModel& model, const DetectorOptions& options, std::ostream& alerts);
+    ~StreamDetector();
+
+    StreamDetector(const StreamDetector&) = delete;
+    StreamDetector& operator=(const StreamDetector&) = delete;
+
+    // Feed one line without its newline.
+    void process_line(std::string_view line);
+
+    // Write out buffered alerts.
+    void flush();
+
+    // Forget the header, e.g. when the log was rotated and starts over.
+    void reset_header() { has_header_ = false; }
+
+    bool has_header() const { return has_header_; }
+    const DetectorStats& stats() const { return stats_; }
+    const StateTable& table() const { return table_; }
+
+private:
+    struct Columns {
+        std::size_t ts;
+        std::size_t uid;
+        std::size_t orig_h;
+        std::size_t resp_h;
+        std::size_t proto;
+        std::size_t conn_state;
+        std::size_t service;
+    };
+
+    const DfaModel& model_;
+    DetectorOptions options_;
+    std::ostream& alerts_;
+    std::string out_;
+    StateTable table_;
+    DetectorStats stats_;
+
+    bool has_header_{false};
+    char delimiter_{'\t'};
+    char separator_{'\t'};  // from `#separator`
+    Columns columns_{};
+    std::size_t required_fields_{0};
+    std::vector<std::string_view> fields_;
+    std::string scratch_;
+    std::string symbol_key_;
+    // Records per session; the model's tumbling window length.
+    std::size_t window_rows_;
+    std::uint32_t unknown_column_;
+    // Where kReject sends unknown symbols: the sink, or kDfaModelNoSink
+    // (past every state) when the model has none.
+    std::uint32_t dead_state_;
+    double next_sweep_{0.0};
+    bool swept_{false};
+
+    void read_header(std::string_view fields_line, char delimiter);
+    void process_record();
+    std::string_view field(std::size_t column) const;
+    std::uint32_t step(std::uint32_t state, const char* prefix, std::string_view value, bool& any);
+    std::uint32_t advance(std::uint32_t state, std::uint32_t column) const;
+    void alert(double ts, std::uint32_t state);
+    void sweep(double ts);
+};
+
+}  // namespace automata_security
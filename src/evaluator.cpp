@@ -1,53 +1,187 @@
 #include "evaluator.hpp"
 
+#include <algorithm>
+#include <cstdint>
+
 namespace automata_security {
 
-Metrics evaluate(const DFA& dfa,
-                 const std::vector<LabeledSequence>& test_sequences) {
-    Metrics metrics;
-    if (test_sequences.empty()) {
-        return metrics;
-    }
+ConfusionCounts& ConfusionCounts::operator+=(const ConfusionCounts& other) {
+    true_positive += other.true_positive;
+    true_negative += other.true_negative;
+    false_positive += other.false_positive;
+    false_negative += other.false_negative;
+    return *this;
+}
+
+namespace {
+
+// Below this many sequences per worker the task overhead outweighs the
+// classification work, so the parallel overloads use fewer chunks.
+constexpr std::size_t kMinSequencesPerChunk = 4096;
 
-    std::size_t true_positive = 0;
-    std::size_t true_negative = 0;
-    std::size_t false_positive = 0;
-    std::size_t false_negative = 0;
+// Counters for one chunk, padded to a cache line so workers writing
+// neighbouring slots do not false-share.
+struct alignas(64) ChunkCounts {
+    ConfusionCounts counts;
+};
+
+// Sequences classified per DFA::classify_batch() call: one verdict word.
+constexpr std::size_t kBatchSize = 64;
+
+// Classify [begin, end) in batches of kBatchSize and hand each sample with
+// its verdict to `count`.
+template <typename Sample, typename Count>
+void classify_batches(const DFA& dfa, const Sample* begin, const Sample* end, const Count& count) {
+    const std::vector<SymbolId>* sequences[kBatchSize];
+    while (begin != end) {
+        const std::size_t batch = std::min<std::size_t>(kBatchSize, static_cast<std::size_t>(end - begin));
+        for (std::size_t i = 0; i < batch; ++i) {
+            sequences[i] = &begin[i].symbols;
+        }
+        std::uint64_t verdicts = 0;
+        dfa.classify_batch(sequences, batch, &verdicts);
+        for (std::size_t i = 0; i < batch; ++i) {
+            count(begin[i], ((verdicts >> i) & 1U) != 0);
+        }
+        begin += batch;
+    }
+}
 
-    for (const auto& sample : test_sequences) {
-        // Classify each test sequence with the DFA and update confusion counts
-        // used to compute accuracy, false positive rate and false negative rate.
-        bool predicted = dfa.classify(sample.symbols);
+void tally(const DFA& dfa,
+           const LabeledSequence* begin,
+           const LabeledSequence* end,
+           ConfusionCounts& counts) {
+    // Classify each test sequence with the DFA and update confusion counts
+    // used to compute accuracy, false positive rate and false negative rate.
+    classify_batches(dfa, begin, end, [&](const LabeledSequence& sample, bool predicted) {
         bool actual = sample.label;
 
         if (predicted && actual) {
-            ++true_positive;
+            ++counts.true_positive;
         } else if (!predicted && !actual) {
-            ++true_negative;
+            ++counts.true_negative;
         } else if (predicted && !actual) {
-            ++false_positive;
+            ++counts.false_positive;
+        } else {
+            ++counts.false_negative;
+        }
+    });
+}
+
+void tally(const DFA& dfa,
+           const WeightedSequence* begin,
+           const WeightedSequence* end,
+           ConfusionCounts& counts) {
+    classify_batches(dfa, begin, end, [&](const WeightedSequence& record, bool predicted) {
+        if (predicted) {
+            counts.true_positive += record.positive_count;
+            counts.false_positive += record.negative_count;
         } else {
-            ++false_negative;
+            counts.false_negative += record.positive_count;
+            counts.true_negative += record.negative_count;
         }
+    });
+}
+
+template <typename Sample>
+void accumulate_on(const DFA& dfa,
+                   const std::vector<Sample>& samples,
+                   ConfusionCounts& counts,
+                   ThreadPool& pool) {
+    const std::size_t size = samples.size();
+    // A few chunks per worker keeps the load balanced when sequence lengths
+    // vary across the input.
+    const std::size_t chunk_count =
+        std::clamp<std::size_t>(size / kMinSequencesPerChunk, 1, pool.size() * 4);
+    if (chunk_count == 1) {
+        tally(dfa, samples.data(), samples.data() + size, counts);
+        return;
+    }
+
+    std::vector<ChunkCounts> partial(chunk_count);
+    const Sample* const data = samples.data();
+    pool.parallel_for(chunk_count, [&](std::size_t chunk) {
+        const std::size_t begin = size * chunk / chunk_count;
+        const std::size_t end = size * (chunk + 1) / chunk_count;
+        tally(dfa, data + begin, data + end, partial[chunk].counts);
+    });
+    for (const auto& chunk : partial) {
+        counts += chunk.counts;
+    }
+}
+
+}  // namespace
+
+void accumulate(const DFA& dfa,
+                const std::vector<LabeledSequence>& test_sequences,
+                ConfusionCounts& counts) {
+    tally(dfa, test_sequences.data(), test_sequences.data() + test_sequences.size(), counts);
+}
+
+void accumulate(const DFA& dfa,
+                const std::vector<LabeledSequence>& test_sequences,
+                ConfusionCounts& counts,
+                ThreadPool& pool) {
+    accumulate_on(dfa, test_sequences, counts, pool);
+}
+
+void accumulate(const DFA& dfa,
+                const std::vector<WeightedSequence>& test_records,
+                ConfusionCounts& counts) {
+    tally(dfa, test_records.data(), test_records.data() + test_records.size(), counts);
+}
+
+void accumulate(const DFA& dfa,
+                const std::vector<WeightedSequence>& test_records,
+                ConfusionCounts& counts,
+                ThreadPool& pool) {
+    accumulate_on(dfa, test_records, counts, pool);
+}
+
+Metrics metrics_from_counts(const ConfusionCounts& counts) {
+    Metrics metrics;
+    if (counts.total() == 0) {
+        return metrics;
     }
 
     // Compute aggregate metrics. Accuracy is straightforward: fraction of
     // correctly predicted samples. False positive/negative rates are defined
     // relative to their respective conditionals to avoid division by zero.
-    const double total = static_cast<double>(test_sequences.size());
-    metrics.accuracy = (true_positive + true_negative) / total;
+    const double total = static_cast<double>(counts.total());
+    metrics.accuracy = (counts.true_positive + counts.true_negative) / total;
 
-    const double fp_denom = static_cast<double>(false_positive + true_negative);
-    const double fn_denom = static_cast<double>(false_negative + true_positive);
+    const double fp_denom = static_cast<double>(counts.false_positive + counts.true_negative);
+    const double fn_denom = static_cast<double>(counts.false_negative + counts.true_positive);
     // If denominators are zero (no negatives/positives in the test set), we
     // return 0.0 to indicate the rate is undefined in that slice rather than
     // producing NaN or inf.
-    metrics.false_positive_rate = fp_denom > 0.0 ? false_positive / fp_denom : 0.0;
-    metrics.false_negative_rate = fn_denom > 0.0 ? false_negative / fn_denom : 0.0;
+    metrics.false_positive_rate = fp_denom > 0.0 ? counts.false_positive / fp_denom : 0.0;
+    metrics.false_negative_rate = fn_denom > 0.0 ? counts.false_negative / fn_denom : 0.0;
 
     return metrics;
 }
 
-}  // namespace automata_security
+Metrics evaluate(const DFA& dfa,
+                 const std::vector<LabeledSequence>& test_sequences) {
+    ConfusionCounts counts;
+    accumulate(dfa, test_sequences, counts);
+    return metrics_from_counts(counts);
+}
 
+Metrics evaluate(const DFA& dfa,
+                 const std::vector<LabeledSequence>& test_sequences,
+                 ThreadPool& pool) {
+    ConfusionCounts counts;
+    accumulate(dfa, test_sequences, counts, pool);
+    return metrics_from_counts(counts);
+}
 
+Metrics evaluate(const DFA& dfa,
+                 const std::vector<WeightedSequence>& test_records,
+                 ThreadPool& pool) {
+    ConfusionCounts counts;
+    accumulate(dfa, test_records, counts, pool);
+    return metrics_from_counts(counts);
+}
+
+}  // namespace automata_security
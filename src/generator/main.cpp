@@ -1,33 +1,127 @@
 #include <algorithm>
-#include <chrono>
+#include <cmath>
 #include <cstdlib>
 #include <fstream>
+#include <future>
 #include <iomanip>
 #include <iostream>
+#include <new>
 #include <optional>
+#include <sstream>
 #include <string>
-#include <unordered_set>
 #include <vector>
 
+#include "automata/acyclic_builder.hpp"
 #include "automata/dfa.hpp"
+#include "automata/dfa_model.hpp"
+#include "automata/incremental_minimizer.hpp"
 #include "automata/pta.hpp"
+#include "cross_validation.hpp"
 #include "evaluator.hpp"
 #include "project_config.hpp"
+#include "utils/json_escape.hpp"
 #include "utils/parser.hpp"
+#include "utils/stage_metrics.hpp"
+#include "utils/thread_pool.hpp"
+
+// Replaced global allocation functions, so stages can report how often they
+// allocate. The array and nothrow forms forward to these by default. They
+// live here, not in the library, so only the generator pays for the count.
+void* operator new(std::size_t size) {
+    automata_security::record_allocation(size);
+    for (;;) {
+        if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+            return memory;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
 
 namespace automata_security {
 namespace {
 
+enum class TrainingMode {
+    // PTA::build -> DFA::from_pta -> minimize.
+    kPta,
+    // Minimal acyclic construction straight from the sorted samples.
+    kDaciuk,
+};
+
+enum class Minimizer {
+    // DFA::minimize(): sequential Hopcroft refinement.
+    kHopcroft,
+    // DFA::minimize_moore(): round-based refinement on the thread pool.
+    kMoore,
+    // Run both, check they agree and report both timings.
+    kBoth,
+};
+
+enum class StateOrder {
+    // Keep the state ids the minimizer assigns.
+    kMinimizer,
+    // DFA::renumber_breadth_first().
+    kBreadthFirst,
+    // DFA::renumber_by_visits() with the visits of the training samples.
+    kFrequency,
+};
+
 struct CommandLineOptions {
     std::vector<std::string> input_paths;
     std::vector<std::string> test_paths;
     std::string export_dot_path;
     std::string export_definition_path;
     std::string export_grammar_path;
+    std::string export_model_path;
+    // Constexpr C++ classifier header and the namespace it is generated in.
+    std::string export_header_path;
+    std::string header_namespace{"security_dfa_model"};
+    // JSON report of the per-stage timings, memory and results.
+    std::string metrics_json_path;
+    // PTA snapshot to extend with this run's samples, and where to write the
+    // trained PTA for the next run.
+    std::string load_pta_path;
+    std::string save_pta_path;
     double train_ratio{kDefaultTrainRatio};
     unsigned int seed{42U};
     bool train_full{false};
     bool print_definition{false};
+    bool stream{false};
+    std::size_t batch_size{IotStreamOptions{}.batch_size};
+    // Parser and PTA build worker threads; 0 uses every hardware thread.
+    std::size_t threads{0};
+    // Evaluation worker threads; 0 shares the parser pool.
+    std::size_t eval_threads{0};
+    TrainingMode training_mode{TrainingMode::kPta};
+    Minimizer minimizer{Minimizer::kHopcroft};
+    // Renumbering applied to the minimized DFA before evaluation and export.
+    StateOrder state_order{StateOrder::kMinimizer};
+    // Also build the model the other way and check both accept the same language.
+    bool verify_language{false};
+    // Collapse duplicate sequences into weighted records before training and
+    // evaluation (see deduplicate()).
+    bool dedup{true};
+    // How rows become sequences: grouping, windows and extra row features.
+    SequenceOptions sequences;
+    // Sweep mode: k-fold cross-validation (folds > 0) or one split per
+    // (ratio, seed) pair, all on one parse of the inputs. Empty lists fall
+    // back to --train-ratio / --seed.
+    std::size_t folds{0};
+    std::vector<double> sweep_ratios;
+    std::vector<unsigned int> sweep_seeds;
+
+    bool sweep() const { return folds > 0 || !sweep_ratios.empty() || !sweep_seeds.empty(); }
 };
 
 struct FeatureSummary {
@@ -50,8 +144,47 @@ void print_usage(const char* program) {
                   << "  --export-grammar=FILE     Write Chomsky Normal Form (CNF) grammar to FILE.\n"
                   << "                           (produces CNF with helper nonterminals Tn -> a)\n"
                   << "  --print-definition  Print DFA formal definition to stdout.\n"
+                  << "  --stream            Stream datasets in batches instead of loading them\n"
+                  << "                      whole (holdouts always; training with --train-full).\n"
+                  << "  --batch-size=N      Rows per streamed batch (default 65536).\n"
+                  << "  --threads=N         Threads for loading datasets and building the PTA\n"
+                  << "                      (default: all cores).\n"
+                  << "  --eval-threads=N    Threads for classifying test sets (default: --threads).\n"
+                  << "  --training-mode=M   pta (default) or daciuk: build the minimal DFA directly\n"
+                  << "                      from sorted samples without a PTA.\n"
+                  << "  --minimizer=M       hopcroft (default), moore (parallel refinement on\n"
+                  << "                      --threads workers) or both (compare and time both).\n"
+                  << "  --state-order=O     State numbering of the minimized DFA: minimizer (default),\n"
+                  << "                      bfs (breadth-first from the start) or frequency (most\n"
+                  << "                      visited by the training set first); the sink is last.\n"
+                  << "  --no-dedup          Train and evaluate on every row instead of collapsing\n"
+                  << "                      identical sequences first (same results, slower).\n"
+                  << "  --verify-language   Also build the model with the other training mode and\n"
+                  << "                      fail unless both accept the same language.\n"
+                  << "  --group-by=G        row (default: one sequence per row), host or uid:\n"
+                  << "                      concatenate the rows of a host/connection by ts.\n"
+                  << "  --window=W          tumbling (default) or sliding windows over a group.\n"
+                  << "  --window-rows=N     Rows per grouped sequence (default 16).\n"
+                  << "  --window-stride=N   Rows between sliding windows (default 1).\n"
+                  << "  --max-groups=N      Groups kept open at once; older ones are flushed\n"
+                  << "                      early (default 65536).\n"
+                  << "  --features=LIST     Extra bucketed symbols per row: duration, bytes\n"
+                  << "                      (comma-separated; default none).\n"
               << "  --seed=NUM          Random seed for the train/test shuffle.\n"
+              << "  --folds=K           k-fold cross-validation: train and evaluate K models on\n"
+              << "                      one parse of the inputs and print a metrics table.\n"
+              << "  --sweep-ratios=LIST Evaluate one split per ratio (comma-separated) and seed.\n"
+              << "  --sweep-seeds=LIST  Seeds for --folds / --sweep-ratios (default: --seed).\n"
               << "  --export-dot=FILE   Export minimized DFA to DOT file.\n"
+              << "  --export-model=FILE Export minimized DFA as a binary model (api --model).\n"
+              << "  --export-header=FILE  Export minimized DFA as a constexpr C++ header.\n"
+              << "  --header-namespace=NS Namespace of the generated header\n"
+              << "                      (default security_dfa_model).\n"
+              << "  --load-pta=FILE     Start from a PTA snapshot and add only this run's training\n"
+              << "                      samples; the DFA is updated incrementally.\n"
+              << "  --save-pta=FILE     Write the trained PTA as a snapshot for --load-pta.\n"
+              << "  --metrics-json=FILE Write per-stage time, rows/s, peak RSS and allocation\n"
+              << "                      counts, and the evaluation results, as JSON.\n"
               << "  --version           Print version information.\n"
               << "  --help              Show this message.\n";
 }
@@ -95,6 +228,30 @@ bool parse_argument(const std::string& arg,
         opts.export_dot_path = *value;
         return true;
     }
+    if (auto value = parse_key_value(arg, "--export-model=")) {
+        opts.export_model_path = *value;
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--export-header=")) {
+        opts.export_header_path = *value;
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--header-namespace=")) {
+        opts.header_namespace = *value;
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--load-pta=")) {
+        opts.load_pta_path = *value;
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--save-pta=")) {
+        opts.save_pta_path = *value;
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--metrics-json=")) {
+        opts.metrics_json_path = *value;
+        return true;
+    }
     if (auto value = parse_key_value(arg, "--export-grammar=")) {
         opts.export_grammar_path = *value;
         return true;
@@ -111,6 +268,160 @@ bool parse_argument(const std::string& arg,
         opts.print_definition = true;
         return true;
     }
+    if (arg == "--stream") {
+        opts.stream = true;
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--batch-size=")) {
+        opts.batch_size = static_cast<std::size_t>(std::stoull(*value));
+        if (opts.batch_size == 0) {
+            std::cerr << "--batch-size must be positive.\n";
+            return false;
+        }
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--threads=")) {
+        opts.threads = static_cast<std::size_t>(std::stoull(*value));
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--eval-threads=")) {
+        opts.eval_threads = static_cast<std::size_t>(std::stoull(*value));
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--training-mode=")) {
+        if (*value == "pta") {
+            opts.training_mode = TrainingMode::kPta;
+        } else if (*value == "daciuk") {
+            opts.training_mode = TrainingMode::kDaciuk;
+        } else {
+            std::cerr << "Unknown training mode: " << *value << " (expected pta or daciuk)\n";
+            return false;
+        }
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--minimizer=")) {
+        if (*value == "hopcroft") {
+            opts.minimizer = Minimizer::kHopcroft;
+        } else if (*value == "moore") {
+            opts.minimizer = Minimizer::kMoore;
+        } else if (*value == "both") {
+            opts.minimizer = Minimizer::kBoth;
+        } else {
+            std::cerr << "Unknown minimizer: " << *value << " (expected hopcroft, moore or both)\n";
+            return false;
+        }
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--state-order=")) {
+        if (*value == "minimizer") {
+            opts.state_order = StateOrder::kMinimizer;
+        } else if (*value == "bfs") {
+            opts.state_order = StateOrder::kBreadthFirst;
+        } else if (*value == "frequency") {
+            opts.state_order = StateOrder::kFrequency;
+        } else {
+            std::cerr << "Unknown state order: " << *value
+                      << " (expected minimizer, bfs or frequency)\n";
+            return false;
+        }
+        return true;
+    }
+    if (arg == "--no-dedup") {
+        opts.dedup = false;
+        return true;
+    }
+    if (arg == "--verify-language") {
+        opts.verify_language = true;
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--group-by=")) {
+        if (*value == "row") {
+            opts.sequences.group_by = SequenceOptions::GroupBy::kRow;
+        } else if (*value == "host") {
+            opts.sequences.group_by = SequenceOptions::GroupBy::kHost;
+        } else if (*value == "uid") {
+            opts.sequences.group_by = SequenceOptions::GroupBy::kUid;
+        } else {
+            std::cerr << "Unknown grouping: " << *value << " (expected row, host or uid)\n";
+            return false;
+        }
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--window=")) {
+        if (*value == "tumbling") {
+            opts.sequences.window = SequenceOptions::Window::kTumbling;
+        } else if (*value == "sliding") {
+            opts.sequences.window = SequenceOptions::Window::kSliding;
+        } else {
+            std::cerr << "Unknown window: " << *value << " (expected tumbling or sliding)\n";
+            return false;
+        }
+        return true;
+    }
+    // Positive counts for the sequence builder.
+    auto parse_count = [](const std::string& value, const char* name, std::size_t& out) {
+        out = static_cast<std::size_t>(std::stoull(value));
+        if (out == 0) {
+            std::cerr << name << " must be positive.\n";
+            return false;
+        }
+        return true;
+    };
+    if (auto value = parse_key_value(arg, "--window-rows=")) {
+        return parse_count(*value, "--window-rows", opts.sequences.window_rows);
+    }
+    if (auto value = parse_key_value(arg, "--window-stride=")) {
+        return parse_count(*value, "--window-stride", opts.sequences.stride);
+    }
+    if (auto value = parse_key_value(arg, "--max-groups=")) {
+        return parse_count(*value, "--max-groups", opts.sequences.max_groups);
+    }
+    if (auto value = parse_key_value(arg, "--features=")) {
+        opts.sequences.duration_symbols = false;
+        opts.sequences.byte_symbols = false;
+        std::stringstream list(*value);
+        std::string feature;
+        while (std::getline(list, feature, ',')) {
+            if (feature == "duration") {
+                opts.sequences.duration_symbols = true;
+            } else if (feature == "bytes") {
+                opts.sequences.byte_symbols = true;
+            } else if (feature != "none" && !feature.empty()) {
+                std::cerr << "Unknown feature: " << feature << " (expected duration, bytes or none)\n";
+                return false;
+            }
+        }
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--folds=")) {
+        opts.folds = static_cast<std::size_t>(std::stoull(*value));
+        if (opts.folds < 2) {
+            std::cerr << "--folds must be at least 2.\n";
+            return false;
+        }
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--sweep-ratios=")) {
+        std::stringstream list(*value);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            const double ratio = std::stod(item);
+            if (ratio <= 0.0 || ratio >= 1.0) {
+                std::cerr << "--sweep-ratios values must be in (0, 1).\n";
+                return false;
+            }
+            opts.sweep_ratios.push_back(ratio);
+        }
+        return true;
+    }
+    if (auto value = parse_key_value(arg, "--sweep-seeds=")) {
+        std::stringstream list(*value);
+        std::string item;
+        while (std::getline(list, item, ',')) {
+            opts.sweep_seeds.push_back(static_cast<unsigned int>(std::stoul(item)));
+        }
+        return true;
+    }
     if (auto value = parse_key_value(arg, "--test=")) {
         opts.test_paths.push_back(*value);
         return true;
@@ -121,20 +432,125 @@ bool parse_argument(const std::string& arg,
     return false;
 }
 
-std::vector<LabeledSequence> load_dataset(const CommandLineOptions& opts,
-                                          const std::string& path) {
-    (void)opts;
+std::vector<std::vector<LabeledSequence>> load_datasets(const CommandLineOptions& opts,
+                                                        const std::vector<std::string>& paths,
+                                                        SymbolTable& symbols,
+                                                        ThreadPool& pool) {
     // Wrap dataset parsing behind a function so we can swap parser implementations
-    // or add pre/post-processing later. Currently uses the CSV IoT parser.
-    return Parser::load_iot_csv(path);
+    // or add pre/post-processing later. Currently uses the CSV IoT parser, which
+    // parses the files (and ranges of large files) in parallel on `pool`, and
+    // builds the sequences --group-by asks for.
+    return Parser::load_iot_csv_parallel(paths, symbols, pool, opts.sequences);
+}
+
+IotStreamOptions stream_options(const CommandLineOptions& opts) {
+    IotStreamOptions stream;
+    stream.batch_size = opts.batch_size;
+    stream.sequences = opts.sequences;
+    return stream;
 }
 
 struct EvaluationResult {
     std::string source_path;
     Metrics metrics;
     std::size_t test_size{0};
+    // Samples the evaluated model was trained on.
+    std::size_t train_size{0};
 };
 
+void write_json_string(std::ostream& out, const std::string& value) {
+    std::string quoted;
+    append_json_string(quoted, value);
+    out << quoted;
+}
+
+void write_stages_json(std::ostream& out, const std::vector<StageMetrics>& stages, const char* indent) {
+    if (stages.empty()) {
+        out << "[]";
+        return;
+    }
+    out << "[";
+    for (std::size_t i = 0; i < stages.size(); ++i) {
+        const auto& stage = stages[i];
+        out << (i == 0 ? "\n" : ",\n") << indent << "  {\"name\": ";
+        write_json_string(out, stage.name);
+        out << ", \"wall_ms\": " << stage.wall_ms << ", \"rows\": " << stage.rows
+            << ", \"rows_per_second\": " << stage.rows_per_second()
+            << ", \"peak_rss_bytes\": " << stage.peak_rss_bytes
+            << ", \"allocations\": " << stage.allocations
+            << ", \"allocated_bytes\": " << stage.allocated_bytes << "}";
+    }
+    out << "\n" << indent << "]";
+}
+
+// One line of the "Stages" summary; `source` names the test set of an
+// evaluation stage.
+void print_stage(const StageMetrics& stage, const std::string& source = {}) {
+    constexpr double kMiB = 1024.0 * 1024.0;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << stage.name;
+    if (!source.empty()) {
+        std::cout << " (" << source << ")";
+    }
+    std::cout << ": " << stage.wall_ms << " ms";
+    if (stage.rows > 0) {
+        std::cout << ", " << std::setprecision(0) << stage.rows_per_second() << " rows/s"
+                  << std::setprecision(1);
+    }
+    std::cout << ", peak RSS " << static_cast<double>(stage.peak_rss_bytes) / kMiB << " MiB, "
+              << stage.allocations << " allocations ("
+              << static_cast<double>(stage.allocated_bytes) / kMiB << " MiB)\n";
+}
+
+// --metrics-json: the run's stages and every evaluation result in one
+// document, for capacity planning and regression tracking.
+void write_metrics_json(const std::string& path,
+                        const CommandLineOptions& opts,
+                        std::size_t sample_count,
+                        std::size_t train_count,
+                        std::size_t states_before,
+                        std::size_t states_after,
+                        const std::vector<StageMetrics>& stages,
+                        const std::vector<EvaluationResult>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to open metrics output file: " + path);
+    }
+    out << std::fixed << std::setprecision(6);
+    out << "{\n  \"version\": ";
+    write_json_string(out, kVersion);
+    out << ",\n  \"inputs\": [";
+    for (std::size_t i = 0; i < opts.input_paths.size(); ++i) {
+        out << (i == 0 ? "" : ", ");
+        write_json_string(out, opts.input_paths[i]);
+    }
+    out << "],\n  \"samples\": " << sample_count << ",\n  \"train_samples\": " << train_count
+        << ",\n  \"states_before\": " << states_before
+        << ",\n  \"states_after\": " << states_after << ",\n  \"stages\": ";
+    write_stages_json(out, stages, "  ");
+    out << ",\n  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& result = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"source\": ";
+        write_json_string(out, result.source_path);
+        out << ",\n     \"train_samples\": " << result.train_size
+            << ",\n     \"test_samples\": " << result.test_size
+            << ",\n     \"accuracy\": " << result.metrics.accuracy
+            << ",\n     \"false_positive_rate\": " << result.metrics.false_positive_rate
+            << ",\n     \"false_negative_rate\": " << result.metrics.false_negative_rate
+            << ",\n     \"states_before\": " << result.metrics.states_before
+            << ",\n     \"states_after\": " << result.metrics.states_after
+            << ",\n     \"minimization_ms\": " << result.metrics.minimization_ms
+            << ",\n     \"stages\": ";
+        write_stages_json(out, result.metrics.stages, "     ");
+        out << "}";
+    }
+    out << (results.empty() ? "]" : "\n  ]") << "\n}\n";
+    if (!out) {
+        throw std::runtime_error("Failed to write metrics file: " + path);
+    }
+}
+
 void export_dot_if_requested(const DFA& dfa, const std::string& path) {
     if (path.empty()) {
         return;
@@ -150,6 +566,45 @@ void export_dot_if_requested(const DFA& dfa, const std::string& path) {
     output << dfa.to_dot();
 }
 
+void export_model_if_requested(const DFA& dfa,
+                               const std::string& path,
+                               const SequenceOptions& sequences) {
+    if (path.empty()) {
+        return;
+    }
+
+    // Binary model with the dense table, labels, counts and the sequence
+    // options (so the detector can refuse a model it would feed differently);
+    // see dfa_model.hpp.
+    const std::string bytes = serialize_dfa_model(dfa, sequences);
+    std::ofstream output(path, std::ios::binary);
+    if (!output.is_open()) {
+        throw std::runtime_error("Failed to open model output file: " + path);
+    }
+    output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!output) {
+        throw std::runtime_error("Failed to write model file: " + path);
+    }
+}
+
+void export_header_if_requested(const DFA& dfa,
+                                const std::string& path,
+                                const std::string& name_space,
+                                const SequenceOptions& sequences) {
+    if (path.empty()) {
+        return;
+    }
+
+    // Self-contained classifier for builds that compile the model in; see
+    // DFA::to_cpp_header.
+    const std::string header = dfa.to_cpp_header(name_space, sequences);
+    std::ofstream output(path);
+    if (!output.is_open()) {
+        throw std::runtime_error("Failed to open header output file: " + path);
+    }
+    output << header;
+}
+
 void export_grammar_if_requested(const DFA& dfa, const std::string& path) {
     if (path.empty()) {
         return;
@@ -166,31 +621,33 @@ void export_grammar_if_requested(const DFA& dfa, const std::string& path) {
     output << dfa.to_chomsky();
 }
 
-FeatureSummary summarize_features(const std::vector<LabeledSequence>& samples,
-                                  std::size_t max_display = 20) {
-    FeatureSummary summary;
-    if (samples.empty()) {
-        return summary;
-    }
-
-
-    // Collect a set of unique feature tokens across all samples. Using an
-    // unordered_set ensures deduplication; reserve a modest bucket count to
-    // reduce reallocations for typical dataset sizes.
-    std::unordered_set<std::string> unique;
-    unique.reserve(256);
-
+// Flag every symbol id used by `samples`. Symbols are dense interned ids, so
+// a flag per table entry is enough for deduplication; this also works batch by
+// batch when the training data is streamed.
+void mark_features(const std::vector<LabeledSequence>& samples, std::vector<char>& seen) {
     for (const auto& sample : samples) {
-        for (const auto& symbol : sample.symbols) {
-            // Each symbol is expected to be a short token such as `proto=tcp`.
-            unique.insert(symbol);
+        for (const auto symbol : sample.symbols) {
+            if (symbol >= seen.size()) {
+                seen.resize(static_cast<std::size_t>(symbol) + 1, 0);
+            }
+            seen[symbol] = 1;
         }
     }
+}
 
-    summary.unique_count = unique.size();
+FeatureSummary summarize_features(const std::vector<char>& seen,
+                                  const SymbolTable& symbols,
+                                  std::size_t max_display = 20) {
+    FeatureSummary summary;
 
-    // Sort tokens for deterministic display.
-    std::vector<std::string> sorted(unique.begin(), unique.end());
+    // Translate back to tokens such as `proto=tcp` and sort for deterministic display.
+    std::vector<std::string> sorted;
+    for (std::size_t id = 0; id < seen.size(); ++id) {
+        if (seen[id]) {
+            sorted.push_back(symbols.name(static_cast<SymbolId>(id)));
+        }
+    }
+    summary.unique_count = sorted.size();
     std::sort(sorted.begin(), sorted.end());
 
     if (sorted.size() > max_display) {
@@ -203,6 +660,154 @@ FeatureSummary summarize_features(const std::vector<LabeledSequence>& samples,
     return summary;
 }
 
+// Options that act on the single model of a regular run; a sweep trains one
+// model per run. Returns the first one given, or null.
+const char* sweep_conflict(const CommandLineOptions& opts) {
+    if (opts.train_full) {
+        return "--train-full";
+    }
+    if (!opts.test_paths.empty()) {
+        return "--test";
+    }
+    if (opts.stream) {
+        return "--stream";
+    }
+    if (!opts.load_pta_path.empty() || !opts.save_pta_path.empty()) {
+        return "--load-pta/--save-pta";
+    }
+    if (opts.training_mode != TrainingMode::kPta || opts.minimizer != Minimizer::kHopcroft ||
+        opts.verify_language || opts.state_order != StateOrder::kMinimizer) {
+        return "--training-mode, --minimizer, --verify-language or --state-order";
+    }
+    if (!opts.export_dot_path.empty() || !opts.export_model_path.empty() ||
+        !opts.export_header_path.empty() || !opts.export_grammar_path.empty() ||
+        !opts.export_definition_path.empty() || opts.print_definition) {
+        return "exports";
+    }
+    return nullptr;
+}
+
+// Sweep mode: deduplicate the loaded samples once, then train and evaluate
+// every run on `pool`, each reweighting the shared records (see run_sweep()),
+// and print one table of all runs plus the mean and standard deviation of
+// each group of runs.
+void run_sweep_mode(const CommandLineOptions& options,
+                    std::vector<LabeledSequence> samples,
+                    const SymbolTable& symbols,
+                    ThreadPool& pool,
+                    std::vector<StageMetrics>& stages) {
+    const std::size_t sample_count = samples.size();
+    std::cout << "[2/3] Indexing distinct sequences..." << std::endl;
+    const StageTimer index_timer("sweep_index");
+    const SweepData data = SweepData::from_samples(samples);
+    samples = std::vector<LabeledSequence>{};  // the records are all the runs need
+    stages.push_back(index_timer.stop(sample_count));
+    std::cout << "      Distinct sequences: " << data.records.size() << std::endl;
+
+    const std::vector<unsigned int> seeds =
+        options.sweep_seeds.empty() ? std::vector<unsigned int>{options.seed} : options.sweep_seeds;
+    const std::vector<SweepRun> runs =
+        options.folds > 0
+            ? k_fold_runs(options.folds, seeds)
+            : split_runs(options.sweep_ratios.empty() ? std::vector<double>{options.train_ratio}
+                                                      : options.sweep_ratios,
+                         seeds);
+    std::cout << "[3/3] Training and evaluating " << runs.size() << " runs on " << pool.size()
+              << " threads..." << std::endl;
+    const StageTimer sweep_timer("sweep");
+    const auto results = run_sweep(data, symbols, runs, pool);
+    stages.push_back(sweep_timer.stop(sample_count * runs.size()));
+
+    std::cout << "\nSweep" << std::endl;
+    std::cout << "=====" << std::endl;
+    std::cout << std::left << std::setw(24) << "Run" << std::right << std::setw(9) << "Train"
+              << std::setw(9) << "Test" << std::setw(9) << "States" << std::setw(11) << "Accuracy"
+              << std::setw(10) << "FPR" << std::setw(10) << "FNR" << std::setw(11) << "Time (ms)"
+              << "\n";
+    std::cout << std::fixed;
+    for (const auto& result : results) {
+        std::cout << std::left << std::setw(24) << result.run.name() << std::right
+                  << std::setw(9) << result.train_size << std::setw(9) << result.test_size
+                  << std::setw(9) << result.metrics.states_after << std::setprecision(4)
+                  << std::setw(10) << result.metrics.accuracy * 100.0 << "%" << std::setw(9)
+                  << result.metrics.false_positive_rate * 100.0 << "%" << std::setw(9)
+                  << result.metrics.false_negative_rate * 100.0 << "%" << std::setprecision(1)
+                  << std::setw(11) << result.wall_ms << "\n";
+    }
+
+    // Groups in order of first appearance; single runs need no summary.
+    std::vector<std::string> groups;
+    for (const auto& result : results) {
+        const auto group = result.run.group();
+        if (std::find(groups.begin(), groups.end(), group) == groups.end()) {
+            groups.push_back(group);
+        }
+    }
+    bool header = false;
+    for (const auto& group : groups) {
+        std::vector<const Metrics*> members;
+        for (const auto& result : results) {
+            if (result.run.group() == group) {
+                members.push_back(&result.metrics);
+            }
+        }
+        if (members.size() < 2) {
+            continue;
+        }
+        if (!header) {
+            std::cout << "\nMean +/- standard deviation per group\n";
+            header = true;
+        }
+        // Sample standard deviation over the group's runs.
+        auto describe = [&](double Metrics::*field) {
+            double mean = 0.0;
+            for (const auto* metrics : members) {
+                mean += metrics->*field;
+            }
+            mean /= static_cast<double>(members.size());
+            double squares = 0.0;
+            for (const auto* metrics : members) {
+                squares += (metrics->*field - mean) * (metrics->*field - mean);
+            }
+            const double deviation = std::sqrt(squares / static_cast<double>(members.size() - 1));
+            std::ostringstream text;
+            text << std::fixed << std::setprecision(4) << mean * 100.0 << "% +/- "
+                 << deviation * 100.0;
+            return text.str();
+        };
+        std::cout << "  " << group << " (" << members.size() << " runs): accuracy "
+                  << describe(&Metrics::accuracy) << ", FPR "
+                  << describe(&Metrics::false_positive_rate) << ", FNR "
+                  << describe(&Metrics::false_negative_rate) << "\n";
+    }
+
+    std::cout << "\nStages" << std::endl;
+    std::cout << "======" << std::endl;
+    for (const auto& stage : stages) {
+        print_stage(stage);
+    }
+
+    if (!options.metrics_json_path.empty()) {
+        // There is no single model: the top-level train and state counts
+        // are 0, and each result carries its run's.
+        std::vector<EvaluationResult> evaluation_results;
+        for (const auto& result : results) {
+            EvaluationResult entry;
+            entry.source_path = result.run.name();
+            entry.metrics = result.metrics;
+            entry.test_size = result.test_size;
+            entry.train_size = result.train_size;
+            evaluation_results.push_back(std::move(entry));
+        }
+        try {
+            write_metrics_json(options.metrics_json_path, options, sample_count, 0, 0, 0, stages,
+                               evaluation_results);
+        } catch (const std::exception& ex) {
+            std::cerr << "Warning: " << ex.what() << std::endl;
+        }
+    }
+}
+
 }  // namespace
 }  // namespace automata_security
 
@@ -239,29 +844,153 @@ int main(int argc, char* argv[]) {
             options.input_paths.push_back(kDefaultIotDataset);
         }
 
+        if (options.folds > 0 && !options.sweep_ratios.empty()) {
+            std::cerr << "--folds and --sweep-ratios are alternatives; pass one of them." << std::endl;
+            return 1;
+        }
+        if (options.sweep()) {
+            if (const char* conflict = sweep_conflict(options)) {
+                std::cerr << "--folds, --sweep-ratios and --sweep-seeds cannot be combined with "
+                          << conflict << "." << std::endl;
+                return 1;
+            }
+        }
+        if (options.sequences.grouped()) {
+            const auto& sequences = options.sequences;
+            std::cout << "Sequences: rows grouped by "
+                      << (sequences.group_by == SequenceOptions::GroupBy::kHost ? "host" : "uid") << ", "
+                      << (sequences.window == SequenceOptions::Window::kSliding ? "sliding" : "tumbling")
+                      << " windows of " << sequences.window_rows << " rows";
+            if (sequences.window == SequenceOptions::Window::kSliding) {
+                std::cout << " every " << sequences.stride << " rows";
+            }
+            std::cout << "." << std::endl;
+        }
+
+        // Training can only be streamed when there is no split: the shuffle in
+        // train_test_split needs every sample in memory.
+        const bool stream_training = options.stream && options.train_full;
+        if (options.stream && !options.train_full) {
+            std::cerr << "Note: --stream without --train-full only streams holdout datasets;"
+                         " the train/test split still loads the inputs in memory." << std::endl;
+        }
+        const bool daciuk = options.training_mode == TrainingMode::kDaciuk;
+        if (stream_training && (daciuk || options.verify_language)) {
+            // Both need the sorted training set in memory.
+            std::cerr << "--training-mode=daciuk and --verify-language cannot be combined with"
+                         " streamed training (--stream --train-full)." << std::endl;
+            return 1;
+        }
+        if (stream_training && options.state_order == StateOrder::kFrequency) {
+            // The visits are counted on the training set after minimization.
+            std::cerr << "--state-order=frequency cannot be combined with"
+                         " streamed training (--stream --train-full)." << std::endl;
+            return 1;
+        }
+        const bool snapshot = !options.load_pta_path.empty() || !options.save_pta_path.empty();
+        if (snapshot && (daciuk || options.verify_language)) {
+            // Daciuk mode builds no PTA, and the reference model would only
+            // see this run's samples, not the ones already in the snapshot.
+            std::cerr << "--load-pta and --save-pta cannot be combined with"
+                         " --training-mode=daciuk or --verify-language." << std::endl;
+            return 1;
+        }
+        if (options.minimizer != Minimizer::kHopcroft && (daciuk || !options.load_pta_path.empty())) {
+            // Both produce the minimized DFA without a separate minimize() call.
+            std::cerr << "--minimizer=moore|both cannot be combined with"
+                         " --training-mode=daciuk or --load-pta." << std::endl;
+            return 1;
+        }
+
+        // One symbol table is shared by every dataset of the run so training
+        // and holdout sequences use the same ids.
+        SymbolTable symbols;
+        ThreadPool pool(options.threads);
         std::vector<LabeledSequence> samples;
-        // Step 2: Load datasets into in-memory labeled sequences
-        for (const auto& path : options.input_paths) {
+        std::vector<char> seen_features;
+        std::size_t sample_count = 0;
+        PTA pta;
+        // With a snapshot the history is already in the PTA: its symbols are
+        // interned first, so new samples reuse the same ids. The minimizer
+        // classifies the loaded PTA once, then refreshes only the paths this
+        // run's samples touch.
+        std::optional<IncrementalMinimizer> incremental;
+        // Every stage of the run, in order, for the summary and --metrics-json.
+        std::vector<StageMetrics> stages;
+        if (!options.load_pta_path.empty()) {
+            std::cout << "[1/5] Loading PTA snapshot from: " << options.load_pta_path << std::endl;
+            const StageTimer timer("load_pta_snapshot");
+            pta = PTA::load(options.load_pta_path, symbols);
+            incremental.emplace(pta);
+            stages.push_back(timer.stop());
+            std::cout << "      PTA states: " << pta.size() << std::endl;
+        }
+        // Step 2: Load datasets into in-memory labeled sequences, or stream
+        // them batch by batch straight into the PTA. In-memory loads parse
+        // every input at once; results come back in input order, so the
+        // concatenation (and therefore the seeded split) is deterministic.
+        // Feeds streamed training batches to the PTA, through the minimizer
+        // when one is attached.
+        auto train_batch = [&](const auto& batch) {
+            if (incremental) {
+                incremental->add(batch);
+            } else {
+                pta.add(batch);
+            }
+        };
+        std::vector<std::vector<LabeledSequence>> loaded;
+        // Streamed training inserts every batch into the PTA as it is
+        // parsed, so that stage covers both.
+        const StageTimer load_timer(stream_training ? "load_and_pta_build" : "load");
+        if (!stream_training) {
+            loaded = load_datasets(options, options.input_paths, symbols, pool);
+        }
+        for (std::size_t input = 0; input < options.input_paths.size(); ++input) {
+            const auto& path = options.input_paths[input];
             std::cout << "[1/5] Loading IoT dataset from: " << path << std::endl;
-            auto current_samples = load_dataset(options, path);
+            if (stream_training) {
+                const auto streamed = Parser::stream_iot_csv(
+                    path, symbols, stream_options(options),
+                    [&](std::vector<LabeledSequence>& batch) {
+                        mark_features(batch, seen_features);
+                        if (options.dedup) {
+                            train_batch(deduplicate(batch));
+                        } else {
+                            train_batch(batch);
+                        }
+                    });
+                if (streamed == 0) {
+                    std::cerr << "Warning: No samples loaded from " << path << std::endl;
+                } else {
+                    std::cout << "      Streamed " << streamed << " sequences." << std::endl;
+                    sample_count += streamed;
+                }
+                continue;
+            }
+
+            auto current_samples = std::move(loaded[input]);
             if (current_samples.empty()) {
                 std::cerr << "Warning: No samples loaded from " << path << std::endl;
             } else {
                 std::cout << "      Loaded " << current_samples.size() << " sequences." << std::endl;
+                mark_features(current_samples, seen_features);
+                sample_count += current_samples.size();
                 samples.insert(samples.end(),
                                std::make_move_iterator(current_samples.begin()),
                                std::make_move_iterator(current_samples.end()));
             }
         }
 
+        stages.push_back(load_timer.stop(sample_count));
+
         // Sanity check: ensure we actually loaded samples
-        if (samples.empty()) {
+        if (sample_count == 0) {
             std::cerr << "No samples loaded from any input. Check dataset paths and format." << std::endl;
             return 1;
         }
-        std::cout << "      Total loaded: " << samples.size() << " sequences." << std::endl;
+        std::cout << "      Total loaded: " << sample_count << " sequences." << std::endl;
 
-        auto feature_summary = summarize_features(samples);
+        auto feature_summary = summarize_features(seen_features, symbols);
         std::cout << "      Features (" << feature_summary.unique_count << " unique): ";
         if (feature_summary.sample_features.empty()) {
             std::cout << "(none)" << std::endl;
@@ -280,20 +1009,30 @@ int main(int argc, char* argv[]) {
             std::cout << std::endl;
         }
 
+        // Sweep mode trains and evaluates one model per run on these samples
+        // instead of the single split below.
+        if (options.sweep()) {
+            run_sweep_mode(options, std::move(samples), symbols, pool, stages);
+            return 0;
+        }
+
         // Step 3: Train/test split (or train on full dataset when requested)
         std::vector<LabeledSequence> train_sequences;
         std::vector<LabeledSequence> local_test_sequences;
 
         if (options.train_full) {
-            // Train on all samples (no split)
-            train_sequences = samples;
-            std::cout << "[2/6] Training on entire dataset (" << train_sequences.size()
-                      << " sequences)." << std::endl;
+            // Train on all samples (no split). Streamed samples already went
+            // into the PTA during loading.
+            train_sequences = std::move(samples);
+            std::cout << "[2/6] Training on entire dataset (" << sample_count
+                      << " sequences" << (stream_training ? ", streamed" : "") << ")." << std::endl;
         } else {
             // Create a randomized train/test split with a reproducible seed
             std::cout << "[2/6] Splitting dataset with train_ratio=" << options.train_ratio
                       << " and seed=" << options.seed << std::endl;
+            const StageTimer timer("split");
             auto split = train_test_split(samples, options.train_ratio, options.seed);
+            stages.push_back(timer.stop(samples.size()));
             if (split.train.empty() || split.test.empty()) {
                 std::cerr << "Train/test split produced empty partition. Adjust train ratio." << std::endl;
                 return 1;
@@ -304,23 +1043,83 @@ int main(int argc, char* argv[]) {
                       << ", Test: " << local_test_sequences.size() << std::endl;
         }
 
+    const std::size_t train_count = stream_training ? sample_count : train_sequences.size();
+    DFA dfa;
+    std::size_t states_before = 0;
+    double minimization_ms = 0.0;
+    // Moore timing when --minimizer=both; minimization_ms is then Hopcroft's.
+    std::optional<double> moore_ms;
+    // Reference model for --verify-language: the minimized DFA built with the
+    // other training mode.
+    auto pta_reference = [&]() {
+        PTA reference;
+        reference.build(train_sequences);
+        return DFA::from_pta(reference, symbols).minimize();
+    };
+
+    if (daciuk) {
+    // Steps 4-6 (Daciuk mode): insert the sorted, deduplicated accepted
+    // sequences into a minimal acyclic automaton, registering equivalent
+    // suffix states as they are completed, so no PTA is ever materialized.
+    // A final minimize() over the (already minimal) result only costs one
+    // refinement pass; its time is included in minimization_ms.
+    std::cout << "[3/6] Building minimal acyclic DFA from sorted samples (Daciuk)..." << std::endl;
+        const StageTimer construction_timer("acyclic_build");
+        DFA acyclic = build_minimal_acyclic_dfa(train_sequences, symbols);
+        stages.push_back(construction_timer.stop(train_count));
+        states_before = acyclic.states().size();
+        std::cout << "      Acyclic DFA states: " << states_before << std::endl;
+    std::cout << "[5/6] Minimizing DFA..." << std::endl;
+        const StageTimer minimization_timer("minimize");
+        dfa = acyclic.minimize();
+        stages.push_back(minimization_timer.stop(train_count));
+        minimization_ms = stages[stages.size() - 2].wall_ms + stages.back().wall_ms;
+    } else {
     // Step 4: Build the Prefix Tree Acceptor (PTA) from training sequences.
     // The PTA is a trie where each path corresponds to a training sequence;
     // nodes accumulate positive/negative counts so later we can derive an
     // acceptance decision for each node when converting to a DFA.
     std::cout << "[3/6] Building Prefix Tree Acceptor (PTA)..." << std::endl;
 
-    PTA pta;
-    pta.build(train_sequences);
-    std::cout << "      PTA states: " << pta.nodes().size() << std::endl;
+    const StageTimer pta_timer("pta_build");
+    if (!stream_training && options.dedup) {
+        // Duplicates walk the same path, so each distinct sequence is
+        // inserted once with its label counts; the PTA is unchanged.
+        const auto records = deduplicate(train_sequences);
+        std::cout << "      Distinct training sequences: " << records.size() << std::endl;
+        if (incremental) {
+            incremental->add(records);
+        } else {
+            pta.build(records, pool);
+        }
+    } else if (!stream_training) {
+        if (incremental) {
+            incremental->add(train_sequences);
+        } else {
+            // Node ids match the sequential build; see PTA::build.
+            pta.build(train_sequences, pool);
+        }
+    }
+    if (!stream_training) {
+        stages.push_back(pta_timer.stop(train_count));
+    }
+    std::cout << "      PTA states: " << pta.size() << std::endl;
 
     // Step 5: Convert PTA -> DFA and ensure completeness of the transition function.
     // Missing transitions for some symbols are redirected to a sink (dead)
     // state to make the DFA total; this simplifies classification and
     // exporting the DFA to DOT/CNF later.
     std::cout << "[4/6] Constructing DFA from PTA and ensuring total transitions..." << std::endl;
-    DFA dfa = DFA::from_pta(pta);
-    const std::size_t states_before = dfa.states().size();
+    if (incremental) {
+        // The incremental minimizer goes straight to the minimized DFA; the
+        // unminimized one would have a state per node plus the sink.
+        states_before = pta.size() + (pta.size() > 1 ? 1 : 0);
+    } else {
+        const StageTimer timer("from_pta");
+        dfa = DFA::from_pta(pta, symbols);
+        stages.push_back(timer.stop(train_count));
+        states_before = dfa.states().size();
+    }
 
     std::cout << "      DFA states: " << states_before << std::endl;
 
@@ -328,17 +1127,80 @@ int main(int argc, char* argv[]) {
     // Minimization merges equivalent states, producing a smaller DFA that
     // recognizes the same language; timings are recorded for diagnostics.
     std::cout << "[5/6] Minimizing DFA..." << std::endl;
-        const auto minimization_start = std::chrono::steady_clock::now();
-        DFA minimized = dfa.minimize();
-        const auto minimization_end = std::chrono::steady_clock::now();
-        const double minimization_ms =
-            std::chrono::duration<double, std::milli>(minimization_end - minimization_start)
-                .count();
+        const StageTimer minimization_timer("minimize");
+        DFA minimized;
+        if (incremental) {
+            minimized = incremental->dfa(symbols);
+        } else if (options.minimizer == Minimizer::kMoore) {
+            minimized = dfa.minimize_moore(pool);
+        } else {
+            minimized = dfa.minimize();
+        }
+        stages.push_back(minimization_timer.stop(train_count));
+        minimization_ms = stages.back().wall_ms;
+        if (options.minimizer == Minimizer::kBoth) {
+            const StageTimer moore_timer("minimize_moore");
+            const DFA moore = dfa.minimize_moore(pool);
+            stages.push_back(moore_timer.stop(train_count));
+            moore_ms = stages.back().wall_ms;
+            if (moore.to_dot() != minimized.to_dot()) {
+                throw std::runtime_error("Minimizer check failed: Hopcroft and Moore disagree.");
+            }
+            std::cout << "      Hopcroft: " << minimization_ms << " ms, Moore: " << *moore_ms
+                      << " ms (identical)" << std::endl;
+        }
         dfa = std::move(minimized);
+    }
         const std::size_t states_after = dfa.states().size();
         std::cout << "      Minimized DFA states: " << states_after << std::endl;
+        if (options.state_order != StateOrder::kMinimizer) {
+            // Put the states classification walks together next to each
+            // other in the dense table, with the sink last.
+            const StageTimer timer("renumber_states");
+            if (options.state_order == StateOrder::kBreadthFirst) {
+                dfa = dfa.renumber_breadth_first();
+            } else {
+                std::vector<std::size_t> visits(states_after, 0);
+                if (options.dedup) {
+                    for (const auto& record : deduplicate(train_sequences)) {
+                        dfa.count_visits(record.symbols,
+                                         record.positive_count + record.negative_count, visits);
+                    }
+                } else {
+                    for (const auto& sample : train_sequences) {
+                        dfa.count_visits(sample.symbols, 1, visits);
+                    }
+                }
+                dfa = dfa.renumber_by_visits(visits);
+            }
+            stages.push_back(timer.stop(train_count));
+            std::cout << "      States renumbered ("
+                      << (options.state_order == StateOrder::kBreadthFirst ? "breadth-first" : "by visits")
+                      << ")." << std::endl;
+        }
+        if (!options.save_pta_path.empty()) {
+            const StageTimer timer("save_pta");
+            pta.save(options.save_pta_path, symbols);
+            stages.push_back(timer.stop());
+            std::cout << "      Saved PTA snapshot: " << options.save_pta_path << std::endl;
+        }
+
+        if (options.verify_language) {
+            std::cout << "      Verifying language against the "
+                      << (daciuk ? "PTA" : "Daciuk") << " construction..." << std::endl;
+            const StageTimer timer("verify_language");
+            const DFA reference =
+                daciuk ? pta_reference() : build_minimal_acyclic_dfa(train_sequences, symbols).minimize();
+            stages.push_back(timer.stop(train_count));
+            if (!dfa.same_language(reference)) {
+                throw std::runtime_error("Language check failed: training modes disagree.");
+            }
+            std::cout << "      Language check: identical (" << reference.states().size()
+                      << " states)" << std::endl;
+        }
 
         if (options.print_definition || !options.export_definition_path.empty()) {
+            const StageTimer timer("export_definition");
             const auto definition_text = dfa.to_definition();
             if (options.print_definition) {
                 std::cout << "\n" << definition_text << std::endl;
@@ -352,6 +1214,7 @@ int main(int argc, char* argv[]) {
                     definition_output << definition_text;
                 }
             }
+            stages.push_back(timer.stop());
         }
 
     // Step 7: Evaluate the resulting DFA on the test partition and any
@@ -359,21 +1222,88 @@ int main(int argc, char* argv[]) {
     // rates and annotates the metrics with state counts and minimization time.
     std::cout << "[6/6] Evaluating DFA on test set..." << std::endl;
         std::vector<EvaluationResult> evaluation_results;
+        // Classification only reads the DFA, so test sets are split across a
+        // pool; a separate one is only started when --eval-threads asks for it.
+        std::optional<ThreadPool> dedicated_eval_pool;
+        if (options.eval_threads != 0 && options.eval_threads != pool.size()) {
+            dedicated_eval_pool.emplace(options.eval_threads);
+        }
+        ThreadPool& eval_pool = dedicated_eval_pool ? *dedicated_eval_pool : pool;
+        // Holdouts are loaded one at a time, so only the one being evaluated
+        // is in memory. With its own evaluation pool, the next holdout is
+        // parsed on `pool` while the current one is classified.
+        struct LoadedHoldout {
+            std::vector<LabeledSequence> samples;
+            StageMetrics stage;
+        };
+        auto load_holdout = [&](std::size_t holdout) {
+            const StageTimer timer("load");
+            LoadedHoldout loaded;
+            loaded.samples = std::move(
+                load_datasets(options, {options.test_paths[holdout]}, symbols, pool).front());
+            loaded.stage = timer.stop(loaded.samples.size());
+            return loaded;
+        };
+        std::future<LoadedHoldout> next_holdout;
 
         if (!local_test_sequences.empty()) {
             EvaluationResult result;
             result.source_path = "combined_inputs";
             result.test_size = local_test_sequences.size();
-            result.metrics = evaluate(dfa, local_test_sequences);
+            result.train_size = train_count;
+            const StageTimer timer("evaluate");
+            result.metrics = options.dedup
+                                 ? evaluate(dfa, deduplicate(local_test_sequences), eval_pool)
+                                 : evaluate(dfa, local_test_sequences, eval_pool);
+            result.metrics.stages.push_back(timer.stop(result.test_size));
             result.metrics.states_before = states_before;
             result.metrics.states_after = states_after;
             result.metrics.minimization_ms = minimization_ms;
             evaluation_results.push_back(result);
         }
 
-        for (const auto& test_path : options.test_paths) {
+        for (std::size_t holdout = 0; holdout < options.test_paths.size(); ++holdout) {
+            const auto& test_path = options.test_paths[holdout];
             std::cout << "      Evaluating holdout dataset: " << test_path << std::endl;
-            auto holdout_samples = load_dataset(options, test_path);
+            if (options.stream) {
+                // Classify each batch as it is parsed; only the confusion
+                // counts are kept.
+                ConfusionCounts counts;
+                const StageTimer timer("load_and_evaluate");
+                const auto streamed = Parser::stream_iot_csv(
+                    test_path, symbols, stream_options(options),
+                    [&](std::vector<LabeledSequence>& batch) {
+                        if (options.dedup) {
+                            accumulate(dfa, deduplicate(batch), counts, eval_pool);
+                        } else {
+                            accumulate(dfa, batch, counts, eval_pool);
+                        }
+                    });
+                if (streamed == 0) {
+                    std::cerr << "        Warning: no samples loaded from " << test_path
+                              << std::endl;
+                    continue;
+                }
+
+                EvaluationResult result;
+                result.source_path = test_path;
+                result.test_size = streamed;
+                result.train_size = train_count;
+                result.metrics = metrics_from_counts(counts);
+                result.metrics.stages.push_back(timer.stop(streamed));
+                result.metrics.states_before = states_before;
+                result.metrics.states_after = states_after;
+                result.metrics.minimization_ms = minimization_ms;
+                evaluation_results.push_back(std::move(result));
+                continue;
+            }
+
+            LoadedHoldout loaded =
+                next_holdout.valid() ? next_holdout.get() : load_holdout(holdout);
+            if (dedicated_eval_pool && holdout + 1 < options.test_paths.size()) {
+                next_holdout = std::async(std::launch::async, load_holdout, holdout + 1);
+            }
+            auto holdout_samples = std::move(loaded.samples);
             if (holdout_samples.empty()) {
                 std::cerr << "        Warning: no samples loaded from " << test_path
                           << std::endl;
@@ -383,7 +1313,13 @@ int main(int argc, char* argv[]) {
             EvaluationResult result;
             result.source_path = test_path;
             result.test_size = holdout_samples.size();
-            result.metrics = evaluate(dfa, holdout_samples);
+            result.train_size = train_count;
+            const StageTimer timer("evaluate");
+            result.metrics = options.dedup
+                                 ? evaluate(dfa, deduplicate(holdout_samples), eval_pool)
+                                 : evaluate(dfa, holdout_samples, eval_pool);
+            result.metrics.stages.push_back(std::move(loaded.stage));
+            result.metrics.stages.push_back(timer.stop(result.test_size));
             result.metrics.states_before = states_before;
             result.metrics.states_after = states_after;
             result.metrics.minimization_ms = minimization_ms;
@@ -397,7 +1333,7 @@ int main(int argc, char* argv[]) {
         for (const auto& p : options.input_paths) {
             std::cout << "  Input: " << p << "\n";
         }
-        std::cout << "Samples: " << samples.size() << " (train=" << train_sequences.size();
+        std::cout << "Samples: " << sample_count << " (train=" << train_count;
         if (!local_test_sequences.empty()) {
             std::cout << ", test=" << local_test_sequences.size();
         }
@@ -426,6 +1362,9 @@ int main(int argc, char* argv[]) {
         }
         std::cout << "States: before=" << states_before << ", after=" << states_after << "\n";
         std::cout << "Minimization: " << minimization_ms << " ms\n";
+        if (moore_ms) {
+            std::cout << "Minimization (Moore): " << *moore_ms << " ms\n";
+        }
         if (!options.export_definition_path.empty()) {
             std::cout << "Definition file: " << options.export_definition_path << "\n";
         }
@@ -444,10 +1383,36 @@ int main(int argc, char* argv[]) {
                       << " ms\n";
         }
 
+        auto timed_export = [&](const char* stage, const std::string& path, auto&& export_file) {
+            if (path.empty()) {
+                return;
+            }
+            const StageTimer timer(stage);
+            export_file(dfa, path);
+            stages.push_back(timer.stop());
+        };
         try {
-            export_dot_if_requested(dfa, options.export_dot_path);
+            timed_export("export_dot", options.export_dot_path, export_dot_if_requested);
+            try {
+                timed_export("export_model", options.export_model_path,
+                             [&](const DFA& model, const std::string& path) {
+                                 export_model_if_requested(model, path, options.sequences);
+                             });
+            } catch (const std::exception& ex) {
+                std::cerr << "Warning: " << ex.what() << std::endl;
+            }
             try {
-                export_grammar_if_requested(dfa, options.export_grammar_path);
+                timed_export("export_header", options.export_header_path,
+                             [&](const DFA& model, const std::string& path) {
+                                 export_header_if_requested(model, path, options.header_namespace,
+                                                            options.sequences);
+                             });
+            } catch (const std::exception& ex) {
+                std::cerr << "Warning: " << ex.what() << std::endl;
+            }
+            try {
+                timed_export("export_grammar", options.export_grammar_path,
+                             export_grammar_if_requested);
             } catch (const std::exception& ex) {
                 std::cerr << "Warning: " << ex.what() << std::endl;
             }
@@ -455,6 +1420,26 @@ int main(int argc, char* argv[]) {
             std::cerr << "Warning: " << ex.what() << std::endl;
         }
 
+        std::cout << "\nStages" << std::endl;
+        std::cout << "======" << std::endl;
+        for (const auto& stage : stages) {
+            print_stage(stage);
+        }
+        for (const auto& result : evaluation_results) {
+            for (const auto& stage : result.metrics.stages) {
+                print_stage(stage, result.source_path);
+            }
+        }
+
+        if (!options.metrics_json_path.empty()) {
+            try {
+                write_metrics_json(options.metrics_json_path, options, sample_count, train_count,
+                                   states_before, states_after, stages, evaluation_results);
+            } catch (const std::exception& ex) {
+                std::cerr << "Warning: " << ex.what() << std::endl;
+            }
+        }
+
         return 0;
     } catch (const std::exception& ex) {
         std::cerr << "Error: " << ex.what() << std::endl;
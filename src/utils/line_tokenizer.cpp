@@ -0,0 +1,237 @@
+#include "utils/line_tokenizer.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+// Vector width for the delimiter scanner. AVX2 is only used when the build
+// enables it (e.g. `make NATIVE=1`); SSE2 is always available on x86-64.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AUTOMATA_SIMD_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AUTOMATA_SIMD_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AUTOMATA_SIMD_NEON 1
+#endif
+
+namespace automata_security {
+namespace {
+
+// Same set as std::isspace in the "C" locale, without the per-call locale
+// lookup; this runs twice per field.
+inline bool is_space(char ch) {
+    return ch == ' ' || (ch >= '\t' && ch <= '\r');
+}
+
+std::string_view trim_view(std::string_view value) {
+    std::size_t begin = 0;
+    std::size_t end = value.size();
+    while (begin < end && is_space(value[begin])) {
+        ++begin;
+    }
+    while (end > begin && is_space(value[end - 1])) {
+        --end;
+    }
+    return value.substr(begin, end - begin);
+}
+
+#if defined(AUTOMATA_SIMD_AVX2) || defined(AUTOMATA_SIMD_SSE2) || defined(AUTOMATA_SIMD_NEON)
+
+// One block of bytes compared against the delimiter and the quote character.
+// `delimiters` has kBitsPerByte bits per input byte (all set on a match).
+struct BlockMasks {
+    std::uint64_t delimiters;
+    bool has_quote;
+};
+
+#if defined(AUTOMATA_SIMD_AVX2)
+constexpr std::size_t kBlockBytes = 32;
+constexpr unsigned kBitsPerByte = 1;
+
+inline BlockMasks scan_block(const char* data, char delimiter) {
+    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    const __m256i delim = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(delimiter));
+    const __m256i quote = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('"'));
+    return {static_cast<std::uint32_t>(_mm256_movemask_epi8(delim)),
+            _mm256_movemask_epi8(quote) != 0};
+}
+#elif defined(AUTOMATA_SIMD_SSE2)
+constexpr std::size_t kBlockBytes = 16;
+constexpr unsigned kBitsPerByte = 1;
+
+inline BlockMasks scan_block(const char* data, char delimiter) {
+    const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    const __m128i delim = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(delimiter));
+    const __m128i quote = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('"'));
+    return {static_cast<std::uint32_t>(_mm_movemask_epi8(delim)),
+            _mm_movemask_epi8(quote) != 0};
+}
+#else
+constexpr std::size_t kBlockBytes = 16;
+constexpr unsigned kBitsPerByte = 4;
+
+// NEON has no movemask; narrowing the 16-bit lanes by 4 packs the comparison
+// into a 64-bit value with one nibble per byte.
+inline BlockMasks scan_block(const char* data, char delimiter) {
+    const uint8x16_t bytes = vld1q_u8(reinterpret_cast<const std::uint8_t*>(data));
+    const uint8x16_t delim = vceqq_u8(bytes, vdupq_n_u8(static_cast<std::uint8_t>(delimiter)));
+    const uint8x16_t quote = vceqq_u8(bytes, vdupq_n_u8(static_cast<std::uint8_t>('"')));
+    const uint8x8_t delim_nibbles = vshrn_n_u16(vreinterpretq_u16_u8(delim), 4);
+    return {vget_lane_u64(vreinterpret_u64_u8(delim_nibbles), 0), vmaxvq_u8(quote) != 0};
+}
+#endif
+
+inline unsigned lowest_set_bit(std::uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+    unsigned index = 0;
+    while ((mask & 1U) == 0) {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+#endif
+}
+
+// Vectorized splitter for lines without any quote character, which is the
+// common case for IoT-23 rows. Scans kBlockBytes at a time for the delimiter
+// and emits a field per set mask bit. Returns false as soon as a quote is
+// seen; the caller then reruns the line through the scalar state machine.
+bool split_unquoted(std::string_view line, char delimiter, std::vector<std::string_view>& fields) {
+    const char* const base = line.data();
+    const std::size_t size = line.size();
+    std::size_t field_start = 0;
+    std::size_t offset = 0;
+
+    for (; offset + kBlockBytes <= size; offset += kBlockBytes) {
+        BlockMasks block = scan_block(base + offset, delimiter);
+        if (block.has_quote) {
+            return false;
+        }
+        while (block.delimiters != 0) {
+            const std::size_t position = offset + lowest_set_bit(block.delimiters) / kBitsPerByte;
+            fields.push_back(trim_view(std::string_view(base + field_start, position - field_start)));
+            field_start = position + 1;
+            // Clear the bits of the matched byte.
+            block.delimiters &= ~(((std::uint64_t{1} << kBitsPerByte) - 1)
+                                  << ((position - offset) * kBitsPerByte));
+        }
+    }
+
+    for (; offset < size; ++offset) {
+        const char ch = base[offset];
+        if (ch == '"') {
+            return false;
+        }
+        if (ch == delimiter) {
+            fields.push_back(trim_view(std::string_view(base + field_start, offset - field_start)));
+            field_start = offset + 1;
+        }
+    }
+
+    fields.push_back(trim_view(std::string_view(base + field_start, size - field_start)));
+    return true;
+}
+
+#else
+
+// No vector unit available: let the scalar splitter handle every line.
+bool split_unquoted(std::string_view, char, std::vector<std::string_view>&) {
+    return false;
+}
+
+#endif
+
+}  // namespace
+
+bool LineCursor::next(std::string_view& line) {
+    if (pos_ >= text_.size()) {
+        return false;
+    }
+    const char* start = text_.data() + pos_;
+    const std::size_t remaining = text_.size() - pos_;
+    const auto* newline = static_cast<const char*>(std::memchr(start, '\n', remaining));
+    if (newline == nullptr) {
+        line = std::string_view(start, remaining);
+        pos_ = text_.size();
+    } else {
+        const auto length = static_cast<std::size_t>(newline - start);
+        line = std::string_view(start, length);
+        pos_ += length + 1;
+    }
+    return true;
+}
+
+void split_fields(std::string_view line,
+                  char delimiter,
+                  std::vector<std::string_view>& fields,
+                  std::string& scratch) {
+    fields.clear();
+    if (split_unquoted(line, delimiter, fields)) {
+        return;
+    }
+    split_fields_scalar(line, delimiter, fields, scratch);
+}
+
+void split_fields_scalar(std::string_view line,
+                         char delimiter,
+                         std::vector<std::string_view>& fields,
+                         std::string& scratch) {
+    fields.clear();
+    scratch.clear();
+    // Unescaped output never exceeds the input line, so reserving its length
+    // up front guarantees views into `scratch` are not invalidated by growth.
+    scratch.reserve(line.size());
+
+    const char* const end = line.data() + line.size();
+    const char* field_start = line.data();
+
+    while (true) {
+        // Fast path: scan to the next delimiter or quote. Fields without any
+        // quote character are returned as slices of the input.
+        const char* cursor = field_start;
+        while (cursor != end && *cursor != delimiter && *cursor != '"') {
+            ++cursor;
+        }
+        if (cursor == end || *cursor == delimiter) {
+            fields.push_back(trim_view(std::string_view(field_start, static_cast<std::size_t>(cursor - field_start))));
+            if (cursor == end) {
+                break;
+            }
+            field_start = cursor + 1;
+            continue;
+        }
+
+        // Slow path: the field contains a quote. Copy what we skipped so far
+        // and run the byte-at-a-time quoting state machine to the end of the
+        // field, writing the unescaped value into `scratch`.
+        const std::size_t begin = scratch.size();
+        scratch.append(field_start, cursor);
+        bool in_quotes = false;
+        for (; cursor != end; ++cursor) {
+            const char ch = *cursor;
+            if (ch == '"') {
+                if (in_quotes && cursor + 1 != end && cursor[1] == '"') {
+                    scratch.push_back('"');
+                    ++cursor;
+                } else {
+                    in_quotes = !in_quotes;
+                }
+            } else if (ch == delimiter && !in_quotes) {
+                break;
+            } else {
+                scratch.push_back(ch);
+            }
+        }
+        fields.push_back(trim_view(std::string_view(scratch.data() + begin, scratch.size() - begin)));
+        if (cursor == end) {
+            break;
+        }
+        field_start = cursor + 1;
+    }
+}
+
+}  // namespace automata_security
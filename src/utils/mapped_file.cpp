@@ -0,0 +1,212 @@
+#include "utils/mapped_file.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace automata_security {
+namespace {
+
+// Bytes requested per read when a file has to be read rather than mapped.
+constexpr std::size_t kReadChunkBytes = 1 << 20;
+
+// Read everything `read_chunk(buffer, capacity)` returns until it gives 0
+// bytes; it returns a negative count on error.
+template <typename ReadChunk>
+std::vector<char> read_to_end(ReadChunk&& read_chunk, const std::string& path) {
+    std::vector<char> contents;
+    std::size_t size = 0;
+    for (;;) {
+        contents.resize(size + kReadChunkBytes);
+        const long long read = read_chunk(contents.data() + size, kReadChunkBytes);
+        if (read < 0) {
+            throw std::runtime_error("Failed to read file: " + path);
+        }
+        if (read == 0) {
+            break;
+        }
+        size += static_cast<std::size_t>(read);
+    }
+    contents.resize(size);
+    contents.shrink_to_fit();
+    return contents;
+}
+
+}  // namespace
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    file_handle_ = file;
+
+    if (GetFileType(file) != FILE_TYPE_DISK) {
+        // Pipes cannot be mapped; read them instead.
+        buffer_ = read_to_end(
+            [file](char* out, std::size_t capacity) -> long long {
+                DWORD read = 0;
+                if (!ReadFile(file, out, static_cast<DWORD>(capacity), &read, nullptr)) {
+                    // The writer closing a pipe ends it.
+                    return GetLastError() == ERROR_BROKEN_PIPE ? 0 : -1;
+                }
+                return read;
+            },
+            path);
+        CloseHandle(file);
+        file_handle_ = nullptr;
+        size_ = buffer_.size();
+        data_ = buffer_.empty() ? nullptr : buffer_.data();
+        return;
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        release();
+        throw std::runtime_error("Failed to stat file: " + path);
+    }
+    size_ = static_cast<std::size_t>(file_size.QuadPart);
+    if (size_ == 0) {
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        release();
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+    mapping_handle_ = mapping;
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        release();
+        throw std::runtime_error("Failed to map file: " + path);
+    }
+    data_ = static_cast<const char*>(view);
+}
+
+void MappedFile::release() noexcept {
+    if (data_ != nullptr && buffer_.empty()) {
+        UnmapViewOfFile(data_);
+    }
+    buffer_.clear();
+    if (mapping_handle_ != nullptr) {
+        CloseHandle(static_cast<HANDLE>(mapping_handle_));
+    }
+    if (file_handle_ != nullptr) {
+        CloseHandle(static_cast<HANDLE>(file_handle_));
+    }
+    data_ = nullptr;
+    size_ = 0;
+    mapping_handle_ = nullptr;
+    file_handle_ = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to stat file: " + path);
+    }
+    if (!S_ISREG(info.st_mode)) {
+        // Pipes, FIFOs and devices cannot be mapped (or report no size); read
+        // them instead.
+        try {
+            buffer_ = read_to_end(
+                [fd](char* out, std::size_t capacity) -> long long {
+                    ssize_t read = 0;
+                    do {
+                        read = ::read(fd, out, capacity);
+                    } while (read < 0 && errno == EINTR);
+                    return read;
+                },
+                path);
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+        size_ = buffer_.size();
+        data_ = buffer_.empty() ? nullptr : buffer_.data();
+        return;
+    }
+
+    size_ = static_cast<std::size_t>(info.st_size);
+    if (size_ > 0) {
+        void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Failed to map file: " + path);
+        }
+        // Datasets are scanned front to back once; let the kernel read ahead.
+        ::madvise(mapped, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(mapped);
+    }
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+}
+
+void MappedFile::release() noexcept {
+    if (data_ != nullptr && buffer_.empty()) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+    buffer_.clear();
+    data_ = nullptr;
+    size_ = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      buffer_(std::move(other.buffer_))
+#ifdef _WIN32
+      ,
+      file_handle_(std::exchange(other.file_handle_, nullptr)),
+      mapping_handle_(std::exchange(other.mapping_handle_, nullptr))
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        release();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        buffer_ = std::move(other.buffer_);
+#ifdef _WIN32
+        file_handle_ = std::exchange(other.file_handle_, nullptr);
+        mapping_handle_ = std::exchange(other.mapping_handle_, nullptr);
+#endif
+    }
+    return *this;
+}
+
+}  // namespace automata_security
@@ -2,14 +2,25 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <future>
+#include <optional>
 #include <random>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <cassert>
 
+#include "utils/line_tokenizer.hpp"
+#include "utils/mapped_file.hpp"
+
 namespace automata_security {
 namespace {
 
@@ -70,27 +81,48 @@ std::unordered_map<std::string, std::size_t> header_index(
     return index;
 }
 
-std::string to_lower_copy(std::string value) {
-    std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) {
-        return static_cast<char>(std::tolower(c));
-    });
-    return value;
+bool equals_ignore_case(std::string_view value, std::string_view lowercase) {
+    if (value.size() != lowercase.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < value.size(); ++i) {
+        if (std::tolower(static_cast<unsigned char>(value[i])) != lowercase[i]) {
+            return false;
+        }
+    }
+    return true;
 }
 
-bool is_true_label(const std::string& value) {
-    auto lowercase = to_lower_copy(value);
-    if (lowercase == "1" || lowercase == "true" || lowercase == "malware") {
+bool contains_ignore_case(std::string_view value, std::string_view lowercase) {
+    if (lowercase.size() > value.size()) {
+        return false;
+    }
+    for (std::size_t start = 0; start + lowercase.size() <= value.size(); ++start) {
+        if (equals_ignore_case(value.substr(start, lowercase.size()), lowercase)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Case-insensitive label check that works on views so rows can be labelled
+// without copying the field.
+bool is_true_label(std::string_view value) {
+    if (equals_ignore_case(value, "1") || equals_ignore_case(value, "true") ||
+        equals_ignore_case(value, "malware")) {
         return true;
     }
-    if (lowercase == "0" || lowercase == "false" || lowercase == "benign") {
+    if (equals_ignore_case(value, "0") || equals_ignore_case(value, "false") ||
+        equals_ignore_case(value, "benign")) {
         return false;
     }
-    return lowercase.find("malic") != std::string::npos;
+    return contains_ignore_case(value, "malic");
 }
 
 }  // namespace
 
-std::vector<LabeledSequence> Parser::load_malware_csv(const std::string& path) {
+std::vector<LabeledSequence> Parser::load_malware_csv(const std::string& path,
+                                                      SymbolTable& symbols) {
     std::ifstream input(path);
     if (!input.is_open()) {
         throw std::runtime_error("Failed to open malware dataset: " + path);
@@ -106,10 +138,12 @@ std::vector<LabeledSequence> Parser::load_malware_csv(const std::string& path) {
     auto header = parse_delimited_line(line);
     auto index = header_index(header);
 
+#ifndef NDEBUG
         // sanity: header index entries should be within header size
         for (const auto& p : index) {
             assert(p.second < header.size());
         }
+#endif
     auto id_it = index.find("hash");
     auto label_it = index.find("malware");
 
@@ -149,7 +183,7 @@ std::vector<LabeledSequence> Parser::load_malware_csv(const std::string& path) {
             if (col < tokens.size()) {
                 const auto& value = tokens[col];
                 if (!value.empty()) {
-                    sample.symbols.push_back(value);
+                    sample.symbols.push_back(symbols.intern(value));
                 }
             }
         }
@@ -163,30 +197,27 @@ std::vector<LabeledSequence> Parser::load_malware_csv(const std::string& path) {
     return samples;
 }
 
-std::vector<LabeledSequence> Parser::load_iot_csv(const std::string& path) {
-    std::ifstream input(path);
-    if (!input.is_open()) {
-        throw std::runtime_error("Failed to open IoT dataset: " + path);
-    }
-
-    std::string line;
-    while (std::getline(input, line)) {
-        if (!line.empty() && line[0] == '#') {
-            continue;
-        }
-        if (!line.empty()) {
-            break;
-        }
-    }
-
-    if (line.empty()) {
-        return {};
-    }
+namespace {
 
-    // Detect delimiter: some datasets use '|' while others use ','. We
-    // inspect the header line to choose an appropriate separator for parsing.
-    char delimiter = line.find('|') != std::string::npos ? '|' : ',';
-    auto header = parse_delimited_line(line, delimiter);
+// Column layout of an IoT-23 / Zeek conn.log header. Columns that are absent
+// from the header are set to `header_size`, which every bounds check treats
+// as missing.
+struct IotColumns {
+    std::size_t header_size{0};
+    std::size_t label{0};
+    std::size_t proto{0};
+    std::size_t conn_state{0};
+    std::size_t service{0};
+    std::size_t id_orig_h{0};
+    std::size_t id_resp_h{0};
+    std::size_t uid{0};
+    std::size_t ts{0};
+    std::size_t duration{0};
+    std::size_t orig_bytes{0};
+    std::size_t resp_bytes{0};
+};
+
+IotColumns iot_columns(const std::vector<std::string>& header) {
     auto index = header_index(header);
 
     auto label_it = index.find("label");
@@ -196,74 +227,230 @@ std::vector<LabeledSequence> Parser::load_iot_csv(const std::string& path) {
 
     assert(label_it->second < header.size());
 
-    std::size_t detailed_label_col = index.count("detailed-label")
-                                         ? index["detailed-label"]
-                                         : header.size();
-
-    std::size_t proto_col = index.count("proto") ? index["proto"] : header.size();
-    std::size_t conn_state_col = index.count("conn_state") ? index["conn_state"] : header.size();
-    std::size_t service_col = index.count("service") ? index["service"] : header.size();
-    std::size_t id_orig_h_col = index.count("id.orig_h") ? index["id.orig_h"] : header.size();
-    std::size_t id_resp_h_col = index.count("id.resp_h") ? index["id.resp_h"] : header.size();
-    std::size_t uid_col = index.count("uid") ? index["uid"] : header.size();
-    std::size_t ts_col = index.count("ts") ? index["ts"] : header.size();
+    // The `detailed-label` column is deliberately not projected: it is a second
+    // label column and must not leak into the alphabet.
+    auto column = [&](const char* name) {
+        auto it = index.find(name);
+        return it != index.end() ? it->second : header.size();
+    };
+
+    IotColumns columns;
+    columns.header_size = header.size();
+    columns.label = label_it->second;
+    columns.proto = column("proto");
+    columns.conn_state = column("conn_state");
+    columns.service = column("service");
+    columns.id_orig_h = column("id.orig_h");
+    columns.id_resp_h = column("id.resp_h");
+    columns.uid = column("uid");
+    columns.ts = column("ts");
+    columns.duration = column("duration");
+    columns.orig_bytes = column("orig_bytes");
+    columns.resp_bytes = column("resp_bytes");
+    return columns;
+}
 
-    std::vector<LabeledSequence> samples;
-    std::size_t line_number = 1;  // include header
-    while (std::getline(input, line)) {
-        ++line_number;
+// Where the rows of an IoT CSV start and how to split them. The header is the
+// first non-empty line that is not a '#' comment.
+struct IotLayout {
+    bool has_header{false};
+    char delimiter{','};
+    IotColumns columns;
+    // Byte offset of the line after the header.
+    std::size_t body_offset{0};
+};
+
+IotLayout read_iot_layout(std::string_view text) {
+    IotLayout layout;
+    LineCursor lines(text);
+    std::string_view line;
+    while (lines.next(line)) {
         if (line.empty() || line[0] == '#') {
             continue;
         }
 
-    // Tokenize the row using the detected delimiter. Supports quoted fields
-    // so embedded delimiters or quotes are handled safely.
-    auto tokens = parse_delimited_line(line, delimiter);
-        if (tokens.size() <= label_it->second) {
-            // malformed row; skip
-            continue;
-        }
+        // Detect delimiter: some datasets use '|' while others use ','. We
+        // inspect the header line to choose an appropriate separator for parsing.
+        layout.delimiter = line.find('|') != std::string_view::npos ? '|' : ',';
+        layout.columns = iot_columns(parse_delimited_line(std::string(line), layout.delimiter));
+        layout.has_header = true;
+        layout.body_offset = lines.offset();
+        break;
+    }
+    return layout;
+}
 
-        LabeledSequence sample;
-        sample.id = "iot_line_" + std::to_string(line_number);
-        if (id_orig_h_col < tokens.size()) {
-            sample.host = tokens[id_orig_h_col];
+// Buckets of the discretized row features. A value takes the name of the
+// last bound it reaches (the first bucket also takes anything below it), so
+// each bucket spans one decade.
+struct FeatureBucket {
+    double bound;
+    const char* name;
+};
+
+constexpr FeatureBucket kDurationBuckets[] = {
+    {0.0, "0"},  {0.001, "1ms"}, {0.01, "10ms"}, {0.1, "100ms"},
+    {1.0, "1s"}, {10.0, "10s"},  {100.0, "100s"}, {1000.0, "1000s"},
+};
+
+constexpr FeatureBucket kByteBuckets[] = {
+    {0.0, "0"},      {1.0, "1"},      {10.0, "10"},   {100.0, "100"}, {1e3, "1k"},
+    {1e4, "10k"},    {1e5, "100k"},   {1e6, "1M"},    {1e7, "10M"},   {1e8, "100M"},
+};
+
+MappedFile open_dataset(const std::string& path) {
+    try {
+        return MappedFile(path);
+    } catch (const std::exception& ex) {
+        throw std::runtime_error("Failed to open IoT dataset: " + path + " (" + ex.what() + ")");
+    }
+}
+
+// Reads the rows in `body`, a run of whole lines from an IoT CSV's body (all
+// of it, or one newline-aligned range of it). Rows are split into string_view
+// fields pointing into the buffer, so the only bytes copied per row are the
+// symbols (and metadata) that are kept. The buffer must outlive the reader.
+class IotReader {
+public:
+    // `line_number` is the file line number of the line just before `body`
+    // (1 for the header when reading a whole body); sample ids continue from it.
+    IotReader(std::string_view body,
+              const IotLayout& layout,
+              bool keep_metadata,
+              const SequenceOptions& sequences,
+              std::size_t line_number = 1)
+        : lines_(body),
+          keep_metadata_(keep_metadata),
+          duration_symbols_(sequences.duration_symbols),
+          byte_symbols_(sequences.byte_symbols),
+          has_header_(layout.has_header),
+          delimiter_(layout.delimiter),
+          columns_(layout.columns),
+          line_number_(line_number) {}
+
+    // Read the next usable row into `sample`, reusing its buffers. Returns
+    // false at end of input.
+    bool next(SymbolTable& symbols, LabeledSequence& sample) {
+        if (!has_header_) {
+            return false;
         }
-        if (id_resp_h_col < tokens.size()) {
-            sample.resp_host = tokens[id_resp_h_col];
+        std::string_view line;
+        while (lines_.next(line)) {
+            ++line_number_;
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            // Tokenize the row using the detected delimiter. Supports quoted fields
+            // so embedded delimiters or quotes are handled safely.
+            split_fields(line, delimiter_, fields_, scratch_);
+            if (fields_.size() <= columns_.label) {
+                // malformed row; skip
+                continue;
+            }
+            project(symbols, sample);
+            return true;
         }
-        if (uid_col < tokens.size()) {
-            sample.uid = tokens[uid_col];
+        return false;
+    }
+
+private:
+    LineCursor lines_;
+    bool keep_metadata_;
+    bool duration_symbols_;
+    bool byte_symbols_;
+    bool has_header_;
+    char delimiter_;
+    IotColumns columns_;
+    std::vector<std::string_view> fields_;
+    std::string scratch_;
+    // Reusable buffers for building `prefix + value` keys before interning
+    // and for number parsing, so we do not allocate per symbol.
+    std::string symbol_key_;
+    std::string number_buffer_;
+    std::size_t line_number_;
+
+    // Same result as std::stod on the field; false when it does not parse.
+    bool parse_number(std::string_view field, double& value) {
+        number_buffer_.assign(field.data(), field.size());
+        const char* begin = number_buffer_.c_str();
+        char* end = nullptr;
+        errno = 0;
+        value = std::strtod(begin, &end);
+        return end != begin && errno != ERANGE;
+    }
+
+    double parse_timestamp(std::string_view field) {
+        double value = 0.0;
+        return parse_number(field, value) ? value : 0.0;
+    }
+
+    void project(SymbolTable& symbols, LabeledSequence& sample) {
+        auto present = [&](std::size_t column) { return column < fields_.size(); };
+
+        sample.symbols.clear();
+        sample.ts = 0.0;
+        if (keep_metadata_) {
+            sample.id = "iot_line_" + std::to_string(line_number_);
+            auto copy = [&](std::size_t column, std::string& out) {
+                if (present(column)) {
+                    out.assign(fields_[column].data(), fields_[column].size());
+                } else {
+                    out.clear();
+                }
+            };
+            copy(columns_.id_orig_h, sample.host);
+            copy(columns_.id_resp_h, sample.resp_host);
+            copy(columns_.uid, sample.uid);
         }
-        if (ts_col < tokens.size()) {
-            try {
-                sample.ts = std::stod(tokens[ts_col]);
-            } catch (...) {
-                sample.ts = 0.0;
-            }
+        if (present(columns_.ts)) {
+            sample.ts = parse_timestamp(fields_[columns_.ts]);
         }
-        sample.label = is_true_label(tokens[label_it->second]);
+        sample.label = is_true_label(fields_[columns_.label]);
 
         // Helper to map a dataset column into a prefixed symbol token used by
         // the PTA/DFA pipeline. We prefix the raw column value (e.g. 'tcp')
         // with a short namespace like 'proto=' so that different features don't
-        // collide in the alphabet.
-        auto add_symbol = [&](std::size_t column, const std::string& prefix) {
-            if (column < tokens.size()) {
-                const auto& value = tokens[column];
+        // collide in the alphabet. The token is interned so the sequence only
+        // stores its integer id.
+        auto add_symbol = [&](std::size_t column, const char* prefix) {
+            if (present(column)) {
+                const auto value = fields_[column];
                 if (!value.empty() && value != "-") {
-                    sample.symbols.push_back(prefix + value);
+                    symbol_key_.assign(prefix);
+                    symbol_key_.append(value.data(), value.size());
+                    sample.symbols.push_back(symbols.intern(symbol_key_));
                 }
             }
         };
 
-        add_symbol(proto_col, "proto=");
-        add_symbol(conn_state_col, "state=");
-        add_symbol(service_col, "service=");
+        add_symbol(columns_.proto, "proto=");
+        add_symbol(columns_.conn_state, "state=");
+        add_symbol(columns_.service, "service=");
 
-        if (detailed_label_col < tokens.size()) {
-            // Ensure we do not leak the second label column as part of the alphabet.
-            // The value was already consumed for supervised labels above.
+        // Discretized numeric features: the bucket name stands in for the
+        // value, so the alphabet stays small.
+        auto add_bucket = [&](std::size_t column, const char* prefix, const auto& buckets) {
+            double value = 0.0;
+            if (!present(column) || !parse_number(fields_[column], value)) {
+                return;
+            }
+            const char* name = buckets[0].name;
+            for (const auto& bucket : buckets) {
+                if (value >= bucket.bound) {
+                    name = bucket.name;
+                }
+            }
+            symbol_key_.assign(prefix);
+            symbol_key_.append(name);
+            sample.symbols.push_back(symbols.intern(symbol_key_));
+        };
+        if (duration_symbols_) {
+            add_bucket(columns_.duration, "duration=", kDurationBuckets);
+        }
+        if (byte_symbols_) {
+            add_bucket(columns_.orig_bytes, "orig_bytes=", kByteBuckets);
+            add_bucket(columns_.resp_bytes, "resp_bytes=", kByteBuckets);
         }
 
         if (sample.symbols.empty()) {
@@ -271,15 +458,393 @@ std::vector<LabeledSequence> Parser::load_iot_csv(const std::string& path) {
             // so the sequence is not empty; this prevents dropping the sample in
             // later stages and makes it explicit that the sample had no
             // extractable features.
-            sample.symbols.push_back("symbol=unknown");
+            sample.symbols.push_back(symbols.intern("symbol=unknown"));
         }
+    }
+};
+
+}  // namespace
+
+std::vector<LabeledSequence> Parser::load_iot_csv(const std::string& path,
+                                                  SymbolTable& symbols,
+                                                  const SequenceOptions& sequences) {
+    const MappedFile file = open_dataset(path);
+    const IotLayout layout = read_iot_layout(file.view());
+    IotReader reader(file.view().substr(layout.body_offset), layout, /*keep_metadata=*/true, sequences);
 
+    std::vector<LabeledSequence> samples;
+    LabeledSequence sample;
+    if (sequences.grouped()) {
+        SequenceBuilder builder(sequences);
+        while (reader.next(symbols, sample)) {
+            builder.add(sample, samples);
+        }
+        builder.finish(samples);
+        return samples;
+    }
+    while (reader.next(symbols, sample)) {
         samples.push_back(std::move(sample));
+        sample = LabeledSequence{};
     }
 
     return samples;
 }
 
+std::size_t Parser::stream_iot_csv(const std::string& path,
+                                   SymbolTable& symbols,
+                                   const IotStreamOptions& options,
+                                   const SequenceBatchHandler& handler) {
+    if (options.batch_size == 0) {
+        throw std::invalid_argument("IoT stream batch size must be positive.");
+    }
+
+    const MappedFile file = open_dataset(path);
+    const IotLayout layout = read_iot_layout(file.view());
+    const SequenceOptions& sequences = options.sequences;
+    IotReader reader(file.view().substr(layout.body_offset), layout,
+                     options.keep_metadata || sequences.grouped(), sequences);
+
+    if (sequences.grouped()) {
+        // Windows come out of the builder as their last row is read; hand
+        // them over whenever a batch worth has collected.
+        SequenceBuilder builder(sequences);
+        std::vector<LabeledSequence> batch;
+        batch.reserve(options.batch_size);
+        LabeledSequence row;
+        std::size_t total = 0;
+        while (reader.next(symbols, row)) {
+            builder.add(row, batch);
+            if (batch.size() >= options.batch_size) {
+                total += batch.size();
+                handler(batch);
+                batch.clear();
+            }
+        }
+        // finish() can complete many windows at once; keep batches to size.
+        builder.finish(batch);
+        std::vector<LabeledSequence> slice;
+        for (std::size_t begin = 0; begin < batch.size(); begin += options.batch_size) {
+            const std::size_t end = std::min(batch.size(), begin + options.batch_size);
+            slice.assign(std::make_move_iterator(batch.begin() + static_cast<std::ptrdiff_t>(begin)),
+                         std::make_move_iterator(batch.begin() + static_cast<std::ptrdiff_t>(end)));
+            total += slice.size();
+            handler(slice);
+        }
+        return total;
+    }
+
+    // The batch is recycled across calls: full batches keep their element
+    // objects (and the capacity of their symbol vectors), so steady-state
+    // streaming allocates almost nothing per row.
+    std::vector<LabeledSequence> batch(options.batch_size);
+    std::size_t filled = 0;
+    std::size_t total = 0;
+
+    while (reader.next(symbols, batch[filled])) {
+        ++total;
+        if (++filled == batch.size()) {
+            handler(batch);
+            filled = 0;
+        }
+    }
+
+    if (filled > 0) {
+        batch.resize(filled);
+        handler(batch);
+    }
+
+    return total;
+}
+
+namespace {
+
+// Bodies smaller than this are not split further; below it the per-chunk
+// symbol remapping costs more than the parallelism saves.
+constexpr std::size_t kMinChunkBytes = std::size_t{1} << 20;
+// Ranges per worker a grouped load parses ahead of the one the sequence
+// builder is reading.
+constexpr std::size_t kGroupedChunksPerWorker = 2;
+
+// One newline-aligned byte range of one file's body, parsed on its own with a
+// private symbol table.
+struct IotChunk {
+    std::size_t file{0};
+    std::string_view body;
+    std::size_t line_number{1};
+    SymbolTable symbols;
+    std::vector<LabeledSequence> samples;
+};
+
+std::size_t count_newlines(std::string_view text) {
+    std::size_t count = 0;
+    const char* cursor = text.data();
+    const char* const end = text.data() + text.size();
+    while (cursor != end) {
+        const auto* newline =
+            static_cast<const char*>(std::memchr(cursor, '\n', static_cast<std::size_t>(end - cursor)));
+        if (newline == nullptr) {
+            break;
+        }
+        ++count;
+        cursor = newline + 1;
+    }
+    return count;
+}
+
+// Split `body` into at most `parts` ranges that each end just after a '\n'
+// (or at the end of the body), appending them to `chunks`.
+void split_body(std::size_t file,
+                std::string_view body,
+                std::size_t parts,
+                std::vector<IotChunk>& chunks) {
+    std::size_t begin = 0;
+    for (std::size_t part = 1; part <= parts && begin < body.size(); ++part) {
+        std::size_t end = body.size();
+        if (part < parts) {
+            end = std::max(begin, body.size() / parts * part);
+            const auto newline = body.find('\n', end);
+            end = newline == std::string_view::npos ? body.size() : newline + 1;
+        }
+        IotChunk chunk;
+        chunk.file = file;
+        chunk.body = body.substr(begin, end - begin);
+        chunks.push_back(std::move(chunk));
+        begin = end;
+    }
+}
+
+}  // namespace
+
+std::vector<std::vector<LabeledSequence>> Parser::load_iot_csv_parallel(
+    const std::vector<std::string>& paths,
+    SymbolTable& symbols,
+    ThreadPool& pool,
+    const SequenceOptions& sequences) {
+    // Map every file up front so open errors surface in path order, as they
+    // would with sequential loads.
+    std::vector<MappedFile> files;
+    std::vector<IotLayout> layouts;
+    files.reserve(paths.size());
+    layouts.reserve(paths.size());
+    for (const auto& path : paths) {
+        files.push_back(open_dataset(path));
+        layouts.push_back(read_iot_layout(files.back().view()));
+    }
+
+    // Flatten (file, range) pairs into one task list so the pool never waits
+    // on itself. With one worker an ungrouped file stays a single range.
+    std::vector<IotChunk> chunks;
+    for (std::size_t file = 0; file < files.size(); ++file) {
+        if (!layouts[file].has_header) {
+            continue;
+        }
+        const auto body = files[file].view().substr(layouts[file].body_offset);
+        std::size_t parts = 1;
+        if (pool.size() > 1) {
+            parts = std::clamp<std::size_t>(body.size() / kMinChunkBytes, 1, pool.size());
+        }
+        if (sequences.grouped()) {
+            // Grouped loads hold only a few parsed ranges at a time, so the
+            // ranges stay small whatever the pool size.
+            parts = std::max(parts, (body.size() + kMinChunkBytes - 1) / kMinChunkBytes);
+        }
+        split_body(file, body, parts, chunks);
+    }
+
+    // Sample ids carry the file line number, so each range needs the number
+    // of lines before it. Counting newlines is far cheaper than parsing.
+    std::vector<std::size_t> newlines(chunks.size());
+    pool.parallel_for(chunks.size(), [&](std::size_t i) {
+        newlines[i] = count_newlines(chunks[i].body);
+    });
+    for (std::size_t i = 1; i < chunks.size(); ++i) {
+        if (chunks[i].file == chunks[i - 1].file) {
+            chunks[i].line_number = chunks[i - 1].line_number + newlines[i - 1];
+        }
+    }
+
+    // Samples already in `chunk.samples` (a recycled vector) are overwritten
+    // before new ones are added.
+    auto parse = [&](IotChunk& chunk) {
+        IotReader reader(chunk.body, layouts[chunk.file], /*keep_metadata=*/true, sequences,
+                         chunk.line_number);
+        auto& samples = chunk.samples;
+        std::size_t filled = 0;
+        for (;; ++filled) {
+            if (filled == samples.size()) {
+                samples.emplace_back();
+            }
+            if (!reader.next(chunk.symbols, samples[filled])) {
+                break;
+            }
+        }
+        samples.resize(filled);
+    };
+    // Interning each chunk's names in chunk order reproduces the first-seen
+    // order of a sequential load, so the shared table gets identical ids.
+    auto intern_names = [&](const IotChunk& chunk) {
+        std::vector<SymbolId> remap;
+        remap.reserve(chunk.symbols.size());
+        for (std::size_t id = 0; id < chunk.symbols.size(); ++id) {
+            remap.push_back(symbols.intern(chunk.symbols.name(static_cast<SymbolId>(id))));
+        }
+        return remap;
+    };
+
+    std::vector<std::vector<LabeledSequence>> results(paths.size());
+    if (sequences.grouped()) {
+        // Rows reach their file's builder chunk by chunk, in order, while
+        // the next chunks are parsed; once the builder has read a chunk, its
+        // sample vector goes to the next chunk submitted, so only the chunks
+        // in flight are held (and the allocator sees the same blocks reused
+        // instead of fresh ones around the windows emitted meanwhile).
+        const std::size_t ahead = kGroupedChunksPerWorker * pool.size();
+        std::deque<std::future<void>> parsing;
+        std::size_t submitted = 0;
+        std::vector<LabeledSequence> spare;
+        try {
+            std::optional<SequenceBuilder> builder;
+            std::size_t builder_file = 0;
+            for (std::size_t i = 0; i < chunks.size(); ++i) {
+                while (submitted < chunks.size() && submitted <= i + ahead) {
+                    IotChunk& next = chunks[submitted++];
+                    next.samples = std::move(spare);
+                    spare.clear();
+                    parsing.push_back(pool.submit([&parse, &next]() { parse(next); }));
+                }
+                parsing.front().get();
+                parsing.pop_front();
+
+                IotChunk& chunk = chunks[i];
+                const auto remap = intern_names(chunk);
+                if (!builder || builder_file != chunk.file) {
+                    if (builder) {
+                        builder->finish(results[builder_file]);
+                    }
+                    builder.emplace(sequences);
+                    builder_file = chunk.file;
+                }
+                for (auto& row : chunk.samples) {
+                    for (auto& symbol : row.symbols) {
+                        symbol = remap[symbol];
+                    }
+                    builder->add(row, results[chunk.file]);
+                }
+                spare = std::move(chunk.samples);
+                chunk.samples.clear();
+                chunk.symbols = SymbolTable{};
+            }
+            if (builder) {
+                builder->finish(results[builder_file]);
+            }
+        } catch (...) {
+            // Parse tasks still running point into `chunks`.
+            for (auto& pending : parsing) {
+                pending.wait();
+            }
+            throw;
+        }
+        return results;
+    }
+
+    pool.parallel_for(chunks.size(), [&](std::size_t i) { parse(chunks[i]); });
+
+    std::vector<std::vector<SymbolId>> remaps(chunks.size());
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        remaps[i] = intern_names(chunks[i]);
+    }
+    pool.parallel_for(chunks.size(), [&](std::size_t i) {
+        const auto& remap = remaps[i];
+        for (auto& sample : chunks[i].samples) {
+            for (auto& symbol : sample.symbols) {
+                symbol = remap[symbol];
+            }
+        }
+    });
+
+    for (auto& chunk : chunks) {
+        auto& out = results[chunk.file];
+        if (out.empty()) {
+            out = std::move(chunk.samples);
+        } else {
+            out.insert(out.end(),
+                       std::make_move_iterator(chunk.samples.begin()),
+                       std::make_move_iterator(chunk.samples.end()));
+        }
+    }
+    return results;
+}
+
+namespace {
+
+std::vector<WeightedSequence> deduplicate_into(const std::vector<LabeledSequence>& data,
+                                               std::vector<std::uint32_t>* record_of) {
+    struct SequenceHash {
+        std::size_t operator()(const std::vector<SymbolId>& symbols) const {
+            std::uint64_t hash = 0xcbf29ce484222325ULL;
+            for (const auto symbol : symbols) {
+                hash = (hash ^ symbol) * 0x100000001b3ULL;
+            }
+            return static_cast<std::size_t>(hash ^ (hash >> 32));
+        }
+    };
+
+    std::vector<WeightedSequence> records;
+    std::unordered_map<std::vector<SymbolId>, std::size_t, SequenceHash> index;
+    if (record_of != nullptr) {
+        record_of->resize(data.size());
+    }
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        const auto& sample = data[i];
+        auto it = index.find(sample.symbols);
+        if (it == index.end()) {
+            it = index.emplace(sample.symbols, records.size()).first;
+            records.push_back({sample.symbols, 0, 0});
+        }
+        if (record_of != nullptr) {
+            (*record_of)[i] = static_cast<std::uint32_t>(it->second);
+        }
+        auto& record = records[it->second];
+        if (sample.label) {
+            ++record.positive_count;
+        } else {
+            ++record.negative_count;
+        }
+    }
+    return records;
+}
+
+}  // namespace
+
+std::vector<WeightedSequence> deduplicate(const std::vector<LabeledSequence>& data) {
+    return deduplicate_into(data, nullptr);
+}
+
+std::vector<WeightedSequence> deduplicate(const std::vector<LabeledSequence>& data,
+                                          std::vector<std::uint32_t>& record_of) {
+    return deduplicate_into(data, &record_of);
+}
+
+std::vector<std::size_t> shuffled_order(std::size_t size, unsigned int seed) {
+    std::vector<std::size_t> order(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        order[i] = i;
+    }
+    std::mt19937 gen(seed);
+    std::shuffle(order.begin(), order.end(), gen);
+    return order;
+}
+
+std::size_t train_split_size(std::size_t size, double train_ratio) {
+    std::size_t train_count = static_cast<std::size_t>(size * train_ratio);
+    if (train_count == 0) {
+        train_count = 1;
+    } else if (train_count == size) {
+        train_count = size - 1;
+    }
+    return train_count;
+}
+
 DatasetSplit train_test_split(const std::vector<LabeledSequence>& data,
                               double train_ratio,
                               unsigned int seed) {
@@ -290,20 +855,15 @@ DatasetSplit train_test_split(const std::vector<LabeledSequence>& data,
         return {};
     }
 
-    std::vector<LabeledSequence> shuffled = data;
-    std::mt19937 gen(seed);
-    std::shuffle(shuffled.begin(), shuffled.end(), gen);
-
-    std::size_t train_count = static_cast<std::size_t>(shuffled.size() * train_ratio);
-    if (train_count == 0) {
-        train_count = 1;
-    } else if (train_count == shuffled.size()) {
-        train_count = shuffled.size() - 1;
-    }
+    const auto order = shuffled_order(data.size(), seed);
+    const std::size_t train_count = train_split_size(data.size(), train_ratio);
 
     DatasetSplit split;
-    split.train.insert(split.train.end(), shuffled.begin(), shuffled.begin() + train_count);
-    split.test.insert(split.test.end(), shuffled.begin() + train_count, shuffled.end());
+    split.train.reserve(train_count);
+    split.test.reserve(data.size() - train_count);
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        (i < train_count ? split.train : split.test).push_back(data[order[i]]);
+    }
     return split;
 }
 
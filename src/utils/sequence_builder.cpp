@@ -0,0 +1,156 @@
+#include "utils/sequence_builder.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace automata_security {
+namespace {
+
+template <typename Buffered>
+bool later(const Buffered& a, const Buffered& b) {
+    return a.ts != b.ts ? a.ts > b.ts : a.order > b.order;
+}
+
+}  // namespace
+
+std::string sequence_flags(const SequenceOptions& options) {
+    std::string flags;
+    if (options.grouped()) {
+        const bool sliding = options.window == SequenceOptions::Window::kSliding;
+        flags += options.group_by == SequenceOptions::GroupBy::kHost ? "--group-by=host" : "--group-by=uid";
+        flags += sliding ? " --window=sliding" : " --window=tumbling";
+        flags += " --window-rows=" + std::to_string(options.window_rows);
+        if (sliding) {
+            flags += " --window-stride=" + std::to_string(options.stride);
+        }
+    }
+    if (options.duration_symbols || options.byte_symbols) {
+        flags += flags.empty() ? "--features=" : " --features=";
+        flags += options.duration_symbols && options.byte_symbols ? "duration,bytes"
+                 : options.duration_symbols                       ? "duration"
+                                                                  : "bytes";
+    }
+    return flags;
+}
+
+SequenceBuilder::SequenceBuilder(const SequenceOptions& options) : options_(options) {
+    if (options_.window_rows == 0) {
+        throw std::invalid_argument("Sequence window must hold at least one row.");
+    }
+    if (options_.stride == 0) {
+        throw std::invalid_argument("Sliding window stride must be positive.");
+    }
+    if (options_.max_groups == 0) {
+        throw std::invalid_argument("Sequence builder needs room for at least one group.");
+    }
+}
+
+void SequenceBuilder::add(LabeledSequence& row, std::vector<LabeledSequence>& out) {
+    if (options_.reorder_rows == 0) {
+        dispatch(row, out);
+        return;
+    }
+    auto by_ts = [](const Buffered& a, const Buffered& b) { return later(a, b); };
+    reorder_.push_back({row.ts, arrivals_++, std::move(row)});
+    std::push_heap(reorder_.begin(), reorder_.end(), by_ts);
+    if (reorder_.size() > options_.reorder_rows) {
+        std::pop_heap(reorder_.begin(), reorder_.end(), by_ts);
+        dispatch(reorder_.back().row, out);
+        reorder_.pop_back();
+    }
+}
+
+void SequenceBuilder::finish(std::vector<LabeledSequence>& out) {
+    auto by_ts = [](const Buffered& a, const Buffered& b) { return later(a, b); };
+    while (!reorder_.empty()) {
+        std::pop_heap(reorder_.begin(), reorder_.end(), by_ts);
+        dispatch(reorder_.back().row, out);
+        reorder_.pop_back();
+    }
+    while (!recency_.empty()) {
+        const auto it = groups_.find(recency_.back());
+        flush(it->first, it->second, out);
+        groups_.erase(it);
+        recency_.pop_back();
+    }
+}
+
+void SequenceBuilder::dispatch(LabeledSequence& row, std::vector<LabeledSequence>& out) {
+    const std::string& key =
+        options_.group_by == SequenceOptions::GroupBy::kUid ? row.uid : row.host;
+
+    auto it = groups_.find(key);
+    if (it == groups_.end()) {
+        if (groups_.size() == options_.max_groups) {
+            const auto victim = groups_.find(recency_.back());
+            flush(victim->first, victim->second, out);
+            groups_.erase(victim);
+            recency_.pop_back();
+            ++evicted_;
+        }
+        recency_.push_front(key);
+        it = groups_.emplace(key, Group{}).first;
+        it->second.recency = recency_.begin();
+    } else if (it->second.recency != recency_.begin()) {
+        recency_.splice(recency_.begin(), recency_, it->second.recency);
+    }
+
+    Group& group = it->second;
+    group.symbols.insert(group.symbols.end(), row.symbols.begin(), row.symbols.end());
+    group.rows.push_back({row.symbols.size(), row.label, row.ts, std::move(row.id)});
+    group.malicious += row.label ? 1 : 0;
+    ++group.pending;
+
+    const std::size_t limit = options_.window_rows;
+    if (options_.window == SequenceOptions::Window::kTumbling) {
+        if (group.rows.size() == limit) {
+            emit(it->first, group, out);
+            group.symbols.clear();
+            group.rows.clear();
+            group.malicious = 0;
+        }
+        return;
+    }
+
+    if (group.rows.size() > limit) {
+        const Row& oldest = group.rows.front();
+        group.symbols.erase(group.symbols.begin(),
+                            group.symbols.begin() + static_cast<std::ptrdiff_t>(oldest.symbol_count));
+        group.malicious -= oldest.label ? 1 : 0;
+        group.rows.pop_front();
+    }
+    if (group.rows.size() == limit && (!group.emitted || group.pending >= options_.stride)) {
+        emit(it->first, group, out);
+    }
+}
+
+void SequenceBuilder::emit(const std::string& key,
+                           Group& group,
+                           std::vector<LabeledSequence>& out) const {
+    LabeledSequence sequence;
+    sequence.id = group.rows.front().id;
+    sequence.ts = group.rows.front().ts;
+    if (options_.group_by == SequenceOptions::GroupBy::kUid) {
+        sequence.uid = key;
+    } else {
+        sequence.host = key;
+    }
+    sequence.symbols = group.symbols;
+    sequence.label = group.malicious > 0;
+    out.push_back(std::move(sequence));
+    group.pending = 0;
+    group.emitted = true;
+}
+
+void SequenceBuilder::flush(const std::string& key,
+                            Group& group,
+                            std::vector<LabeledSequence>& out) const {
+    // A tumbling window emits what is left; a sliding one emits the last
+    // window if rows arrived since its previous one (or it never filled).
+    if (!group.rows.empty() && (group.pending > 0 || !group.emitted)) {
+        emit(key, group, out);
+    }
+}
+
+}  // namespace automata_security
@@ -0,0 +1,82 @@
+#include "utils/stage_metrics.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <utility>
+
+#if !defined(_WIN32) && !defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+std::atomic<std::size_t> g_allocations{0};
+std::atomic<std::size_t> g_allocated_bytes{0};
+
+}  // namespace
+
+namespace automata_security {
+
+void record_allocation(std::size_t bytes) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+AllocationCounts allocation_counts() {
+    return {g_allocations.load(std::memory_order_relaxed),
+            g_allocated_bytes.load(std::memory_order_relaxed)};
+}
+
+std::size_t peak_rss_bytes() {
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return static_cast<std::size_t>(std::strtoull(line.c_str() + 6, nullptr, 10)) * 1024;
+        }
+    }
+    return 0;
+#elif !defined(_WIN32)
+    // macOS reports ru_maxrss in bytes.
+    rusage usage{};
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? static_cast<std::size_t>(usage.ru_maxrss) : 0;
+#else
+    return 0;
+#endif
+}
+
+bool reset_peak_rss() {
+#if defined(__linux__)
+    // "5" resets the VmHWM high-water mark to the current RSS.
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+    clear_refs.flush();
+    return static_cast<bool>(clear_refs);
+#else
+    return false;
+#endif
+}
+
+StageTimer::StageTimer(std::string name)
+    : name_(std::move(name)), start_(std::chrono::steady_clock::now()) {
+    reset_peak_rss();
+    allocations_ = allocation_counts();
+}
+
+StageMetrics StageTimer::stop(std::size_t rows) const {
+    const auto end = std::chrono::steady_clock::now();
+    const AllocationCounts allocations = allocation_counts();
+    StageMetrics metrics;
+    metrics.name = name_;
+    metrics.wall_ms = std::chrono::duration<double, std::milli>(end - start_).count();
+    metrics.rows = rows;
+    metrics.peak_rss_bytes = peak_rss_bytes();
+    metrics.allocations = allocations.allocations - allocations_.allocations;
+    metrics.allocated_bytes = allocations.bytes - allocations_.bytes;
+    return metrics;
+}
+
+}  // namespace automata_security
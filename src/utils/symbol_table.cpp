@@ -0,0 +1,26 @@
+#include "utils/symbol_table.hpp"
+
+#include <stdexcept>
+
+namespace automata_security {
+
+SymbolId SymbolTable::intern(const std::string& name) {
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    if (names_.size() >= static_cast<std::size_t>(kInvalidSymbol)) {
+        throw std::length_error("Symbol table exhausted the 32-bit id space.");
+    }
+    const auto id = static_cast<SymbolId>(names_.size());
+    names_.push_back(name);
+    ids_.emplace(name, id);
+    return id;
+}
+
+SymbolId SymbolTable::find(const std::string& name) const {
+    auto it = ids_.find(name);
+    return it == ids_.end() ? kInvalidSymbol : it->second;
+}
+
+}  // namespace automata_security
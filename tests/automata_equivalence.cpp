@@ -0,0 +1,105 @@
+// Equivalence checks for the parallel and rewritten automaton builders: the
+// parallel PTA build must give the sequential trie, Moore's minimizer the
+// same automaton as Hopcroft's at every thread count, and minimization must
+// not change any sample's verdict.
+
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "automata/dfa.hpp"
+#include "automata/pta.hpp"
+#include "utils/dataset.hpp"
+#include "utils/parser.hpp"
+#include "utils/symbol_table.hpp"
+#include "utils/thread_pool.hpp"
+
+using namespace automata_security;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    if (!ok) {
+        std::cerr << "FAIL: " << what << "\n";
+        ++failures;
+    }
+}
+
+// Random sequences over `alphabet` symbols with a regular labeling (how
+// often symbol 0 occurs plus the last symbol, mod 3) and some label noise,
+// so the minimized DFA is much smaller than the PTA but not trivial.
+std::vector<LabeledSequence> make_samples(std::size_t count, SymbolTable& symbols) {
+    constexpr std::size_t kAlphabet = 12;
+    for (std::size_t s = 0; s < kAlphabet; ++s) {
+        symbols.intern("sym=" + std::to_string(s));
+    }
+    std::mt19937 rng(7);
+    std::vector<LabeledSequence> samples(count);
+    for (auto& sample : samples) {
+        const std::size_t length = 1 + rng() % 8;
+        std::size_t zeros = 0;
+        for (std::size_t i = 0; i < length; ++i) {
+            const auto symbol = static_cast<SymbolId>(rng() % kAlphabet);
+            zeros += symbol == 0 ? 1 : 0;
+            sample.symbols.push_back(symbol);
+        }
+        sample.label = (zeros + sample.symbols.back()) % 3 == 0;
+        if (rng() % 50 == 0) {
+            sample.label = !sample.label;
+        }
+    }
+    return samples;
+}
+
+}  // namespace
+
+int main() {
+    SymbolTable symbols;
+    // Enough samples for the parallel PTA build to split into several chunks.
+    const auto samples = make_samples(100000, symbols);
+
+    PTA sequential;
+    sequential.build(samples);
+    const DFA reference = DFA::from_pta(sequential, symbols);
+    const std::string reference_pta = reference.to_dot();
+    const DFA hopcroft = reference.minimize();
+    const std::string hopcroft_dot = hopcroft.to_dot();
+    check(hopcroft.states().size() < reference.states().size(), "minimize() merges states");
+
+    for (const std::size_t threads : {1, 2, 4}) {
+        ThreadPool pool(threads);
+        const std::string label = " with " + std::to_string(threads) + " threads";
+
+        PTA parallel;
+        parallel.build(samples, pool);
+        check(DFA::from_pta(parallel, symbols).to_dot() == reference_pta,
+              "parallel PTA build equals the sequential one" + label);
+
+        PTA weighted;
+        weighted.build(deduplicate(samples), pool);
+        check(DFA::from_pta(weighted, symbols).to_dot() == reference_pta,
+              "PTA of deduplicated records equals the sample PTA" + label);
+
+        check(reference.minimize_moore(pool).to_dot() == hopcroft_dot,
+              "Moore minimization equals Hopcroft" + label);
+    }
+
+    check(hopcroft.minimize().to_dot() == hopcroft_dot, "minimize() is idempotent");
+
+    std::size_t changed = 0;
+    for (const auto& sample : samples) {
+        changed += reference.classify(sample.symbols) != hopcroft.classify(sample.symbols) ? 1 : 0;
+    }
+    check(changed == 0, std::to_string(changed) + " samples change verdict after minimize()");
+
+    if (failures > 0) {
+        return 1;
+    }
+    std::cout << "automata_equivalence: ok (" << reference.states().size() << " -> "
+              << hopcroft.states().size() << " states)\n";
+    return 0;
+}
@@ -0,0 +1,292 @@
+// DerivationIndex against the string-matching derivation it replaced. The
+// reference below is that function, kept verbatim apart from formatting, and
+// both must give the same steps for every short input over each grammar's
+// terminals (plus a value no grammar knows) and for longer random inputs.
+
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../src/api/derivation_index.hpp"
+#include "../src/api/utils.hpp"
+
+using namespace automata_security;
+
+namespace {
+
+std::vector<std::string> reference_derivation(const Grammar& g, const std::vector<std::string>& seq) {
+    std::vector<std::string> derivation;
+    derivation.push_back("S");
+
+    std::string processed_prefix;
+    std::string current_nt = "S";
+
+    auto emit_rhs = [&](const std::vector<std::string>& prod, bool translate_terminals) {
+        std::string rhs;
+        for (size_t i = 0; i < prod.size(); ++i) {
+            if (i > 0) rhs += " ";
+            const auto& token = prod[i];
+            if (translate_terminals && !token.empty() && token[0] == 'T' && g.terminals.count(token)) {
+                rhs += g.terminals.at(token);
+            } else {
+                rhs += token;
+            }
+        }
+        std::string line = processed_prefix + rhs;
+        if (derivation.back() != line) {
+            derivation.push_back(line);
+        }
+    };
+
+    auto append_production_steps = [&](const std::vector<std::string>& prod) {
+        bool needs_raw_step = !prod.empty() && !prod[0].empty() && prod[0][0] == 'T' && g.terminals.count(prod[0]);
+        if (needs_raw_step) emit_rhs(prod, false);
+        emit_rhs(prod, true);
+    };
+
+    auto advance_without_consuming = [&](bool allow_all_epsilon) {
+        bool expanded = false;
+        std::set<std::string> seen;
+        while (!current_nt.empty()) {
+            if (seen.count(current_nt)) break;
+            seen.insert(current_nt);
+
+            auto it = g.productions.find(current_nt);
+            if (it == g.productions.end()) break;
+
+            bool progressed = false;
+            for (const auto& prod : it->second) {
+                if (prod.empty()) continue;
+
+                bool unit_nt = (prod.size() == 1 && g.productions.count(prod[0]));
+                if (unit_nt) {
+                    append_production_steps(prod);
+                    current_nt = prod[0];
+                    progressed = expanded = true;
+                    break;
+                }
+
+                size_t idx = 0;
+                while (idx < prod.size() && prod[idx] == "ε") idx++;
+
+                if (idx < prod.size() && g.productions.count(prod[idx])) {
+                    append_production_steps(prod);
+                    current_nt = prod[idx];
+                    progressed = expanded = true;
+                    break;
+                }
+
+                if (allow_all_epsilon) {
+                    bool all_eps = true;
+                    for (const auto& token : prod) {
+                        if (token != "ε") {
+                            all_eps = false;
+                            break;
+                        }
+                    }
+                    if (all_eps) {
+                        append_production_steps(prod);
+                        progressed = expanded = true;
+                        current_nt.clear();
+                        break;
+                    }
+                }
+            }
+
+            if (!progressed) break;
+        }
+        return expanded;
+    };
+
+    advance_without_consuming(false);
+
+    for (size_t seq_idx = 0; seq_idx < seq.size(); ++seq_idx) {
+        const auto& sym = seq[seq_idx];
+        bool is_last = (seq_idx == seq.size() - 1);
+
+        advance_without_consuming(false);
+
+        auto prod_it = g.productions.find(current_nt);
+        if (prod_it == g.productions.end()) break;
+
+        struct Candidate {
+            const std::vector<std::string>* prod;
+            std::string next_nt;
+        };
+
+        std::vector<Candidate> candidates;
+        for (const auto& prod : prod_it->second) {
+            if (prod.empty()) continue;
+
+            size_t idx = 0;
+            while (idx < prod.size() && prod[idx] == "ε") idx++;
+            if (idx >= prod.size()) continue;
+
+            const auto& token = prod[idx];
+            bool match = false;
+            std::string terminal_value;
+
+            if (!token.empty() && token[0] == 'T' && g.terminals.count(token)) {
+                terminal_value = g.terminals.at(token);
+                match = (terminal_value == sym);
+            } else if (!g.productions.count(token)) {
+                terminal_value = token;
+                match = (terminal_value == sym);
+            } else {
+                continue;
+            }
+
+            if (!match) continue;
+
+            std::string next_nt;
+            for (size_t j = idx + 1; j < prod.size(); ++j) {
+                if (prod[j] == "ε") continue;
+                if (g.productions.count(prod[j])) {
+                    next_nt = prod[j];
+                    break;
+                }
+            }
+
+            candidates.push_back({&prod, next_nt});
+        }
+
+        const std::vector<std::string>* selected_prod = nullptr;
+        std::string selected_next_nt;
+        for (const auto& cand : candidates) {
+            if (is_last) {
+                if (cand.next_nt.empty()) {
+                    selected_prod = cand.prod;
+                    selected_next_nt = cand.next_nt;
+                    break;
+                }
+            } else {
+                if (!cand.next_nt.empty()) {
+                    selected_prod = cand.prod;
+                    selected_next_nt = cand.next_nt;
+                    break;
+                }
+            }
+        }
+
+        if (!selected_prod && !candidates.empty()) {
+            selected_prod = candidates[0].prod;
+            selected_next_nt = candidates[0].next_nt;
+        }
+
+        if (!selected_prod) break;
+
+        const auto& prod = *selected_prod;
+        append_production_steps(prod);
+
+        processed_prefix += sym + " ";
+        current_nt = selected_next_nt;
+        advance_without_consuming(false);
+    }
+
+    advance_without_consuming(true);
+
+    return derivation;
+}
+
+// Unit, ε-prefixed and all-ε productions, a terminal label, a cycle of unit
+// productions and a symbol that both ends and continues a derivation.
+constexpr const char* kEdgeCaseGrammar =
+    "T0 -> proto=tcp\n"
+    "S -> A | T0 B\n"
+    "A -> ε B | x A | ε\n"
+    "B -> ε ε C | y | y B | T0\n"
+    "C -> D | z | z C\n"
+    "D -> C | ε\n";
+
+// Terminal values a grammar's productions can read, and one it cannot.
+std::vector<std::string> terminal_values(const Grammar& g) {
+    std::set<std::string> values{"unknown=value"};
+    for (const auto& [lhs, alternatives] : g.productions) {
+        for (const auto& prod : alternatives) {
+            for (const auto& token : prod) {
+                if (token == "ε" || g.productions.count(token)) continue;
+                const auto label = g.terminals.find(token);
+                values.insert(label != g.terminals.end() ? label->second : token);
+            }
+        }
+    }
+    return {values.begin(), values.end()};
+}
+
+std::size_t compare(const std::string& name, const Grammar& g, std::size_t& inputs) {
+    const DerivationIndex index = DerivationIndex::from(g);
+    const auto values = terminal_values(g);
+    std::size_t mismatches = 0;
+    auto run = [&](const std::vector<std::string>& seq) {
+        ++inputs;
+        const Derivation derivation = index.derive(seq);
+        std::vector<std::string> steps;
+        for (std::size_t i = 0; i < derivation.steps.size(); ++i) {
+            steps.push_back(derivation.step(i));
+        }
+        if (steps != reference_derivation(g, seq)) {
+            if (mismatches++ == 0) {
+                std::cerr << "FAIL: " << name << ": derivation differs for input";
+                for (const auto& sym : seq) std::cerr << " " << sym;
+                std::cerr << "\n";
+            }
+        }
+    };
+
+    // Every input of up to three symbols.
+    std::vector<std::string> seq;
+    run(seq);
+    for (const auto& a : values) {
+        run({a});
+        for (const auto& b : values) {
+            run({a, b});
+            for (const auto& c : values) {
+                run({a, b, c});
+            }
+        }
+    }
+    // Longer random inputs.
+    std::mt19937 rng(11);
+    for (int i = 0; i < 200; ++i) {
+        seq.assign(4 + rng() % 12, {});
+        for (auto& sym : seq) sym = values[rng() % values.size()];
+        run(seq);
+    }
+    return mismatches;
+}
+
+}  // namespace
+
+int main() {
+    const std::string edge_path =
+        (std::filesystem::temp_directory_path() / "derivation_index_grammar.txt").string();
+    {
+        std::ofstream out(edge_path);
+        out << kEdgeCaseGrammar;
+    }
+
+    std::size_t failures = 0;
+    std::size_t inputs = 0;
+    for (const std::string path : {"rules/grammar.txt", "rules/pda_grammar.txt", edge_path.c_str()}) {
+        Grammar g;
+        if (!load_grammar_for_derivation(path, g) || g.productions.empty()) {
+            std::cerr << "FAIL: cannot load " << path << " (run from the repository root)\n";
+            ++failures;
+            continue;
+        }
+        failures += compare(path, g, inputs);
+    }
+    std::remove(edge_path.c_str());
+
+    if (failures > 0) {
+        return 1;
+    }
+    std::cout << "derivation_index: ok (" << inputs << " inputs)\n";
+    return 0;
+}
@@ -0,0 +1,78 @@
+// simulate_pda regressions. "ε" in a push list is pushed as a symbol named
+// "ε" (that is how the DOT loader has always read it); interning it as the
+// "no symbol" id once made the trace read past the symbol table.
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../src/api/pda_simulator.hpp"
+#include "../src/api/utils.hpp"
+
+using namespace automata_security;
+
+namespace {
+
+struct Case {
+    const char* name;
+    const char* edges;
+    bool deterministic;  // which simulate_pda path the PDA takes
+    std::vector<std::string> input;
+    bool accepted;
+    std::vector<std::string> final_stack;
+};
+
+const Case kCases[] = {
+    {"epsilon push, single deterministic path",
+     "  q0 -> q1 [label=\"a, ε -> Z ε\"];\n",
+     true,
+     {"a"},
+     true,
+     {"ε", "Z"}},
+    {"epsilon push, breadth-first search",
+     "  q0 -> q1 [label=\"a, ε -> Z ε\"];\n"
+     "  q0 -> q1 [label=\"a, ε -> Y\"];\n",
+     false,
+     {"a"},
+     true,
+     {"ε", "Z"}},
+};
+
+}  // namespace
+
+int main() {
+    const auto path = std::filesystem::temp_directory_path() / "pda_simulator_case.dot";
+    int failures = 0;
+    for (const auto& test : kCases) {
+        {
+            std::ofstream out(path);
+            out << "digraph PDA {\n"
+                << "  q0 [label=\"q0\", shape=circle];\n"
+                << "  q1 [label=\"q1\", shape=doublecircle];\n"
+                << test.edges << "}\n";
+        }
+        PDA pda;
+        std::string err;
+        if (!load_dot_pda(path.string(), pda, err)) {
+            std::cerr << "FAIL: " << test.name << ": " << err << "\n";
+            ++failures;
+            continue;
+        }
+        const PDATraceResult result = simulate_pda(pda, test.input);
+        const bool ok = pda.deterministic == test.deterministic && result.ok == test.accepted &&
+                        !result.steps.empty() && result.steps.back().stack_after == test.final_stack;
+        if (!ok) {
+            std::cerr << "FAIL: " << test.name << "\n";
+            ++failures;
+        }
+    }
+    std::filesystem::remove(path);
+
+    if (failures > 0) {
+        return 1;
+    }
+    std::cout << "pda_simulator: ok\n";
+    return 0;
+}